@@ -59,6 +59,8 @@ Renderer::Renderer(Window& parent) : OGLRenderer(parent) {
 		return;
 	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// the buffer textures were bound behind the state cache's back
+	GLStateCache::Invalidate();
 	glEnable(GL_DEPTH_TEST);
 	init = true;
 }
@@ -70,6 +72,9 @@ Renderer::~Renderer(void) {
 	delete quad;
 	delete camera;
 	
+	GLStateCache::ForgetTexture(bufferColourTex[0]);
+	GLStateCache::ForgetTexture(bufferColourTex[1]);
+	GLStateCache::ForgetTexture(bufferDepthTex);
 	glDeleteTextures(2, bufferColourTex);
 	glDeleteTextures(1, &bufferDepthTex);
 	glDeleteFramebuffers(1, &bufferFBO);
@@ -98,8 +103,7 @@ void Renderer::DrawScene() {
 	UpdateShaderMatrices();
 	glUniform1i(glGetUniformLocation(
 		sceneShader->GetProgram(), "diffuseTex"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, heightTexture);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, heightTexture);
 	heightMap->Draw();
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
@@ -118,7 +122,6 @@ void Renderer::DrawPostProcess() {
 
 	glDisable(GL_DEPTH_TEST);
 
-	glActiveTexture(GL_TEXTURE0);
 	glUniform1i(glGetUniformLocation(
 		processShader->GetProgram(), "sceneTex"), 0);
 
@@ -128,7 +131,7 @@ void Renderer::DrawPostProcess() {
 		glUniform1i(glGetUniformLocation(processShader->GetProgram(),
 			"isVertical"), 0);
 
-		glBindTexture(GL_TEXTURE_2D, bufferColourTex[0]);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, bufferColourTex[0]);
 		quad->Draw();
 
 		// now to swap the color buffers, and do the second blur pass
@@ -136,7 +139,7 @@ void Renderer::DrawPostProcess() {
 			"isVertical"), 1);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 			GL_TEXTURE_2D, bufferColourTex[0], 0);
-		glBindTexture(GL_TEXTURE_2D, bufferColourTex[1]);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, bufferColourTex[1]);
 		quad->Draw();
 	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -152,8 +155,7 @@ void Renderer::PresentScene() {
 	projMatrix.ToIdentity();
 	UpdateShaderMatrices();
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, bufferColourTex[0]);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, bufferColourTex[0]);
 	glUniform1i(glGetUniformLocation(
 		sceneShader->GetProgram(), "diffuseTex"), 0);
 	quad->Draw();
@@ -46,6 +46,7 @@ Renderer::~Renderer(void) {
 void Renderer::UpdateScene(float dt) {
 	camera->UpdateCamera(dt);
 	viewMatrix = camera->BuildViewMatrix();
+	cameraPos = camera->GetPosition();
 }
 
 void Renderer::RenderScene() {
@@ -55,16 +56,11 @@ void Renderer::RenderScene() {
 	glUniform1i(glGetUniformLocation(
 			shader->GetProgram(), "diffuseTex"), 0);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture);
 
 	glUniform1i(glGetUniformLocation(
 			shader->GetProgram(), "bumpTex"), 1);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, bumpmap);
-
-	glUniform3fv(glGetUniformLocation(shader->GetProgram(),
-			"cameraPos"), 1, (float*)&camera->GetPosition());
+	GLStateCache::BindTexture(1, GL_TEXTURE_2D, bumpmap);
 
 	UpdateShaderMatrices();
 	SetShaderLight(*light);
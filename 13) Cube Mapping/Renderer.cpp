@@ -80,6 +80,7 @@ Renderer::~Renderer(void) {
 void Renderer::UpdateScene(float dt) {
 	camera->UpdateCamera(dt);
 	viewMatrix = camera->BuildViewMatrix();
+	cameraPos = camera->GetPosition();
 	waterRotate += dt * 2.0f;
 	waterCycle += dt * 0.25f;
 }
@@ -105,18 +106,14 @@ void Renderer::DrawSkybox() {
 void Renderer::DrawHeightmap() {
 	BindShader(lightShader);
 	SetShaderLight(*light);
-	glUniform3fv(glGetUniformLocation(lightShader->GetProgram(),
-		"cameraPos"), 1, (float*)&camera->GetPosition());
 
 	glUniform1i(glGetUniformLocation(lightShader->GetProgram(),
 		"diffuseTex"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, earthTex);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, earthTex);
 
 	glUniform1i(glGetUniformLocation(lightShader->GetProgram(),
 		"bumpTex"), 1);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, earthBump);
+	GLStateCache::BindTexture(1, GL_TEXTURE_2D, earthBump);
 
 	modelMatrix.ToIdentity();
 	textureMatrix.ToIdentity();
@@ -129,19 +126,13 @@ void Renderer::DrawHeightmap() {
 void Renderer::DrawWater() {
 	BindShader(reflectShader);
 
-	glUniform3fv(glGetUniformLocation(reflectShader->GetProgram(),
-		"cameraPos"), 1, (float*)&camera->GetPosition());
-
 	glUniform1i(glGetUniformLocation(reflectShader->GetProgram(),
 		"diffuseTex"), 0);
 	glUniform1i(glGetUniformLocation(reflectShader->GetProgram(),
 		"cubeTex"), 2);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, waterTex);
-
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, waterTex);
+	GLStateCache::BindTexture(2, GL_TEXTURE_CUBE_MAP, cubeMap);
 
 	Vector3 hSize = heightMap->GetHeightmapSize();
 
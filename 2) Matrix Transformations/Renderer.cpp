@@ -35,10 +35,8 @@ void Renderer::RenderScene() {
 
 	BindShader(matrixShader);
 
-	glUniformMatrix4fv(glGetUniformLocation(matrixShader->GetProgram()
-						, "projMatrix"), 1, false, projMatrix.values);
-	glUniformMatrix4fv(glGetUniformLocation(matrixShader->GetProgram()
-						, "viewMatrix"), 1, false, viewMatrix.values);
+	//projMatrix and viewMatrix live in the FrameData uniform block
+	UpdateShaderMatrices();
 
 	for (int i = 0; i < 3; ++i) {
 		Vector3 tempPos = position;
@@ -50,9 +48,7 @@ void Renderer::RenderScene() {
 					  Matrix4::Rotation(rotation, Vector3(0, 1, 0)) *
 					  Matrix4::Scale(Vector3(scale, scale, scale));
 
-		glUniformMatrix4fv(glGetUniformLocation(
-							matrixShader->GetProgram(), "modelMatrix"),
-							1, false, modelMatrix.values);
+		matrixShader->SetUniform(UNIFORM("modelMatrix"), modelMatrix);
 		triangle->Draw();
 	}
 }
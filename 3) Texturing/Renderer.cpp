@@ -26,6 +26,7 @@ Renderer::Renderer(Window & parent) : OGLRenderer(parent) {
 Renderer::~Renderer(void) {
 	delete triangle;
 	delete shader;
+	GLStateCache::ForgetTexture(texture);
 	glDeleteTextures(1, &texture);
 }
 
@@ -35,8 +36,7 @@ void Renderer::RenderScene() {
 	UpdateShaderMatrices();
 	glUniform1i(glGetUniformLocation(shader->GetProgram(),
 				"diffuseTex"), 0);	//this last parameter
-	glActiveTexture(GL_TEXTURE0);	//should match this number!
-	glBindTexture(GL_TEXTURE_2D, texture);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture);	//should match this unit!
 	triangle->Draw();
 }
 
@@ -56,10 +56,10 @@ void Renderer::ToggleRepeating()
 void Renderer::ToggleFiltering()
 {
 	filtering = !filtering;
-	glBindTexture(GL_TEXTURE_2D, texture);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
 					filtering ? GL_LINEAR : GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
 					filtering ? GL_LINEAR : GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, 0);
 }
@@ -38,6 +38,8 @@ Renderer::~Renderer(void) {
 	delete meshes[0];
 	delete meshes[1];
 	delete shader;
+	GLStateCache::ForgetTexture(textures[0]);
+	GLStateCache::ForgetTexture(textures[1]);
 	glDeleteTextures(2, textures);
 }
 
@@ -48,13 +50,10 @@ void Renderer::RenderScene() {
 	
 	glUniform1i(glGetUniformLocation(shader->GetProgram(),
 				"diffuseTex"), 0);
-	glActiveTexture(GL_TEXTURE0);
 
 	for (unsigned int i = 0; i < 2; ++i) {
-		glUniformMatrix4fv(glGetUniformLocation(
-			shader->GetProgram(), "modelMatrix"), 1, false,
-			(float*)&Matrix4::Translation(positions[i]));
-		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		shader->SetUniform(UNIFORM("modelMatrix"), Matrix4::Translation(positions[i]));
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, textures[i]);
 		meshes[i]->Draw();	
 	}
 }
@@ -30,6 +30,8 @@ Renderer::Renderer(Window& parent) : OGLRenderer(parent) {
 Renderer::~Renderer(void) {
 	delete meshes[0];
 	delete meshes[1];
+	GLStateCache::ForgetTexture(textures[0]);
+	GLStateCache::ForgetTexture(textures[1]);
 	glDeleteTextures(2, textures);
 	delete shader;
 }
@@ -66,7 +68,7 @@ void Renderer::RenderScene() {
 		glStencilFunc(GL_ALWAYS, 2, ~0);
 		glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
 
-		glBindTexture(GL_TEXTURE_2D, textures[1]);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, textures[1]);
 		meshes[1]->Draw();
 
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -74,7 +76,7 @@ void Renderer::RenderScene() {
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, textures[0]);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, textures[0]);
 	meshes[0]->Draw();
 	glDisable(GL_SCISSOR_TEST);
 	glDisable(GL_STENCIL_TEST);
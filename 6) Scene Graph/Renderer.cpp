@@ -50,11 +50,11 @@ void Renderer::DrawNode(SceneNode* n) {
 	if (n->GetMesh()) {
 		Matrix4 model = n->GetWorldTransform() * Matrix4::Scale(n->GetModelScale());
 		
-		glUniformMatrix4fv(glGetUniformLocation(shader->GetProgram(), "modelMatrix"), 1, false, model.values);
+		shader->SetUniform(UNIFORM("modelMatrix"), model);
 
-		glUniform4fv(glGetUniformLocation(shader->GetProgram(), "nodeColour"), 1, (float*)&n->GetColour());
+		shader->SetUniform(UNIFORM("nodeColour"), n->GetColour());
 
-		glUniform1i(glGetUniformLocation(shader->GetProgram(), "useTexture"), 0);
+		shader->SetUniform(UNIFORM("useTexture"), 0);
 
 		n->Draw(*this);
 	}
@@ -48,6 +48,7 @@ Renderer::~Renderer(void) {
 	delete camera;
 	delete cube;
 	delete shader;
+	GLStateCache::ForgetTexture(texture);
 	glDeleteTextures(1, &texture);
 }
 
@@ -105,17 +106,13 @@ void Renderer::DrawNode(SceneNode* n) {
 	if (n->GetMesh()) {
 		Matrix4 model = n->GetWorldTransform() *
 			Matrix4::Scale(n->GetModelScale());
-		glUniformMatrix4fv(glGetUniformLocation(shader->GetProgram(),
-			"modelMatrix"), 1, false, model.values);
-		glUniform4fv(glGetUniformLocation(shader->GetProgram(),
-			"nodeColour"), 1, (float*)&n->GetColour());
+		shader->SetUniform(UNIFORM("modelMatrix"), model);
+		shader->SetUniform(UNIFORM("nodeColour"), n->GetColour());
 
 		texture = n->GetTexture();
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture);
 
-		glUniform1i(glGetUniformLocation(shader->GetProgram(),
-			"useTexture"), texture);
+		shader->SetUniform(UNIFORM("useTexture"), (int)texture);
 
 		n->Draw(*this);
 	}
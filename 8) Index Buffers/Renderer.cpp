@@ -50,7 +50,6 @@ void Renderer::RenderScene() {
 
 	glUniform1i(glGetUniformLocation(shader->GetProgram(),
 				"diffuseTex"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, terrainTex);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, terrainTex);
 	heightMap->Draw();
 }
\ No newline at end of file
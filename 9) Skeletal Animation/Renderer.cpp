@@ -75,8 +75,7 @@ void Renderer::RenderScene() {
 		(float*)frameMatrices.data());
 
 	for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, matTextures[i]);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, matTextures[i]);
 		mesh->DrawSubMesh(i);
 	}
 }
\ No newline at end of file
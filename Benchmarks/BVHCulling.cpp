@@ -0,0 +1,131 @@
+/*
+Times frustum culling a scene of N nodes (10000 by default) by walking the
+scene graph, against querying the BVH the coursework renderer keeps, and
+what keeping the BVH up to date costs each frame as some of the nodes
+move. Checks both ways find the same nodes, and fails if they don't:
+
+	BVHCullingBenchmark [nodes] [frames]
+*/
+#include "../nclgl/BVH.h"
+#include "../nclgl/Frustum.h"
+#include "../nclgl/SceneNode.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void WalkScene(SceneNode* n, Frustum& f, std::vector<SceneNode*>& out) {
+	if (n->GetParent() && f.InsideFrustum(*n)) {
+		out.push_back(n);
+	}
+	for (auto i = n->GetChildIteratorStart(); i != n->GetChildIteratorEnd(); ++i) {
+		WalkScene(*i, f, out);
+	}
+}
+
+static AABB NodeBounds(const SceneNode* n) {
+	return AABB::FromSphere(n->GetWorldTransform().GetPositionVector(),
+		n->GetBoundingRadius());
+}
+
+int main(int argc, char** argv) {
+	const int nodeCount		= argc > 1 ? std::max(atoi(argv[1]), 1) : 10000;
+	const int frames		= argc > 2 ? std::max(atoi(argv[2]), 1) : 100;
+	const float worldSize	= 10000.0f;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> place(0.0f, worldSize);
+	std::uniform_real_distribution<float> radius(5.0f, 50.0f);
+
+	SceneNode* root = new SceneNode();
+	std::vector<SceneNode*> nodes;
+	for (int i = 0; i < nodeCount; ++i) {
+		SceneNode* n = new SceneNode();
+		n->SetTransform(Matrix4::Translation(Vector3(place(rng), place(rng), place(rng))));
+		n->SetBoundingRadius(radius(rng));
+		root->AddChild(n);
+		nodes.push_back(n);
+	}
+	root->Update(0.0f);
+
+	BVH bvh(10.0f);
+	std::vector<BVH::ProxyID> proxies;
+	for (SceneNode* n : nodes) {
+		proxies.push_back(bvh.Insert(NodeBounds(n), n));
+	}
+
+	Frustum frustum;
+	frustum.FromMatrix(Matrix4::Perspective(1.0f, 5000.0f, 16.0f / 9.0f, 45.0f) *
+		Matrix4::BuildViewMatrix(Vector3(0.0f, worldSize * 0.5f, 0.0f),
+			Vector3(worldSize * 0.5f, worldSize * 0.5f, worldSize * 0.5f)));
+
+	// a tenth of the nodes wander about each frame
+	std::uniform_real_distribution<float> step(-20.0f, 20.0f);
+	const int moving = std::max(nodeCount / 10, 1);
+
+	double walkTime		= 0.0;
+	double refitTime	= 0.0;
+	double queryTime	= 0.0;
+	std::vector<SceneNode*> walked;
+	std::vector<SceneNode*> queried;
+	bool matched = true;
+
+	for (int frame = 0; frame < frames; ++frame) {
+		for (int i = 0; i < moving; ++i) {
+			SceneNode* n = nodes[(frame * moving + i) % nodeCount];
+			n->SetTransform(Matrix4::Translation(Vector3(step(rng), step(rng), step(rng))) *
+				n->GetTransform());
+		}
+		root->Update(1.0f / 60.0f);
+
+		Clock::time_point start = Clock::now();
+		walked.clear();
+		WalkScene(root, frustum, walked);
+		walkTime += MillisecondsSince(start);
+
+		start = Clock::now();
+		int reinserted = 0;
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			if (bvh.Update(proxies[i], NodeBounds(nodes[i]))) {
+				++reinserted;
+			}
+		}
+		if (reinserted > nodeCount / 4) {
+			bvh.Rebuild();
+		}
+		refitTime += MillisecondsSince(start);
+
+		// the proxies are fattened, so check the spheres like the renderer does
+		start = Clock::now();
+		queried.clear();
+		bvh.QueryFrustum(frustum, queried);
+		queried.erase(std::remove_if(queried.begin(), queried.end(),
+			[&frustum](SceneNode* n) { return !frustum.InsideFrustum(*n); }),
+			queried.end());
+		queryTime += MillisecondsSince(start);
+
+		std::sort(walked.begin(), walked.end());
+		std::sort(queried.begin(), queried.end());
+		matched = matched && walked == queried;
+	}
+
+	std::cout << nodeCount << " nodes, " << frames << " frames, "
+		<< walked.size() << " visible in the last\n";
+	std::cout << "Scene graph walk:  " << walkTime / frames << "ms a frame\n";
+	std::cout << "BVH query:         " << queryTime / frames << "ms a frame\n";
+	std::cout << "BVH update:        " << refitTime / frames << "ms a frame\n";
+	std::cout << "BVH query+update:  " << (queryTime + refitTime) / frames << "ms a frame\n";
+	if (!matched) {
+		std::cout << "The BVH and the scene graph walk disagreed!\n";
+	}
+	delete root;
+	return matched ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+/*
+Times updating an animated scene of N nodes (50000 by default) serially,
+and with UpdateParallel on a ThreadPool of 1 up to as many workers as
+there are hardware threads (or [max workers]). Every node spins at its own
+rate, so every local transform changes every frame. Fails if any world
+transform the parallel updates come up with isn't bitwise equal to the
+serial one:
+
+	ParallelUpdateBenchmark [nodes] [frames] [max workers]
+*/
+#include "../nclgl/SceneNode.h"
+#include "../nclgl/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+class SpinningNode : public SceneNode {
+public:
+	SpinningNode(const Vector3& offset, float speed) :
+		offset(offset), speed(speed), angle(0.0f) {}
+
+	void Update(float dt) override {
+		angle += speed * dt;
+		SetTransform(Matrix4::Translation(offset) *
+			Matrix4::Rotation(angle, Vector3(0, 1, 0)) *
+			Matrix4::Rotation(angle * 0.5f, Vector3(1, 0, 0)));
+		SceneNode::Update(dt);
+	}
+
+protected:
+	Vector3	offset;
+	float	speed;
+	float	angle;
+};
+
+// the same scene every time - groups of a few dozen nodes a few levels
+// deep under the root, like the coursework's animated models
+static SceneNode* BuildScene(int nodeCount, std::vector<SceneNode*>& nodes) {
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> place(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> speed(-90.0f, 90.0f);
+
+	SceneNode* root = new SceneNode();
+	nodes.clear();
+	std::vector<SceneNode*> group;
+	for (int i = 0; i < nodeCount; ++i) {
+		SceneNode* n = new SpinningNode(Vector3(place(rng), place(rng), place(rng)),
+			speed(rng));
+		if (i % 40 == 0) {
+			group.clear();
+			root->AddChild(n);
+		}
+		else {
+			group[std::uniform_int_distribution<int>(0, (int)group.size() - 1)(rng)]
+				->AddChild(n);
+		}
+		group.push_back(n);
+		nodes.push_back(n);
+	}
+	return root;
+}
+
+int main(int argc, char** argv) {
+	const int nodeCount	= argc > 1 ? std::max(atoi(argv[1]), 1) : 50000;
+	const int frames	= argc > 2 ? std::max(atoi(argv[2]), 1) : 30;
+	const unsigned int maxWorkers = argc > 3 ? (unsigned int)std::max(atoi(argv[3]), 1) :
+		std::max(std::thread::hardware_concurrency(), 1u);
+	const float dt = 1.0f / 60.0f;
+
+	std::vector<SceneNode*> nodes;
+	SceneNode* root = BuildScene(nodeCount, nodes);
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < frames; ++f) {
+		root->Update(dt);
+	}
+	const double serialTime = MillisecondsSince(start) / frames;
+	std::vector<Matrix4> expected;
+	for (SceneNode* n : nodes) {
+		expected.push_back(n->GetWorldTransform());
+	}
+	delete root;
+
+	std::cout << nodeCount << " nodes, " << frames << " frames\n";
+	std::cout << "Serial:      " << serialTime << "ms a frame\n";
+
+	bool matched = true;
+	for (unsigned int workers = 1; workers <= maxWorkers; ++workers) {
+		ThreadPool pool(workers);
+		root = BuildScene(nodeCount, nodes);
+		start = Clock::now();
+		for (int f = 0; f < frames; ++f) {
+			root->UpdateParallel(dt, pool);
+		}
+		const double time = MillisecondsSince(start) / frames;
+
+		bool same = true;
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			same = same && memcmp(nodes[i]->GetWorldTransform().values,
+				expected[i].values, sizeof(expected[i].values)) == 0;
+		}
+		delete root;
+
+		std::cout << workers << (workers == 1 ? " worker:    " : " workers:   ")
+			<< time << "ms a frame, " << serialTime / time << "x serial"
+			<< (same ? "" : " - DIDN'T MATCH") << "\n";
+		matched = matched && same;
+	}
+	if (!matched) {
+		std::cout << "The parallel and serial updates disagreed!\n";
+	}
+	return matched ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/*
+Times building, updating, walking and tearing down a scene graph of N
+nodes (100000 by default), with the nodes coming from SceneNodePool and
+then straight from the heap, for comparison. Other allocations are mixed
+in while the graph is built, the way loading a real scene makes them, so
+the heap version's nodes end up spread about like they would be.
+
+The update and traverse also count hardware cache misses, with
+perf_event_open, on Linux. Where the counter can't be opened - anywhere
+else, in VMs with no PMU, or with perf_event_paranoid set too high - they
+print n/a, and their times are all there is to stand in for the misses:
+
+	SceneTraversalBenchmark [nodes] [runs]
+*/
+#include "../nclgl/SceneNode.h"
+#include "../nclgl/SceneNodePool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Counts this thread's user space cache misses between Start and Stop -
+// or doesn't, if IsAvailable says so
+class CacheMissCounter {
+public:
+	CacheMissCounter() : fd(-1) {
+#ifdef __linux__
+		perf_event_attr attr = {};
+		attr.size			= sizeof(attr);
+		attr.type			= PERF_TYPE_HARDWARE;
+		attr.config			= PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled		= 1;
+		attr.exclude_kernel	= 1;
+		attr.exclude_hv		= 1;
+		fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+	~CacheMissCounter() {
+#ifdef __linux__
+		if (fd >= 0) {
+			close(fd);
+		}
+#endif
+	}
+
+	bool IsAvailable() const { return fd >= 0; }
+
+	void Start() {
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	long long Stop() {
+		long long count = 0;
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+				count = 0;
+			}
+		}
+#endif
+		return count;
+	}
+
+protected:
+	int fd;
+};
+
+static CacheMissCounter cacheMisses;
+
+struct Timings {
+	double		build			= 0.0;
+	double		update			= 0.0;
+	double		traverse		= 0.0;
+	double		teardown		= 0.0;
+	long long	updateMisses	= 0;
+	long long	traverseMisses	= 0;
+};
+
+// a walk through the nodes themselves, like BuildNodeLists does - the
+// update mostly works from the transform hierarchy's flat arrays instead
+static float Traverse(SceneNode* n) {
+	float sum = n->GetColour().x + n->GetBoundingRadius();
+	for (auto i = n->GetChildIteratorStart(); i != n->GetChildIteratorEnd(); ++i) {
+		sum += Traverse(*i);
+	}
+	return sum;
+}
+
+static void Run(bool pooled, int nodeCount, Timings& t, float& checksum) {
+	SceneNodePool::SetPooling(pooled);
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> churnSize(16, 512);
+	std::vector<std::unique_ptr<char[]>> churn;
+
+	Clock::time_point start = Clock::now();
+	SceneNode* root = new SceneNode();
+	std::vector<SceneNode*> nodes(1, root);
+	for (int i = 1; i < nodeCount; ++i) {
+		// a few levels deep, a handful of children each
+		SceneNode* parent = nodes[std::uniform_int_distribution<int>(
+			std::max(0, i - 8), i - 1)(rng) / 4];
+		SceneNode* n = new SceneNode();
+		n->SetTransform(Matrix4::Translation(Vector3((float)(i % 100), 0.0f, 1.0f)));
+		n->SetBoundingRadius(1.0f);
+		parent->AddChild(n);
+		nodes.push_back(n);
+		churn.emplace_back(new char[churnSize(rng)]);
+	}
+	t.build += MillisecondsSince(start);
+
+	start = Clock::now();
+	cacheMisses.Start();
+	root->Update(1.0f / 60.0f);
+	t.updateMisses += cacheMisses.Stop();
+	t.update += MillisecondsSince(start);
+
+	start = Clock::now();
+	cacheMisses.Start();
+	checksum += Traverse(root);
+	t.traverseMisses += cacheMisses.Stop();
+	t.traverse += MillisecondsSince(start);
+
+	start = Clock::now();
+	delete root;
+	t.teardown += MillisecondsSince(start);
+	SceneNodePool::Release();
+}
+
+static void Print(const char* name, const Timings& t, int runs) {
+	std::cout << name << ": build " << t.build / runs << "ms, update "
+		<< t.update / runs << "ms, traverse " << t.traverse / runs
+		<< "ms, teardown " << t.teardown / runs << "ms\n";
+	std::cout << "        cache misses: update ";
+	if (cacheMisses.IsAvailable()) {
+		std::cout << t.updateMisses / runs << ", traverse " << t.traverseMisses / runs << "\n";
+	}
+	else {
+		std::cout << "n/a, traverse n/a\n";
+	}
+}
+
+int main(int argc, char** argv) {
+	const int nodeCount	= argc > 1 ? std::max(atoi(argv[1]), 1) : 100000;
+	const int runs		= argc > 2 ? std::max(atoi(argv[2]), 1) : 5;
+
+	Timings pooled;
+	Timings heap;
+	float pooledSum	= 0.0f;
+	float heapSum	= 0.0f;
+	// alternated, so neither gets the warmer caches
+	for (int i = 0; i < runs; ++i) {
+		Run(true, nodeCount, pooled, pooledSum);
+		Run(false, nodeCount, heap, heapSum);
+	}
+	SceneNodePool::SetPooling(true);
+
+	std::cout << nodeCount << " nodes, " << runs << " runs\n";
+	Print("Pooled", pooled, runs);
+	Print("Heap  ", heap, runs);
+	if (pooledSum != heapSum || SceneNodePool::GetLiveCount() != 0) {
+		std::cout << "The pooled and heap scenes didn't match!\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+/*
+Times propagating world transforms through a hierarchy of N nodes (100000
+by default) with TransformHierarchy's flat depth-first pass, against the
+recursive walk SceneNode used to do, where every heap allocated node set
+worldTransform = parent * local and then recursed into its children.
+Timed with every node moving each frame, and with a tenth of them moving,
+which the flat pass can mostly skip. Only the propagation is timed - the
+local transforms are set beforehand. Fails if the two ever disagree:
+
+	TransformPropagationBenchmark [nodes] [frames]
+*/
+#include "../nclgl/TransformHierarchy.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double MillisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// the old way, as near as it matters
+struct RecursiveNode {
+	RecursiveNode*				parent = nullptr;
+	Matrix4						local;
+	Matrix4						world;
+	std::vector<RecursiveNode*>	children;
+
+	~RecursiveNode() {
+		for (RecursiveNode* c : children) {
+			delete c;
+		}
+	}
+	void Update() {
+		world = parent ? parent->world * local : local;
+		for (RecursiveNode* c : children) {
+			c->Update();
+		}
+	}
+};
+
+static Matrix4 Animated(int node, int frame) {
+	return Matrix4::Translation(Vector3((float)(node % 100), 1.0f, (float)frame)) *
+		Matrix4::Rotation((float)(node + frame), Vector3(0, 1, 0));
+}
+
+static bool Same(const Matrix4& a, const Matrix4& b) {
+	return memcmp(a.values, b.values, sizeof(a.values)) == 0;
+}
+
+int main(int argc, char** argv) {
+	const int nodeCount	= argc > 1 ? std::max(atoi(argv[1]), 1) : 100000;
+	const int frames	= argc > 2 ? std::max(atoi(argv[2]), 1) : 20;
+
+	// the same random tree both ways - a few levels deep, a handful of
+	// children each - with other allocations mixed in, the way loading a
+	// real scene makes them
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> churnSize(16, 512);
+	std::vector<std::unique_ptr<char[]>> churn;
+
+	TransformHierarchy flat;
+	flat.Reserve(nodeCount);
+	std::vector<TransformHierarchy::Handle> handles;
+	std::vector<RecursiveNode*> nodes;
+	for (int i = 0; i < nodeCount; ++i) {
+		handles.push_back(flat.Add());
+		nodes.push_back(new RecursiveNode());
+		if (i > 0) {
+			const int parent = std::uniform_int_distribution<int>(
+				std::max(0, i - 8), i - 1)(rng) / 4;
+			flat.SetParent(handles[i], handles[parent]);
+			nodes[i]->parent = nodes[parent];
+			nodes[parent]->children.push_back(nodes[i]);
+		}
+		churn.emplace_back(new char[churnSize(rng)]);
+	}
+
+	double flatAll			= 0.0;
+	double recursiveAll		= 0.0;
+	double flatTenth		= 0.0;
+	double recursiveTenth	= 0.0;
+	bool matched = true;
+
+	for (int pass = 0; pass < 2; ++pass) {
+		const int step = pass == 0 ? 1 : 10;
+		double& flatTime		= pass == 0 ? flatAll : flatTenth;
+		double& recursiveTime	= pass == 0 ? recursiveAll : recursiveTenth;
+		for (int frame = 0; frame < frames; ++frame) {
+			for (int i = frame % step; i < nodeCount; i += step) {
+				const Matrix4 m = Animated(i, frame + pass * frames);
+				flat.SetLocal(handles[i], m);
+				nodes[i]->local = m;
+			}
+
+			Clock::time_point start = Clock::now();
+			flat.UpdateWorldTransforms();
+			flatTime += MillisecondsSince(start);
+
+			start = Clock::now();
+			nodes[0]->Update();
+			recursiveTime += MillisecondsSince(start);
+
+			for (int i = 0; i < nodeCount; ++i) {
+				matched = matched && Same(flat.GetWorld(handles[i]), nodes[i]->world);
+			}
+		}
+	}
+
+	std::cout << nodeCount << " nodes, " << frames << " frames\n";
+	std::cout << "All moving:   flat " << flatAll / frames << "ms, recursive "
+		<< recursiveAll / frames << "ms a frame\n";
+	std::cout << "Tenth moving: flat " << flatTenth / frames << "ms, recursive "
+		<< recursiveTenth / frames << "ms a frame\n";
+	delete nodes[0];
+	if (!matched) {
+		std::cout << "The flat and recursive transforms didn't match!\n";
+	}
+	return matched ? 0 : 1;
+}
@@ -1,18 +1,39 @@
 #include "Renderer.h"
 #include "../nclgl/Light.h"
-#include "../nclgl/Heightmap.h"
+#include "../nclgl/HeightMap.h"
 #include "../nclgl/Shader.h"
 #include "../nclgl/Camera.h"
 #include <algorithm>
+#include <cfloat>
 #include "../nclgl/TerrainNode.h"
 #include "../nclgl/WaterNode.h"
 #include "../nclgl/StaticMeshNode.h"
 #include "../nclgl/AnimObjNode.h"
 #include "../nclgl/MeshMaterial.h"
 #include "../nclgl/MeshAnimation.h"
+#include "../nclgl/HeapCounter.h"
 const int POST_PASSES = 10;
+// distance at which render queue depth keys saturate
+const float SORT_DEPTH_RANGE = 25000.0f;
 
-Renderer::Renderer(Window& parent) : OGLRenderer(parent) {
+#ifdef _WIN32
+Renderer::Renderer(Window& parent) : OGLRenderer(parent), sceneBVH(10.0f),
+	instanceBatcher(1) {
+	Initialise();
+}
+#endif
+
+#ifdef NCLGL_HEADLESS
+Renderer::Renderer(int width, int height) : OGLRenderer(width, height),
+	sceneBVH(10.0f), instanceBatcher(1) {
+	// no context means nothing can be loaded, so init stays false
+	if (IsHeadless()) {
+		Initialise();
+	}
+}
+#endif
+
+void Renderer::Initialise() {
 	quad = Mesh::GenerateQuad();
 	postquad = Mesh::GenerateQuad();
 
@@ -31,22 +52,61 @@ Renderer::Renderer(Window& parent) : OGLRenderer(parent) {
 			(float)width / (float)height, 45.0f);
 
 	// build SceneNodes
-	root = new SceneNode();
-
-	root->AddChild(new TerrainNode(lightShader, camera, heightMap,
-											earthTex, earthBump));
-	root->AddChild(new WaterNode(reflectShader, waterTex, quad, 
-											cubeMap, heightmapSize));
-	/*root->AddChild(new StaticMeshNode(meshShader, biomeMesh, biomeMaterial,
-			Vector3(2800.0f, 320.0f, 2800.0f), 25.0f, 0.0f));*/
-	root->AddChild(new AnimObjNode(animMeshShader, dynamicObjMesh, dynamicObjAnim, dynamicObjMaterial,
-			Vector3(2000.0f, 320.0f, 2800.0f), 80.0f, 0.0f, true));
+	updatePool = new ThreadPool(ThreadPool::GetDefaultWorkerCount());
+	parallelUpdateSwitch = true;
+
+	// the world comes from a scene file, so it can be edited or replaced
+	// without rebuilding - it's written offline, with --write-scene, and
+	// only described in code here if it's missing
+	RegisterNodeTypes();
+	SceneFile world;
+	if (!world.Load(MESHDIR"Coursework.scene")) {
+		std::cout << "Using the built in world instead\n";
+		DescribeWorld(world);
+	}
+	root = sceneLoader.Instantiate(world);
+
+	// batching bakes in the props' world transforms, so they need working
+	// out first
+	root->Update(0.0f);
+	staticBatcher.Build(root);
+	instancingSwitch = true;
+
+	AddToArena(root);
+	geometryArena.Upload();
+	indirectSwitch = true;
+
+	// the proxies are made from world transforms too, so this has to come
+	// after the update above
+	AddToBVH(root);
+	bvhCullingSwitch = false;
+
+	// a vertex every 8 samples is plenty to hide things behind hills
+	heightMap->BuildOccluder(8, occluderVertices, occluderIndices);
+	occlusionSwitch = true;
+	occlusionTested = 0;
+	occlusionCulled = 0;
+
+	// TerrainNode always sits at the origin
+	horizonCuller.SetHeightMap(heightMap, Vector3(0, 0, 0));
+	horizonSwitch = true;
+	horizonTested = 0;
+	horizonCulled = 0;
+	horizonTestedTotal = 0;
+	horizonCulledTotal = 0;
+
+	lodBias = 1.0f;
+	lodHysteresis = 0.1f;
+	minScreenSize = 2.0f;
+	lodDrawsSaved = 0;
+	lodTrianglesSaved = 0;
+	printStatsNextFrame = false;
 
 
 	glGenTextures(1, &bufferDepthTex);
 	glBindTexture(GL_TEXTURE_2D, bufferDepthTex);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height,
@@ -55,8 +115,8 @@ Renderer::Renderer(Window& parent) : OGLRenderer(parent) {
 	for (int i = 0; i < 2; ++i) {
 		glGenTextures(1, &bufferColourTex[i]);
 		glBindTexture(GL_TEXTURE_2D, bufferColourTex[i]);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
@@ -80,10 +140,14 @@ Renderer::Renderer(Window& parent) : OGLRenderer(parent) {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 
+	// textures and framebuffers were bound behind the state cache's back
+	// while loading, so it can't trust anything it thinks is bound
+	GLStateCache::Invalidate();
+
 	//glEnable(GL_CULL_FACE);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::SetEnabled(GL_BLEND, true);
+	GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
 	postProcessingSwitch = false;
@@ -93,7 +157,16 @@ Renderer::Renderer(Window& parent) : OGLRenderer(parent) {
 }
 
 Renderer::~Renderer(void) {
+	if (!init) {
+		return;	// never got a context, so nothing was loaded
+	}
 	delete root;
+	delete updatePool;
+	// every node has gone with the root, so the pool's chunks can go too
+	if (!SceneNodePool::Release()) {
+		std::cout << "Renderer::~Renderer(): " << SceneNodePool::GetLiveCount()
+			<< " scene nodes still alive!\n";
+	}
 
 	delete camera;
 	delete heightMap;
@@ -101,13 +174,20 @@ Renderer::~Renderer(void) {
 	delete reflectShader;
 	delete skyboxShader;
 	delete lightShader;
+	delete instancedShader;
+	delete indirectShader;
 	delete light;
 
 	delete biomeMaterial;
 	delete meshShader;
 
+	GLStateCache::ForgetTexture(bufferColourTex[0]);
+	GLStateCache::ForgetTexture(bufferColourTex[1]);
+	GLStateCache::ForgetTexture(bufferDepthTex);
 	glDeleteTextures(2, bufferColourTex);
 	glDeleteTextures(1, &bufferDepthTex);
+	GLStateCache::ForgetFramebuffer(bufferFBO);
+	GLStateCache::ForgetFramebuffer(processFBO);
 	glDeleteFramebuffers(1, &bufferFBO);
 	glDeleteFramebuffers(1, &processFBO);
 }
@@ -116,7 +196,7 @@ void Renderer::LoadTextures() {
 	heightMap = new HeightMap(TEXTUREDIR"snowdon.png");
 
 	waterTex = SOIL_load_OGL_texture(
-		TEXTUREDIR"water.TGA", SOIL_LOAD_AUTO,
+		TEXTUREDIR"water.tga", SOIL_LOAD_AUTO,
 		SOIL_CREATE_NEW_ID, SOIL_FLAG_MIPMAPS);
 
 	earthTex = SOIL_load_OGL_texture(
@@ -150,11 +230,24 @@ void Renderer::LoadShaders() {
 	lightShader = new Shader(
 		"PerPixelVertex.glsl", "PerPixelFragment.glsl");
 	terrainShader = new Shader(
-			"BumpVertex.glsl", "TerrainFragment.glsl");
+			"bumpvertex.glsl", "TerrainFragment.glsl");
 	animMeshShader = new Shader(
 		"SkinningVertex.glsl", "TexturedFragment.glsl");
+	animMeshShader1 = new Shader(
+		"SkinningVertex.glsl", "TexturedFragment.glsl", "", "", "",
+		"#define SKIN_INFLUENCES 1");
+	animMeshShader2 = new Shader(
+		"SkinningVertex.glsl", "TexturedFragment.glsl", "", "", "",
+		"#define SKIN_INFLUENCES 2");
 	meshShader = new Shader(
 		"PerPixelVertex.glsl", "PerPixelFragment.glsl");
+	// the light and mesh shaders are the same program, so one instanced
+	// version does for both - it reads the object buffer, which needs 4.30
+	instancedShader = new Shader(
+		"PerPixelVertex.glsl", "PerPixelFragment.glsl", "", "", "",
+		"#version 430 core\n#define INSTANCED");
+	indirectShader = new Shader(
+		"IndirectVertex.glsl", "PerPixelFragment.glsl");
 	sceneShader = new Shader(
 		"TexturedVertex.glsl", "TexturedFragment.glsl");
 	processShader = new Shader(
@@ -165,10 +258,18 @@ void Renderer::LoadShaders() {
 		!lightShader->LoadSuccess() ||
 		!meshShader->LoadSuccess() ||
 		!animMeshShader->LoadSuccess() ||
+		!animMeshShader1->LoadSuccess() ||
+		!animMeshShader2->LoadSuccess() ||
+		!instancedShader->LoadSuccess() ||
+		!indirectShader->LoadSuccess() ||
 		!sceneShader->LoadSuccess() ||
 		!processShader->LoadSuccess()) {
 		return;
 	}
+	instanceBatcher.SetInstancedShader(lightShader, instancedShader);
+	instanceBatcher.SetInstancedShader(meshShader, instancedShader);
+	indirectDrawList.SetIndirectShader(lightShader, indirectShader);
+	indirectDrawList.SetIndirectShader(meshShader, indirectShader);
 }
 
 void Renderer::LoadMeshes() {
@@ -178,35 +279,209 @@ void Renderer::LoadMeshes() {
 	/*biomeMesh = Mesh::LoadFromMeshFile("CommonTree_4.msh");
 	biomeMaterial = new MeshMaterial("CommonTree_4.mat");*/
 
-	dynamicObjMesh = Mesh::LoadFromMeshFile("Role_T.msh");
-	dynamicObjAnim = new MeshAnimation("Role_T.anm");
-	dynamicObjMaterial = new MeshMaterial("Role_T.mat");
+}
+
+void Renderer::RegisterNodeTypes() {
+	sceneLoader.RegisterShader("light", lightShader);
+	sceneLoader.RegisterShader("reflect", reflectShader);
+	sceneLoader.RegisterShader("mesh", meshShader);
+
+	sceneLoader.RegisterType("Terrain", [this](const SceneLoader::NodeInfo& info) {
+		return new TerrainNode(info.shader ? info.shader : lightShader,
+			camera, heightMap, earthTex, earthBump);
+	});
+	sceneLoader.RegisterType("Water", [this](const SceneLoader::NodeInfo& info) {
+		return new WaterNode(info.shader ? info.shader : reflectShader,
+			waterTex, quad, cubeMap, heightMap->GetHeightmapSize());
+	});
+	// params are scale, y rotation, and for animated objects, whether it moves
+	sceneLoader.RegisterType("StaticMesh", [this](const SceneLoader::NodeInfo& info) {
+		const SceneFile::Node& r = *info.record;
+		SceneNode* n = new StaticMeshNode(info.shader ? info.shader : meshShader,
+			info.mesh, info.material,
+			SceneFile::GetTransform(r).GetPositionVector(), r.params[0], r.params[1],
+			info.textures);
+		if (r.boundingRadius > 0.0f) {
+			n->SetBoundingRadius(r.boundingRadius);
+		}
+		return n;
+	});
+	sceneLoader.RegisterType("AnimObj", [this](const SceneLoader::NodeInfo& info) {
+		const SceneFile::Node& r = *info.record;
+		AnimObjNode* n = new AnimObjNode(
+			info.shader ? info.shader : animMeshShader,
+			info.mesh, info.animation, info.material,
+			SceneFile::GetTransform(r).GetPositionVector(), r.params[0], r.params[1],
+			r.params[2] != 0.0f, info.textures);
+		if (!info.shader) {
+			n->SetInfluenceShaders(animMeshShader1, animMeshShader2);
+		}
+		if (r.boundingRadius > 0.0f) {
+			n->SetBoundingRadius(r.boundingRadius);
+		}
+		return n;
+	});
+}
+
+void Renderer::DescribeWorld(SceneFile& world) {
+	int root = world.AddNode(-1, "SceneNode", Matrix4());
+
+	int terrain = world.AddNode(root, "Terrain", Matrix4());
+	world.SetResource(terrain, SceneFile::RESOURCE_SHADER, "light");
+
+	int water = world.AddNode(root, "Water", Matrix4());
+	world.SetResource(water, SceneFile::RESOURCE_SHADER, "reflect");
+
+	/*int tree = world.AddNode(root, "StaticMesh",
+		Matrix4::Translation(Vector3(2800.0f, 320.0f, 2800.0f)));
+	world.SetResource(tree, SceneFile::RESOURCE_MESH, "tree-maple-low-poly-Anim.msh");
+	world.SetResource(tree, SceneFile::RESOURCE_MATERIAL, "tree-maple-low-poly-Anim.mat");
+	world.SetResource(tree, SceneFile::RESOURCE_SHADER, "mesh");
+	world.GetNode(tree).params[0] = 25.0f;*/
+
+	int role = world.AddNode(root, "AnimObj",
+		Matrix4::Translation(Vector3(2000.0f, 320.0f, 2800.0f)));
+	world.SetResource(role, SceneFile::RESOURCE_MESH, "Role_T.msh");
+	world.SetResource(role, SceneFile::RESOURCE_MATERIAL, "Role_T.mat");
+	world.SetResource(role, SceneFile::RESOURCE_ANIMATION, "Role_T.anm");
+	world.GetNode(role).params[0] = 80.0f;
+	world.GetNode(role).params[2] = 1.0f;
 }
 
 void Renderer::UpdateScene(float dt) {
-	camera->UpdateCamera(dt);
+	PROFILE_SCOPE("UpdateScene");
+	// headless runs have no input, and need the same view every time
+	if (!IsHeadless()) {
+		camera->UpdateCamera(dt);
+	}
 	viewMatrix = camera->BuildViewMatrix();
+	cameraPos = camera->GetPosition();
 
 	// culling and NodeScene update
 	frameFrustum.FromMatrix(projMatrix * viewMatrix);
-	root->Update(dt);
+	if (parallelUpdateSwitch) {
+		root->UpdateParallel(dt, *updatePool);
+	}
+	else {
+		root->Update(dt);
+	}
+	// nothing else reads the proxies, so they're left stale until the BVH
+	// is switched back on
+	if (bvhCullingSwitch) {
+		PROFILE_SCOPE("UpdateBVH");
+		UpdateBVH();
+	}
 }
 
-void Renderer::BuildNodeLists(SceneNode* from) {
-	// check whether node is inside the frustum
-	if (frameFrustum.InsideFrustum(*from) || from->GetMesh()) {
-		Vector3 dir = from->GetWorldTransform().GetPositionVector()
-			- camera->GetPosition();
-		from->SetCameraDistance(Vector3::Dot(dir, dir));
-
-		if (from->GetColour().w < 1.0f) {
-			transparentNodeList.push_back(from);
+void Renderer::AddToBVH(SceneNode* from) {
+	if (from->GetMesh()) {
+		bvhNodes.push_back(from);
+		bvhProxies.push_back(sceneBVH.Insert(AABB::FromSphere(
+			from->GetWorldTransform().GetPositionVector(),
+			from->GetBoundingRadius()), from));
+	}
+	for (vector<SceneNode*>::const_iterator
+		i = from->GetChildIteratorStart();
+		i != from->GetChildIteratorEnd(); ++i) {
+		AddToBVH((*i));
+	}
+}
+
+void Renderer::AddToArena(SceneNode* from) {
+	if (from->GetMesh() && from->CanInstance() &&
+		indirectDrawList.GetIndirectShader(from->GetShader())) {
+		for (int i = 0; i < from->GetLODCount(); ++i) {
+			geometryArena.Add(from->GetLODMesh(i));
 		}
-		else {
-			nodeList.push_back(from);
+	}
+	for (vector<SceneNode*>::const_iterator
+		i = from->GetChildIteratorStart();
+		i != from->GetChildIteratorEnd(); ++i) {
+		AddToArena((*i));
+	}
+}
+
+void Renderer::UpdateBVH() {
+	int reinserted = 0;
+	for (size_t i = 0; i < bvhNodes.size(); ++i) {
+		SceneNode* n = bvhNodes[i];
+		if (sceneBVH.Update(bvhProxies[i], AABB::FromSphere(
+			n->GetWorldTransform().GetPositionVector(),
+			n->GetBoundingRadius()))) {
+			++reinserted;
 		}
 	}
+	// lots of moves in one go make for a poor tree, so start again
+	if (reinserted > (int)bvhNodes.size() / 4) {
+		sceneBVH.Rebuild();
+	}
+}
+
+void Renderer::CullScene() {
+	occlusionTested = 0;
+	occlusionCulled = 0;
+	horizonTested = 0;
+	horizonCulled = 0;
+	lodDrawsSaved = 0;
+	lodTrianglesSaved = 0;
+	horizonCuller.SetCameraPosition(camera->GetPosition());
+	if (occlusionSwitch) {
+		occlusionBuffer.Begin(projMatrix * viewMatrix);
+		occlusionBuffer.AddOccluder(occluderVertices.data(),
+			occluderIndices.data(), occluderIndices.size(), Matrix4());
+		occlusionBuffer.Rasterise(updatePool);
+	}
+	if (!bvhCullingSwitch) {
+		BuildNodeLists(root);
+		return;
+	}
+	bvhVisible.clear();
+	sceneBVH.QueryFrustum(frameFrustum, bvhVisible);
+	// the proxies are boxes around fattened spheres, so check the spheres -
+	// all in one batch, rather than node by node
+	const size_t count = bvhVisible.size();
+	FrameAdaptor<float> frameFloats(frameAllocator);
+	FrameVector<float> cullX(count, 0.0f, frameFloats);
+	FrameVector<float> cullY(count, 0.0f, frameFloats);
+	FrameVector<float> cullZ(count, 0.0f, frameFloats);
+	FrameVector<float> cullRadius(count, 0.0f, frameFloats);
+	FrameVector<unsigned int> cullVisible(count, 0, frameAllocator);
+	for (size_t i = 0; i < count; ++i) {
+		const Vector3 pos = bvhVisible[i]->GetWorldTransform().GetPositionVector();
+		cullX[i]		= pos.x;
+		cullY[i]		= pos.y;
+		cullZ[i]		= pos.z;
+		cullRadius[i]	= bvhVisible[i]->GetBoundingRadius();
+	}
+	size_t visible = frameFrustum.CullSpheres(cullX.data(), cullY.data(),
+		cullZ.data(), cullRadius.data(), count, cullVisible.data());
+	for (size_t i = 0; i < visible; ++i) {
+		AddToNodeLists(bvhVisible[cullVisible[i]]);
+	}
+}
+
+void Renderer::BuildNodeLists(SceneNode* from) {
+	// test the bounds of the whole subtree first - if it's entirely outside
+	// or inside the frustum, none of its children need testing
+	const BoundingSphere& bounds = from->GetSubtreeBounds();
+	Frustum::Containment c = frameFrustum.ClassifySphere(bounds.centre, bounds.radius);
 
+	if (c == Frustum::OUTSIDE) {
+		return;
+	}
+	if (IsBelowHorizon(bounds.centre, bounds.radius)) {
+		int hidden = CountDrawableNodes(from);
+		horizonTested += hidden;
+		horizonCulled += hidden;
+		return;
+	}
+	if (c == Frustum::INSIDE) {
+		AddSubtreeToNodeLists(from);
+		return;
+	}
+	if (frameFrustum.InsideFrustum(*from)) {
+		AddToNodeLists(from);
+	}
 	for (vector<SceneNode*>::const_iterator
 		i = from->GetChildIteratorStart();
 		i != from->GetChildIteratorEnd(); ++i) {
@@ -215,82 +490,299 @@ void Renderer::BuildNodeLists(SceneNode* from) {
 	}
 }
 
-void Renderer::SortNodeLists() {
-	std::sort(transparentNodeList.rbegin(), // r stands for reverse sorting
-		transparentNodeList.rend(),
-		SceneNode::CompareByCameraDistance);
+void Renderer::AddSubtreeToNodeLists(SceneNode* from) {
+	AddToNodeLists(from);
+	for (vector<SceneNode*>::const_iterator
+		i = from->GetChildIteratorStart();
+		i != from->GetChildIteratorEnd(); ++i) {
+		AddSubtreeToNodeLists((*i));
+	}
+}
 
-	std::sort(nodeList.begin(),
-		nodeList.end(),
-		SceneNode::CompareByCameraDistance);
+int Renderer::CountDrawableNodes(SceneNode* from) {
+	int count = (from->GetMesh() && from->GetShader()) ? 1 : 0;
+	for (vector<SceneNode*>::const_iterator
+		i = from->GetChildIteratorStart();
+		i != from->GetChildIteratorEnd(); ++i) {
+		count += CountDrawableNodes((*i));
+	}
+	return count;
 }
 
-void Renderer::ClearNodeLists() {
-	transparentNodeList.clear();
-	nodeList.clear();
+bool Renderer::IsBelowHorizon(const Vector3& centre, float radius) const {
+	return horizonSwitch && horizonCuller.IsOccluded(centre, radius);
 }
 
-void Renderer::DrawNodes() {
-	for (const auto& i : nodeList) {
-		DrawNode(i);
+float Renderer::GetScreenSize(float radius, float distance) const {
+	if (distance <= radius) {
+		return FLT_MAX;
 	}
-	for (const auto& i : transparentNodeList) {
-		DrawNode(i);
+	// projected diameter, in pixels
+	return radius * projMatrix.values[5] * (float)height / distance;
+}
+
+void Renderer::AddToNodeLists(SceneNode* n) {
+	// nothing to draw, so don't bother queueing it
+	if (!n->GetMesh() || !n->GetShader()) {
+		return;
+	}
+	// every drawable node in view counts as tested, along with those in
+	// subtrees BuildNodeLists culled whole - even if something cheaper
+	// below gets rid of it first, or the stats overstate the culled share
+	if (horizonSwitch) {
+		++horizonTested;
 	}
+	Vector3 dir = n->GetWorldTransform().GetPositionVector()
+		- camera->GetPosition();
+	n->SetCameraDistance(Vector3::Dot(dir, dir));
+
+	float screenSize = GetScreenSize(n->GetBoundingRadius(),
+		sqrt(n->GetCameraDistance())) * lodBias;
+	if (screenSize < minScreenSize) {
+		++lodDrawsSaved;
+		lodTrianglesSaved += n->GetLODMesh(0)->GetTriCount();
+		return;
+	}
+	if (IsBelowHorizon(n->GetWorldTransform().GetPositionVector(),
+		n->GetBoundingRadius())) {
+		++horizonCulled;
+		return;
+	}
+	if (occlusionSwitch) {
+		++occlusionTested;
+		if (!occlusionBuffer.IsVisible(AABB::FromSphere(
+			n->GetWorldTransform().GetPositionVector(), n->GetBoundingRadius()))) {
+			++occlusionCulled;
+			return;
+		}
+	}
+	n->SelectLOD(screenSize, lodHysteresis);
+	lodTrianglesSaved += n->GetLODMesh(0)->GetTriCount()
+		- n->GetMesh()->GetTriCount();
+
+	RenderQueue::Layer layer = n->GetColour().w < 1.0f ?
+		RenderQueue::LAYER_TRANSPARENT : RenderQueue::LAYER_OPAQUE;
+
+	renderQueue.Push(RenderQueue::MakeKey(layer,
+		n->GetShader()->GetSortID(), n->GetTexture(),
+		n->GetMesh()->GetSortID(),
+		sqrt(n->GetCameraDistance()) / SORT_DEPTH_RANGE), n);
 }
 
-//todo: DrawSkybox, DrawHeightmap, DrawWater here.
-void Renderer::DrawNode(SceneNode* n) {
-	if (n->GetMesh()) {
-		Shader* shader = n->GetShader();
-		if (shader) {
-			BindShader(shader);
-			SetShaderLight(*light);
+void Renderer::SortNodeLists() {
+	if (printStatsNextFrame) {
+		// what the old distance-only sort would have cost, for comparison
+		FrameVector<RenderQueueItem> byDistance(renderQueue.GetItems().begin(),
+			renderQueue.GetItems().end(), frameAllocator);
+		std::stable_sort(byDistance.begin(), byDistance.end(),
+			[](const RenderQueueItem& a, const RenderQueueItem& b) {
+				bool aTransparent = a.node->GetColour().w < 1.0f;
+				bool bTransparent = b.node->GetColour().w < 1.0f;
+				if (aTransparent != bTransparent) {
+					return bTransparent;
+				}
+				return aTransparent ?
+					SceneNode::CompareByCameraDistance(b.node, a.node) :
+					SceneNode::CompareByCameraDistance(a.node, b.node);
+			});
+		distanceStateChanges = RenderQueue::CountStateChanges(
+			byDistance.data(), byDistance.size());
+	}
+	horizonTestedTotal += horizonTested;
+	horizonCulledTotal += horizonCulled;
 
-			glUniform3fv(glGetUniformLocation(shader->GetProgram(),
-					"cameraPos"), 1, (float*)&camera->GetPosition());
+	renderQueue.Sort();
+	sortedStateChanges = RenderQueue::CountStateChanges(
+		renderQueue.GetItems().data(), renderQueue.GetItems().size());
 
-			UpdateShaderMatrices();
+	objectBuffer.Build(renderQueue.GetItems());
+	if (instancingSwitch) {
+		instanceBatcher.Build(renderQueue.GetItems());
+	}
+	else {
+		instanceBatcher.Clear();
+	}
+	if (indirectSwitch) {
+		indirectDrawList.Build(renderQueue.GetItems(), geometryArena);
+	}
+	else {
+		indirectDrawList.Clear();
+	}
 
+	if (printStatsNextFrame) {
+		printStatsNextFrame = false;
+		std::cout << "Draws: " << renderQueue.GetItems().size() << "\n";
+		std::cout << "State changes (shader/material/mesh)\n";
+		std::cout << "\tsorted by distance: " << distanceStateChanges.shader << "/"
+			<< distanceStateChanges.material << "/" << distanceStateChanges.mesh << "\n";
+		std::cout << "\tsorted by key:      " << sortedStateChanges.shader << "/"
+			<< sortedStateChanges.material << "/" << sortedStateChanges.mesh << "\n";
+		std::cout << "Frame allocator: " << frameAllocator.GetLastFrameBytesUsed()
+			<< " of " << frameAllocator.GetCapacity() << " bytes used, "
+			<< frameAllocator.GetLastFrameHeapAllocations()
+			<< " fell back to the heap last frame\n";
+		if (HeapCounter::IsCounting()) {
+			std::cout << "Heap allocations last frame, all threads: "
+				<< HeapCounter::GetLastFrameAllocations() << "\n";
+		}
+		std::cout << "GL state calls last frame: " << GLStateCache::GetLastFrameIssued()
+			<< ", " << GLStateCache::GetLastFrameElided() << " dropped as redundant\n";
+		std::cout << "Uniform uploads last frame: " << Shader::GetLastFrameUploads()
+			<< ", " << Shader::GetLastFrameSkipped() << " skipped as unchanged\n";
+		std::cout << "Uniform blocks written last frame: " << uniformRing.GetLastFrameBinds()
+			<< " (" << uniformRing.GetLastFrameBytes() << " bytes)\n";
+		std::cout << "Static batches: " << staticBatcher.GetBatchCount()
+			<< ", replacing " << staticBatcher.GetSourceDrawCount() << " draws\n";
+		std::cout << "Object buffer: " << objectBuffer.GetObjectCount() << " objects ("
+			<< objectBuffer.GetObjectCount() * sizeof(ObjectData) << " bytes)\n";
+		std::cout << "Instancing: " << instanceBatcher.GetInstanceCount()
+			<< " nodes in " << instanceBatcher.GetGroups().size() << " draws\n";
+		std::cout << "Indirect: " << indirectDrawList.GetObjectCount()
+			<< " nodes in " << indirectDrawList.GetCommands().size()
+			<< " commands over " << indirectDrawList.GetBatches().size()
+			<< " multi-draws, from " << geometryArena.GetMeshCount()
+			<< " meshes in the arena\n";
+		std::cout << "LOD bias " << lodBias << ": " << lodDrawsSaved
+			<< " draws and " << lodTrianglesSaved << " triangles saved\n";
+		std::cout << "Horizon culled " << horizonCulled << " of "
+			<< horizonTested << " nodes in view, "
+			<< (horizonTestedTotal ? 100.0 * horizonCulledTotal / horizonTestedTotal : 0.0)
+			<< "% since switched on\n";
+		std::cout << "Occlusion culled " << occlusionCulled << " of "
+			<< occlusionTested << " nodes" << std::endl;
+		if (Profiler::IsEnabled()) {
+			Profiler::PrintSummary();
+		}
+	}
+}
 
+void Renderer::ClearNodeLists() {
+	renderQueue.Clear();
+}
+
+void Renderer::BindNodeShader(Shader* s, Shader*& boundShader, bool setDiffuseTex) {
+	// the queue is sorted by shader, so only set up each one once
+	if (s == boundShader) {
+		return;
+	}
+	boundShader = s;
+	BindShader(boundShader);
+	SetShaderLight(*light);
+
+	// instanced and indirect draws never go through
+	// ShadedSceneNode::LoadTexture
+	if (setDiffuseTex) {
+		boundShader->SetUniform(UNIFORM("diffuseTex"), 0);
+	}
+	UpdateShaderMatrices();
+}
+
+void Renderer::DrawNodes() {
+	const vector<RenderQueueItem>& items = renderQueue.GetItems();
+	const vector<InstanceBatcher::Group>& groups = instanceBatcher.GetGroups();
+	const vector<IndirectDrawList::Batch>& batches = indirectDrawList.GetBatches();
+	objectBuffer.Upload();
+	objectBuffer.Bind();
+	geometryArena.SetDrawIDBuffer(objectBuffer.GetDrawIDBuffer());
+	indirectDrawList.Upload();
+
+	Shader* boundShader = NULL;
+	size_t nextGroup = 0;
+	size_t nextBatch = 0;
+	size_t i = 0;
+	while (i < items.size()) {
+		SceneNode* n = items[i].node;
+		if (nextBatch < batches.size() && batches[nextBatch].first == i) {
+			const IndirectDrawList::Batch& b = batches[nextBatch++];
+			BindNodeShader(indirectDrawList.GetIndirectShader(n->GetShader()),
+				boundShader, true);
+
+			GLStateCache::BindVertexArray(geometryArena.GetArrayObject());
+			GLStateCache::BindTexture(0, GL_TEXTURE_2D, b.texture);
+			indirectDrawList.Draw(b);
+
+			// any instance groups in there have been drawn already
+			i += b.itemCount;
+			while (nextGroup < groups.size() && groups[nextGroup].first < i) {
+				++nextGroup;
+			}
+			continue;
+		}
+		const InstanceBatcher::Group* group = NULL;
+		Shader* shader = n->GetShader();
+		if (nextGroup < groups.size() && groups[nextGroup].first == i) {
+			// groups are only made for nodes with an instanced shader, but
+			// never bind a NULL one if that changes
+			Shader* instanced = instanceBatcher.GetInstancedShader(shader);
+			++nextGroup;
+			if (instanced) {
+				group = &groups[nextGroup - 1];
+				shader = instanced;
+			}
+		}
+		BindNodeShader(shader, boundShader, group != NULL);
+		if (group) {
+			n->GetMesh()->SetDrawIDBuffer(objectBuffer.GetDrawIDBuffer());
+			n->DrawInstanced(*this, group->count, group->baseInstance);
+			i += group->count;
+		}
+		else {
 			n->Draw(*this);
+			++i;
 		}
 	}
 }
 
+void Renderer::PrintStats() {
+	printStatsNextFrame = true;
+}
+
 void Renderer::RenderScene() {
 	if (postProcessingSwitch) {
 		projMatrix = Matrix4::Perspective(1.0f, 25000.0f, 
 							(float)width / (float)height, 45.0f);
-		glBindFramebuffer(GL_FRAMEBUFFER, bufferFBO);
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, bufferFBO);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | 
 										GL_STENCIL_BUFFER_BIT);
-		BuildNodeLists(root);
-		SortNodeLists();
-		DrawSkybox();
-		DrawNodes();
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		DrawScenePasses();
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
+		StartDebugGroup("DrawPostProcess");
 		DrawPostProcess();
+		EndDebugGroup();
+		StartDebugGroup("PresentScene");
 		PresentScene();
+		EndDebugGroup();
 		ClearNodeLists();
 	}
 	else {
 		projMatrix = Matrix4::Perspective(1.0f, 15000.0f,
 					(float)width / (float)height, 45.0f);
 		viewMatrix = camera->BuildViewMatrix();
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		BuildNodeLists(root);
-		SortNodeLists();
-		DrawSkybox();
-		DrawNodes();
+		DrawScenePasses();
 		ClearNodeLists();
 	}
 }
 
+void Renderer::DrawScenePasses() {
+	StartDebugGroup("CullScene");
+	CullScene();
+	EndDebugGroup();
+	StartDebugGroup("SortNodeLists");
+	SortNodeLists();
+	EndDebugGroup();
+	StartDebugGroup("DrawSkybox");
+	DrawSkybox();
+	EndDebugGroup();
+	StartDebugGroup("DrawNodes");
+	DrawNodes();
+	EndDebugGroup();
+}
+
 void Renderer::DrawPostProcess() {
-	glBindFramebuffer(GL_FRAMEBUFFER, processFBO);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, processFBO);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 		GL_TEXTURE_2D, bufferColourTex[1], 0);
 	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
@@ -301,72 +793,60 @@ void Renderer::DrawPostProcess() {
 	projMatrix.ToIdentity();
 	UpdateShaderMatrices();
 
-	glDisable(GL_DEPTH_TEST);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
 
-	glActiveTexture(GL_TEXTURE0);
-	glUniform1i(glGetUniformLocation(
-		processShader->GetProgram(), "sceneTex"), 0);
+	processShader->SetUniform(UNIFORM("sceneTex"), 0);
 	for (int i = 0; i < POST_PASSES; ++i) {
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 			GL_TEXTURE_2D, bufferColourTex[1], 0);
-		glUniform1i(glGetUniformLocation(processShader->GetProgram(),
-			"isVertical"), 0);
+		processShader->SetUniform(UNIFORM("isVertical"), 0);
 
-		glBindTexture(GL_TEXTURE_2D, bufferColourTex[0]);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, bufferColourTex[0]);
 		postquad->Draw();
 		// Now to swap the colour buffers , and do the second blur pass
-		glUniform1i(glGetUniformLocation(processShader->GetProgram(),
-			"isVertical"), 1);
+		processShader->SetUniform(UNIFORM("isVertical"), 1);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 			GL_TEXTURE_2D, bufferColourTex[0], 0);
-		glBindTexture(GL_TEXTURE_2D, bufferColourTex[1]);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, bufferColourTex[1]);
 		postquad->Draw();
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
 }
 
 void Renderer::PresentScene() {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 	BindShader(sceneShader);
 	modelMatrix.ToIdentity();
 	viewMatrix.ToIdentity();
 	projMatrix.ToIdentity();
 	UpdateShaderMatrices();
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, bufferColourTex[0]);
-	glUniform1i(glGetUniformLocation(
-		sceneShader->GetProgram(), "diffuseTex"), 0);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, bufferColourTex[0]);
+	sceneShader->SetUniform(UNIFORM("diffuseTex"), 0);
 	postquad->Draw();
 }
 
 void Renderer::DrawSkybox() {
-	glDepthMask(GL_FALSE);
+	GLStateCache::DepthMask(false);
 
 	BindShader(skyboxShader);
 	UpdateShaderMatrices();
 
 	quad->Draw();
 
-	glDepthMask(GL_TRUE);
+	GLStateCache::DepthMask(true);
 }
 
 void Renderer::DrawHeightmap() {
 	BindShader(lightShader);
 	SetShaderLight(*light);
-	glUniform3fv(glGetUniformLocation(lightShader->GetProgram(),
-		"cameraPos"), 1, (float*)&camera->GetPosition());
 
-	glUniform1i(glGetUniformLocation(lightShader->GetProgram(),
-		"diffuseTex"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, earthTex);
+	lightShader->SetUniform(UNIFORM("diffuseTex"), 0);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, earthTex);
 
-	glUniform1i(glGetUniformLocation(lightShader->GetProgram(),
-		"bumpTex"), 1);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, earthBump);
+	lightShader->SetUniform(UNIFORM("bumpTex"), 1);
+	GLStateCache::BindTexture(1, GL_TEXTURE_2D, earthBump);
 
 	modelMatrix.ToIdentity();
 	textureMatrix.ToIdentity();
@@ -379,19 +859,12 @@ void Renderer::DrawHeightmap() {
 void Renderer::DrawWater() {
 	BindShader(reflectShader);
 
-	glUniform3fv(glGetUniformLocation(reflectShader->GetProgram(),
-		"cameraPos"), 1, (float*)&camera->GetPosition());
+	reflectShader->SetUniform(UNIFORM("diffuseTex"), 0);
+	reflectShader->SetUniform(UNIFORM("cubeTex"), 2);
 
-	glUniform1i(glGetUniformLocation(reflectShader->GetProgram(),
-		"diffuseTex"), 0);
-	glUniform1i(glGetUniformLocation(reflectShader->GetProgram(),
-		"cubeTex"), 2);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, waterTex);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, waterTex);
-
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
+	GLStateCache::BindTexture(2, GL_TEXTURE_CUBE_MAP, cubeMap);
 
 	Vector3 hSize = heightMap->GetHeightmapSize();
 
@@ -410,4 +883,53 @@ void Renderer::DrawWater() {
 
 void Renderer::TogglePostProcessing() {
 	postProcessingSwitch = !postProcessingSwitch;
+}
+
+void Renderer::ToggleParallelUpdate() {
+	parallelUpdateSwitch = !parallelUpdateSwitch;
+}
+
+void Renderer::ToggleBVHCulling() {
+	bvhCullingSwitch = !bvhCullingSwitch;
+	// the proxies haven't been kept up while it was off
+	if (bvhCullingSwitch) {
+		UpdateBVH();
+	}
+}
+
+void Renderer::ToggleOcclusionCulling() {
+	occlusionSwitch = !occlusionSwitch;
+}
+
+void Renderer::AdjustLODBias(float scale) {
+	lodBias = std::min(std::max(lodBias * scale, 0.1f), 10.0f);
+	std::cout << "LOD bias: " << lodBias << std::endl;
+}
+
+void Renderer::ToggleInstancing() {
+	instancingSwitch = !instancingSwitch;
+}
+
+void Renderer::ToggleIndirectDraws() {
+	indirectSwitch = !indirectSwitch;
+}
+
+void Renderer::ToggleProfiling() {
+	if (Profiler::IsEnabled()) {
+		Profiler::PrintSummary();
+		Profiler::ExportChromeTrace("profile.json");
+		Profiler::SetEnabled(false);
+		std::cout << "Profiling off, last " << Profiler::GetFrames().size()
+			<< " frames written to profile.json" << std::endl;
+	}
+	else {
+		Profiler::SetEnabled(true);
+		std::cout << "Profiling on" << std::endl;
+	}
+}
+
+void Renderer::ToggleHorizonCulling() {
+	horizonSwitch = !horizonSwitch;
+	horizonTestedTotal = 0;
+	horizonCulledTotal = 0;
 }
\ No newline at end of file
@@ -2,6 +2,16 @@
 #include "../nclgl/OGLRenderer.h"
 #include "../nclgl/SceneNode.h"
 #include "../nclgl/Frustum.h"
+#include "../nclgl/BVH.h"
+#include "../nclgl/RenderQueue.h"
+#include "../nclgl/OcclusionBuffer.h"
+#include "../nclgl/HorizonCuller.h"
+#include "../nclgl/SceneLoader.h"
+#include "../nclgl/StaticBatcher.h"
+#include "../nclgl/InstanceBatcher.h"
+#include "../nclgl/GeometryArena.h"
+#include "../nclgl/IndirectDrawList.h"
+#include "../nclgl/ObjectBuffer.h"
 
 class Camera;
 class Shader;
@@ -13,26 +23,104 @@ class SceneNode;
 
 class Renderer : public OGLRenderer {
 public:
+#ifdef _WIN32
 	Renderer(Window & parent);
+#endif
+#ifdef NCLGL_HEADLESS
+	// draws offscreen, with the camera held still
+	Renderer(int width, int height);
+#endif
 	~Renderer(void);
 
 	void RenderScene() override;
 	void UpdateScene(float dt) override;
 
 	void TogglePostProcessing();
+	void ToggleParallelUpdate();
+	void ToggleBVHCulling();
+	void ToggleOcclusionCulling();
+	void ToggleHorizonCulling();
+	void ToggleInstancing();
+	void ToggleIndirectDraws();
+	// starts recording frame timings, or stops and writes the last few
+	// seconds' worth out to profile.json as a Chrome trace
+	void ToggleProfiling();
+	// scales the size nodes are treated as having on screen when picking
+	// their level of detail - bigger means more detail
+	void AdjustLODBias(float scale);
+	// prints draw and state change counts for the next frame to the console
+	void PrintStats();
+
+	// the coursework world, as written to Meshes/Coursework.scene by
+	// CourseworkProj --write-scene - doesn't need a renderer to call
+	static void DescribeWorld(SceneFile& world);
 	
 protected:
+	// everything both constructors do once there's a context
+	void Initialise();
+	// culls, sorts and draws the scene into whatever's bound, a pass at a time
+	void DrawScenePasses();
+	void CullScene();
 	void BuildNodeLists(SceneNode* from);
+	void AddSubtreeToNodeLists(SceneNode* from);
+	void AddToNodeLists(SceneNode* n);
 	void SortNodeLists();
 	void ClearNodeLists();
 	void DrawNodes();
-	void DrawNode(SceneNode* n);
 
 	SceneNode*	root;
 	Frustum		frameFrustum;
 
-	vector<SceneNode*> transparentNodeList;
-	vector<SceneNode*> nodeList;
+	ThreadPool*	updatePool;
+	bool		parallelUpdateSwitch;
+
+	// every node with a mesh has a proxy in here, kept up to date each frame
+	BVH			sceneBVH;
+	vector<SceneNode*>	bvhNodes;
+	vector<BVH::ProxyID>	bvhProxies;
+	vector<SceneNode*>	bvhVisible;
+	bool		bvhCullingSwitch;
+
+	void AddToBVH(SceneNode* from);
+	void UpdateBVH();
+
+	// the terrain, rasterised on the CPU each frame, hides whatever is
+	// behind the hills before it gets anywhere near the GPU
+	OcclusionBuffer	occlusionBuffer;
+	vector<Vector3>		occluderVertices;
+	vector<unsigned int>	occluderIndices;
+	bool		occlusionSwitch;
+	int			occlusionTested;
+	int			occlusionCulled;
+
+	// cheaper still - whole subtrees hidden below the terrain's horizon are
+	// dropped while walking the scene graph
+	HorizonCuller	horizonCuller;
+	bool		horizonSwitch;
+	int			horizonTested;
+	int			horizonCulled;
+	// running totals since horizon culling was last switched on
+	size_t		horizonTestedTotal;
+	size_t		horizonCulledTotal;
+
+	bool IsBelowHorizon(const Vector3& centre, float radius) const;
+
+	// nodes are drawn at the level of detail their size on screen calls
+	// for, and not at all if they'd cover less than minScreenSize pixels
+	float		lodBias;
+	float		lodHysteresis;
+	float		minScreenSize;
+	int			lodDrawsSaved;
+	size_t		lodTrianglesSaved;
+
+	float GetScreenSize(float radius, float distance) const;
+	static int CountDrawableNodes(SceneNode* from);
+
+	// opaque and transparent nodes both, in the order they're drawn
+	RenderQueue	renderQueue;
+	RenderQueue::StateChanges	sortedStateChanges;
+	RenderQueue::StateChanges	distanceStateChanges;
+	bool		printStatsNextFrame;
 
 	void DrawHeightmap();
 	void DrawWater();
@@ -62,12 +150,35 @@ protected:
 	MeshAnimation*	biomeAnim;
 	MeshMaterial*	biomeMaterial;
 
-	Mesh*			dynamicObjMesh;
-	MeshAnimation*	dynamicObjAnim;
-	MeshMaterial*	dynamicObjMaterial;
+	// owns every mesh, material and animation the scene file uses
+	SceneLoader		sceneLoader;
+	void RegisterNodeTypes();
+	// static props, merged by shader, texture and area into a few big meshes
+	StaticBatcher	staticBatcher;
+	// every queued node's transform, colour and material, in one storage
+	// buffer the instanced and indirect shaders read from
+	ObjectBuffer	objectBuffer;
+	// runs of the same mesh, shader and textures in the render queue,
+	// drawn with one instanced call each - even runs of one, as those
+	// still save setting the node's model matrix
+	InstanceBatcher	instanceBatcher;
+	bool		instancingSwitch;
+	// copies of every plain mesh node's meshes in one set of buffers, so
+	// runs with the same shader and texture can go in one multi-draw
+	// call, whatever their meshes - ahead of instancing when both apply
+	GeometryArena	geometryArena;
+	IndirectDrawList	indirectDrawList;
+	bool		indirectSwitch;
+
+	void AddToArena(SceneNode* from);
+	void BindNodeShader(Shader* s, Shader*& boundShader, bool setDiffuseTex);
 
 	Shader*		meshShader;
 	Shader*		animMeshShader;
+	Shader*		animMeshShader1;	//single influence permutation
+	Shader*		animMeshShader2;	//two influence permutation
+	Shader*		instancedShader;
+	Shader*		indirectShader;
 	
 	float		waterRotate;
 	float		waterCycle;
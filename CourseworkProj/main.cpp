@@ -1,8 +1,93 @@
+#ifdef _WIN32
 #include "../nclgl/window.h"
-#include "Renderer.h"
 #include "conio.h"
+#endif
+#include "Renderer.h"
+#include "../nclgl/GameTimer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#ifdef NCLGL_HEADLESS
+/*
+Draws a set number of frames offscreen, with a fixed timestep and the
+camera held still, so runs can be compared between builds and machines.
+Prints frame time statistics, and saves the last frame if given a file
+name, for image comparisons. Given a trace file name too, it profiles the
+run and writes the last frames out as a Chrome trace:
+
+	CourseworkProj --headless [frames] [image.tga] [trace.json]
+*/
+int RunHeadless(int frames, const std::string& image, const std::string& trace) {
+	Renderer renderer(1280, 720);
+	if (!renderer.HasInitialised()) {
+		return -1;
+	}
+	frames = std::max(frames, 1);
+	Profiler::SetEnabled(!trace.empty());
+	vector<float> frameTimes;
+	frameTimes.reserve(frames);
+
+	GameTimer timer;
+	for (int i = 0; i < frames; ++i) {
+		renderer.UpdateScene(1.0f / 60.0f);
+		renderer.RenderScene();
+		renderer.SwapBuffers();
+		timer.Tick();
+		frameTimes.push_back(timer.GetTimeDeltaMSec());
+	}
+	glFinish();
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	float total = 0.0f;
+	for (float t : frameTimes) {
+		total += t;
+	}
+	std::cout << frames << " frames, mean " << total / frames
+		<< "ms, median " << frameTimes[frames / 2]
+		<< "ms, 95th percentile " << frameTimes[(frames * 95) / 100]
+		<< "ms, worst " << frameTimes.back() << "ms\n";
+
+	if (!trace.empty()) {
+		Profiler::PrintSummary();
+		if (!Profiler::ExportChromeTrace(trace)) {
+			return -1;
+		}
+	}
+	if (!image.empty() && !renderer.SaveFrame(image)) {
+		return -1;
+	}
+	return 0;
+}
+#endif
 
-int main() {
+/*
+Writes the coursework world out as a scene file, for the renderer to load
+- run it again whenever Renderer::DescribeWorld changes:
+
+	CourseworkProj --write-scene [file]
+*/
+int WriteScene(const std::string& filename) {
+	SceneFile world;
+	Renderer::DescribeWorld(world);
+	if (!world.Save(filename)) {
+		return -1;
+	}
+	std::cout << "Wrote " << world.GetNodeCount() << " nodes to " << filename << "\n";
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--write-scene") {
+		return WriteScene(argc > 2 ? argv[2] : MESHDIR"Coursework.scene");
+	}
+#ifdef NCLGL_HEADLESS
+	if (argc > 1 && std::string(argv[1]) == "--headless") {
+		return RunHeadless(argc > 2 ? atoi(argv[2]) : 600,
+			argc > 3 ? argv[3] : "", argc > 4 ? argv[4] : "");
+	}
+#endif
+#ifdef _WIN32
 	Window w("Cube Mapping!", 1280, 720,false);
 	if(!w.HasInitialised()) {
 		_getch();
@@ -29,7 +114,38 @@ int main() {
 		if (Window::GetKeyboard()->KeyDown(KEYBOARD_P)) {
 			renderer.TogglePostProcessing();
 		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_U)) {
+			renderer.ToggleParallelUpdate();
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_B)) {
+			renderer.ToggleBVHCulling();
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_O)) {
+			renderer.ToggleOcclusionCulling();
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_H)) {
+			renderer.ToggleHorizonCulling();
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_N)) {
+			renderer.ToggleInstancing();
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_M)) {
+			renderer.ToggleIndirectDraws();
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_PLUS)) {
+			renderer.AdjustLODBias(1.25f);
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_MINUS)) {
+			renderer.AdjustLODBias(0.8f);
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_I)) {
+			renderer.PrintStats();
+		}
+		if (Window::GetKeyboard()->KeyTriggered(KEYBOARD_T)) {
+			renderer.ToggleProfiling();
+		}
 	}
+#endif
 
 	return 0;
 }
\ No newline at end of file
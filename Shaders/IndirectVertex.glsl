@@ -0,0 +1,47 @@
+#version 430 core
+
+// PerPixelVertex for meshes drawn out of the geometry arena with
+// glMultiDrawElementsIndirect - each draw's model matrix and colour come
+// from the object buffer, found through the drawID attribute (which the
+// draw's base instance is added on to)
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
+
+struct ObjectData {
+    mat4 modelMatrix;
+    vec4 colour;
+};
+layout(std430, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+in vec3 position;
+in vec3 normal;
+in vec2 texCoord;
+in uint drawID;
+
+out Vertex {
+    vec4 colour;
+    vec2 texCoord;
+    vec3 normal;
+    vec3 worldPos;
+} OUT;
+
+void main(void) {
+    mat4 modelMatrix = objects[drawID].modelMatrix;
+
+    OUT.colour = objects[drawID].colour;
+    OUT.texCoord = texCoord;
+
+    mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
+    OUT.normal = normalize(normalMatrix * normalize(normal));
+
+    vec4 worldPos = (modelMatrix * vec4(position, 1));
+
+    OUT.worldPos = worldPos.xyz;
+
+    gl_Position = (projMatrix * viewMatrix) * worldPos;
+}
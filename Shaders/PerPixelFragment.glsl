@@ -3,15 +3,22 @@
 /*
 start off with a uniform texture sampler so we
 can sample the incoming mesh's texture.
-further 4 uniform values - 3 to represent the point 
-light's attributes, and 1 to keep the camera's
-world space position.
+the camera's world space position comes from the
+FrameData block, and the point light's 3 attributes
+from LightData - both shared by every shader, and
+filled in by OGLRenderer.
 */
 uniform sampler2D diffuseTex;
-uniform vec3 cameraPos;
-uniform vec4 lightColour;
-uniform vec3 lightPos;
-uniform float lightRadius;
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
+layout(std140) uniform LightData {
+    vec4 lightColour;
+    vec3 lightPos;
+    float lightRadius;
+};
 
 in Vertex {
     vec4 colour;
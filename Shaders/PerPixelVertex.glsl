@@ -1,8 +1,26 @@
 #version 330 core
 
+// Loaded with INSTANCED defined, and #version 430 core in place of the
+// above, to take the model matrix and colour from the object buffer instead
+#ifdef INSTANCED
+// ObjectBuffer - one entry per object drawn this frame, found through the
+// drawID attribute (which the draw's base instance is added on to)
+struct ObjectData {
+    mat4 modelMatrix;
+    vec4 colour;
+};
+layout(std430, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+in uint drawID;
+#else
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+#endif
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
 
 in vec3 position;
 in vec4 colour;
@@ -17,7 +35,12 @@ in vec2 texCoord;
  } OUT;
 
  void main(void) {
+#ifdef INSTANCED
+    mat4 modelMatrix = objects[drawID].modelMatrix;
+    OUT.colour = objects[drawID].colour;
+#else
     OUT.colour = colour;
+#endif
     OUT.texCoord = texCoord;
 
     mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
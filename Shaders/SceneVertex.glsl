@@ -1,7 +1,10 @@
 #version 330 core
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
 uniform vec4 nodeColour;
 
 in vec3 position;
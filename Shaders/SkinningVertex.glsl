@@ -1,14 +1,25 @@
 #version 400
 
+// Loaded with SKIN_INFLUENCES defined as 1 or 2 for meshes whose pruned
+// weights never use more than that many joints per vertex
+#ifndef SKIN_INFLUENCES
+#define SKIN_INFLUENCES 4
+#endif
+
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
 
 in vec3 position;
 in vec2 texCoord;
 in vec4 jointWeights;
 in ivec4 jointIndices;
 
+// Mesh::MAX_SKINNING_JOINTS - larger rigs are split into partitions at load
+// time, and jointIndices are local to the partition being drawn
 uniform mat4 joints[128];
 
 out Vertex {
@@ -19,7 +30,7 @@ void main(void) {
     vec4 localPos = vec4(position, 1.0f);
     vec4 skelPos = vec4(0, 0, 0, 0);
 
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < SKIN_INFLUENCES; i++) {
         int jointIndex = jointIndices[i];
         float jointWeight = jointWeights[i];
 
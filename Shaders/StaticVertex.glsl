@@ -1,8 +1,11 @@
 # version 400
 
 uniform mat4 modelMatrix ;
-uniform mat4 viewMatrix ;
-uniform mat4 projMatrix ;
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
 uniform sampler2D blendMap;
 
 
@@ -2,10 +2,16 @@
 uniform sampler2D diffuseTex;
 uniform sampler2D bumpTex; //New!
 
-uniform vec3 cameraPos;
-uniform vec4 lightColour;
-uniform vec3 lightPos;
-uniform float lightRadius;
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
+layout(std140) uniform LightData {
+    vec4 lightColour;
+    vec3 lightPos;
+    float lightRadius;
+};
 
 in Vertex {
     vec3 colour;
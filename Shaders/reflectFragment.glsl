@@ -3,7 +3,11 @@
 uniform sampler2D diffuseTex;
 uniform samplerCube cubeTex;
 
-uniform vec3 cameraPos;
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 cameraPos;
+};
 
 in Vertex {
     vec4 colour;
@@ -0,0 +1,123 @@
+/*
+Builds IndirectDrawLists straight from DrawItems, and checks the batches
+and commands that come out - no GL context, scene or arena needed.
+Returns non-zero if any check fails.
+*/
+#include "../nclgl/IndirectDrawList.h"
+#include <iostream>
+
+static int failures = 0;
+
+#define CHECK(x) do { \
+	if (!(x)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #x "\n"; \
+		++failures; \
+	} \
+} while (0)
+
+// never dereferenced, only compared
+static Shader* const shaderA = reinterpret_cast<Shader*>(0x10);
+static Shader* const shaderB = reinterpret_cast<Shader*>(0x20);
+
+static IndirectDrawList::DrawItem Item(GLuint mesh, Shader* shader, GLuint texture) {
+	IndirectDrawList::DrawItem d;
+	d.meshID	= mesh;
+	// a made up range per mesh, so the commands can be told apart
+	d.range.firstIndex	= mesh * 100;
+	d.range.indexCount	= mesh * 3;
+	d.range.baseVertex	= (GLint)mesh * 10;
+	d.shader	= shader;
+	d.texture	= texture;
+	return d;
+}
+
+static void TestEmpty() {
+	IndirectDrawList list;
+	list.Build(std::vector<IndirectDrawList::DrawItem>());
+	CHECK(list.GetBatches().empty());
+	CHECK(list.GetCommands().empty());
+	CHECK(list.GetObjectCount() == 0);
+}
+
+static void TestInstancesMerge() {
+	// the same mesh three times, then another - two commands, one batch
+	std::vector<IndirectDrawList::DrawItem> items = {
+		Item(1, shaderA, 5), Item(1, shaderA, 5), Item(1, shaderA, 5),
+		Item(2, shaderA, 5)
+	};
+	IndirectDrawList list;
+	list.Build(items);
+	CHECK(list.GetBatches().size() == 1);
+	CHECK(list.GetCommands().size() == 2);
+	CHECK(list.GetObjectCount() == 4);
+
+	const IndirectDrawList::Batch& b = list.GetBatches()[0];
+	CHECK(b.first == 0 && b.itemCount == 4);
+	CHECK(b.firstCommand == 0 && b.commandCount == 2);
+	CHECK(b.texture == 5);
+
+	const DrawElementsIndirectCommand& c0 = list.GetCommands()[0];
+	CHECK(c0.instanceCount == 3 && c0.baseInstance == 0);
+	CHECK(c0.firstIndex == 100 && c0.count == 3 && c0.baseVertex == 10);
+	const DrawElementsIndirectCommand& c1 = list.GetCommands()[1];
+	CHECK(c1.instanceCount == 1 && c1.baseInstance == 3);
+	CHECK(c1.firstIndex == 200 && c1.count == 6 && c1.baseVertex == 20);
+}
+
+static void TestBatchBreaks() {
+	// a texture change, a shader change and an item that can't be drawn
+	// indirectly all end a batch
+	std::vector<IndirectDrawList::DrawItem> items = {
+		Item(1, shaderA, 5), Item(2, shaderA, 5),
+		Item(2, shaderA, 6), Item(2, shaderA, 6),
+		Item(3, shaderB, 6), Item(3, shaderB, 6),
+		Item(4, NULL, 6),
+		Item(3, shaderB, 6), Item(3, shaderB, 6)
+	};
+	IndirectDrawList list;
+	list.Build(items);
+	const std::vector<IndirectDrawList::Batch>& batches = list.GetBatches();
+	CHECK(batches.size() == 4);
+	if (batches.size() == 4) {
+		CHECK(batches[0].first == 0 && batches[0].itemCount == 2 && batches[0].texture == 5);
+		CHECK(batches[1].first == 2 && batches[1].itemCount == 2 && batches[1].texture == 6);
+		CHECK(batches[2].first == 4 && batches[2].itemCount == 2);
+		CHECK(batches[3].first == 7 && batches[3].itemCount == 2);
+		// the same mesh either side of a break still needs its own command
+		CHECK(batches[3].commandCount == 1);
+		CHECK(list.GetCommands()[batches[3].firstCommand].baseInstance == 7);
+	}
+	CHECK(list.GetObjectCount() == 8);
+}
+
+static void TestMinItems() {
+	std::vector<IndirectDrawList::DrawItem> items = {
+		Item(1, shaderA, 5), Item(2, shaderA, 5),
+		Item(1, shaderB, 5),
+		Item(1, shaderA, 6), Item(1, shaderA, 6), Item(2, shaderA, 6)
+	};
+	IndirectDrawList list(3);
+	list.Build(items);
+	// only the last run is long enough
+	CHECK(list.GetBatches().size() == 1 && list.GetBatches()[0].first == 3);
+	CHECK(list.GetObjectCount() == 3);
+
+	// rebuilding starts again from nothing
+	list.Build(std::vector<IndirectDrawList::DrawItem>(items.begin(), items.begin() + 2));
+	CHECK(list.GetBatches().empty());
+	CHECK(list.GetCommands().empty());
+	CHECK(list.GetObjectCount() == 0);
+}
+
+int main() {
+	TestEmpty();
+	TestInstancesMerge();
+	TestBatchBreaks();
+	TestMinItems();
+	if (failures) {
+		std::cout << failures << " checks failed\n";
+		return 1;
+	}
+	std::cout << "All checks passed\n";
+	return 0;
+}
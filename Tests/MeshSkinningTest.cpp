@@ -0,0 +1,185 @@
+/*
+Partitions made up rigs with more joints than the skinning palette holds,
+the way Mesh::PartitionJoints does at load time, and checks that skinning
+through each partition's local palette still lands every vertex where the
+full palette would - no GL context or mesh file needed.
+Returns non-zero if any check fails.
+*/
+#include "../nclgl/MeshSkinning.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+static int failures = 0;
+
+#define CHECK(x) do { \
+	if (!(x)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #x "\n"; \
+		++failures; \
+	} \
+} while (0)
+
+// the shader's palette size, as in Mesh::MAX_SKINNING_JOINTS
+static const unsigned int PALETTE_JOINTS = 128;
+
+struct Rig {
+	std::vector<Vector3>		positions;
+	std::vector<Vector4>		weights;
+	std::vector<int>			weightIndices;
+	std::vector<unsigned int>	indices;
+};
+
+// A strip of quads along x, each vertex weighted to up to four joints near
+// its own position along the strip, so neighbouring triangles share most
+// of their joints the way a real rig's do
+static Rig MakeRig(int quads, int joints, unsigned int seed) {
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> spread(-3, 3);
+	std::uniform_real_distribution<float> weight(0.05f, 1.0f);
+
+	Rig r;
+	for (int q = 0; q <= quads; ++q) {
+		for (int side = 0; side < 2; ++side) {
+			r.positions.emplace_back(Vector3((float)q, (float)side, (float)(q % 5)));
+			const int centre = (q * joints) / (quads + 1);
+			const int influences = 1 + (q + side) % MeshSkinning::MAX_INFLUENCES;
+			float w[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float total = 0.0f;
+			for (int i = 0; i < MeshSkinning::MAX_INFLUENCES; ++i) {
+				const int j = std::min(std::max(centre + spread(rng), 0), joints - 1);
+				if (i < influences) {
+					w[i] = weight(rng);
+					total += w[i];
+				}
+				r.weightIndices.emplace_back(i < influences ? j : 0);
+			}
+			r.weights.emplace_back(Vector4(w[0] / total, w[1] / total,
+				w[2] / total, w[3] / total));
+		}
+	}
+	for (unsigned int q = 0; q < (unsigned int)quads; ++q) {
+		const unsigned int v = q * 2;
+		const unsigned int quad[6] = { v, v + 2, v + 1, v + 1, v + 2, v + 3 };
+		r.indices.insert(r.indices.end(), quad, quad + 6);
+	}
+	return r;
+}
+
+// every joint moves somewhere different, so picking the wrong one shows
+static std::vector<Matrix4> MakePalette(int joints) {
+	std::vector<Matrix4> palette;
+	for (int j = 0; j < joints; ++j) {
+		palette.emplace_back(Matrix4::Translation(
+			Vector3((float)j, (float)(j % 7), (float)(j % 3))) *
+			Matrix4::Rotation((float)(j * 13), Vector3(0, 1, 0)));
+	}
+	return palette;
+}
+
+// Checks what has to hold for any partitioning of 'r', and returns how
+// many indices ended up in partitions of each submesh (with -1 at the end)
+static std::vector<int> CheckPartitioning(const Rig& r, const SkinPartitionResult& result,
+	int joints, int subMeshCount, unsigned int maxJoints) {
+	std::vector<int> perSubMesh(subMeshCount + 1, 0);
+	std::vector<bool> drawn(r.indices.size(), false);
+
+	CHECK(result.indices.size() == r.indices.size());
+	CHECK(result.weightIndices.size() == result.vertexRemap.size() * 4);
+	for (const SkinPartition& p : result.partitions) {
+		CHECK(p.joints.size() <= maxJoints);
+		CHECK(std::is_sorted(p.joints.begin(), p.joints.end()));
+		CHECK(p.subMesh >= -1 && p.subMesh < subMeshCount);
+		CHECK(p.count % 3 == 0);
+		perSubMesh[p.subMesh < 0 ? subMeshCount : p.subMesh] += p.count;
+
+		for (int i = p.start; i < p.start + p.count; ++i) {
+			CHECK(!drawn[i]);
+			drawn[i] = true;
+			const unsigned int v = result.indices[i];
+			CHECK(v < result.vertexRemap.size());
+			CHECK(result.vertexRemap[v] < r.positions.size());
+			for (int k = 0; k < MeshSkinning::MAX_INFLUENCES; ++k) {
+				CHECK(result.weightIndices[v * 4 + k] < (int)p.joints.size());
+			}
+		}
+	}
+	// every index is drawn by exactly one partition
+	CHECK(std::find(drawn.begin(), drawn.end(), false) == drawn.end());
+
+	const std::vector<Matrix4> palette = MakePalette(joints);
+	const float error = MeshSkinning::CompareToUnpartitioned(result, r.positions.data(),
+		r.weights.data(), r.weightIndices.data(), palette.data());
+	CHECK(error < 0.001f);
+	return perSubMesh;
+}
+
+static void TestOneSubMesh() {
+	const int joints = 300;
+	Rig r = MakeRig(400, joints, 1);
+	SkinPartitionResult result;
+	MeshSkinning::PartitionMesh(result, PALETTE_JOINTS, r.weights.data(),
+		r.weightIndices.data(), r.indices.data(), (unsigned int)r.indices.size(),
+		{ std::make_pair(0, (int)r.indices.size()) });
+
+	// 300 joints can't fit in one 128 joint palette
+	CHECK(result.partitions.size() >= 3);
+	std::vector<int> perSubMesh = CheckPartitioning(r, result, joints, 1, PALETTE_JOINTS);
+	CHECK(perSubMesh[0] == (int)r.indices.size());
+	CHECK(perSubMesh[1] == 0);
+}
+
+static void TestUncoveredRanges() {
+	// two submeshes, with indices before, between and after them that
+	// neither covers - those still have to come out partitioned
+	const int joints = 500;
+	Rig r = MakeRig(600, joints, 2);
+	const int n = (int)r.indices.size();
+	const std::vector<std::pair<int, int>> subMeshes = {
+		std::make_pair(600, 1200),
+		std::make_pair(2400, 900)
+	};
+	SkinPartitionResult result;
+	MeshSkinning::PartitionMesh(result, PALETTE_JOINTS, r.weights.data(),
+		r.weightIndices.data(), r.indices.data(), (unsigned int)n, subMeshes);
+
+	std::vector<int> perSubMesh = CheckPartitioning(r, result, joints, 2, PALETTE_JOINTS);
+	CHECK(perSubMesh[0] == 1200);
+	CHECK(perSubMesh[1] == 900);
+	CHECK(perSubMesh[2] == n - 2100);
+
+	// partitions stay inside the range they were made from
+	for (const SkinPartition& p : result.partitions) {
+		if (p.subMesh >= 0) {
+			const std::pair<int, int>& m = subMeshes[p.subMesh];
+			CHECK(p.start >= m.first && p.start + p.count <= m.first + m.second);
+		}
+		else {
+			for (const std::pair<int, int>& m : subMeshes) {
+				CHECK(p.start + p.count <= m.first || p.start >= m.first + m.second);
+			}
+		}
+	}
+}
+
+static void TestSmallPalette() {
+	// a palette below one triangle's worth of joints gets raised to it
+	const int joints = 200;
+	Rig r = MakeRig(200, joints, 3);
+	SkinPartitionResult result;
+	MeshSkinning::PartitionMesh(result, 4, r.weights.data(),
+		r.weightIndices.data(), r.indices.data(), (unsigned int)r.indices.size(),
+		{ std::make_pair(0, (int)r.indices.size()) });
+	CheckPartitioning(r, result, joints, 1, MeshSkinning::MIN_PARTITION_JOINTS);
+}
+
+int main() {
+	TestOneSubMesh();
+	TestUncoveredRanges();
+	TestSmallPalette();
+	if (failures) {
+		std::cout << failures << " checks failed\n";
+		return 1;
+	}
+	std::cout << "All checks passed\n";
+	return 0;
+}
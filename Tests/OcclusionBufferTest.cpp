@@ -0,0 +1,138 @@
+/*
+Rasterises a known occluder into an OcclusionBuffer on the CPU, and checks
+what it says is hidden behind it - no GL context needed. Returns non-zero
+if any check fails.
+
+The camera sits at the origin looking down -z, with a 10 x 10 wall at
+z = -10 straight in front of it.
+*/
+#include "../nclgl/OcclusionBuffer.h"
+#include "../nclgl/ThreadPool.h"
+#include <iostream>
+
+static int failures = 0;
+
+#define CHECK(x) do { \
+	if (!(x)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #x "\n"; \
+		++failures; \
+	} \
+} while (0)
+
+static const Vector3 wallVertices[] = {
+	Vector3(-5.0f, -5.0f, -10.0f), Vector3( 5.0f, -5.0f, -10.0f),
+	Vector3( 5.0f,  5.0f, -10.0f), Vector3(-5.0f,  5.0f, -10.0f)
+};
+static const unsigned int wallIndices[] = { 0, 1, 2, 2, 3, 0 };
+
+static Matrix4 CameraMatrix() {
+	return Matrix4::Perspective(1.0f, 100.0f, 2.0f, 60.0f) *
+		Matrix4::BuildViewMatrix(Vector3(0, 0, 0), Vector3(0, 0, -1));
+}
+
+static void DrawWall(OcclusionBuffer& buffer, ThreadPool* pool,
+	const Matrix4& model = Matrix4()) {
+	buffer.Begin(CameraMatrix());
+	buffer.AddOccluder(wallVertices, wallIndices, 6, model);
+	buffer.Rasterise(pool);
+}
+
+static AABB Box(const Vector3& centre, float halfSize) {
+	AABB box;
+	box.min = centre - Vector3(halfSize, halfSize, halfSize);
+	box.max = centre + Vector3(halfSize, halfSize, halfSize);
+	return box;
+}
+
+static void TestEmptyBuffer() {
+	OcclusionBuffer buffer;
+	buffer.Begin(CameraMatrix());
+	buffer.Rasterise();
+	CHECK(buffer.IsVisible(Box(Vector3(0, 0, -50), 1.0f)));
+	CHECK(buffer.GetDepth(buffer.GetWidth() / 2, buffer.GetHeight() / 2) == 1.0f);
+}
+
+static void TestWallDepths() {
+	OcclusionBuffer buffer;
+	DrawWall(buffer, nullptr);
+	const int cx = buffer.GetWidth() / 2;
+	const int cy = buffer.GetHeight() / 2;
+	const float centre = buffer.GetDepth(cx, cy);
+	CHECK(centre > 0.0f && centre < 1.0f);
+	// flat and facing the camera, so the same depth all over
+	CHECK(buffer.GetDepth(cx + 5, cy - 5) == centre);
+	// the wall only covers the middle of the screen
+	CHECK(buffer.GetDepth(0, 0) == 1.0f);
+	CHECK(buffer.GetDepth(buffer.GetWidth() - 1, buffer.GetHeight() - 1) == 1.0f);
+}
+
+static void TestVisibility() {
+	OcclusionBuffer buffer;
+	DrawWall(buffer, nullptr);
+
+	// right behind the wall
+	CHECK(!buffer.IsVisible(Box(Vector3(0, 0, -20), 1.0f)));
+	CHECK(!buffer.IsVisible(Box(Vector3(2, -2, -50), 2.0f)));
+	// in front of it
+	CHECK(buffer.IsVisible(Box(Vector3(0, 0, -5), 1.0f)));
+	// behind it, but off to the side, where it can be seen past the edge
+	CHECK(buffer.IsVisible(Box(Vector3(14, 0, -20), 1.0f)));
+	// poking out past the edge is still visible
+	CHECK(buffer.IsVisible(Box(Vector3(9.5f, 0, -20), 1.0f)));
+	// going through the wall
+	CHECK(buffer.IsVisible(Box(Vector3(0, 0, -10), 1.0f)));
+	// too close to the camera to test, so always let through
+	CHECK(buffer.IsVisible(Box(Vector3(0, 0, 0), 2.0f)));
+}
+
+static void TestClippedOccluder() {
+	// a floor just below the camera, running from behind it off into the
+	// distance - it has to be clipped against the near plane, and what's
+	// left still hides anything underneath it
+	const Vector3 floorVertices[] = {
+		Vector3(-50.0f, -1.0f,   20.0f), Vector3( 50.0f, -1.0f,   20.0f),
+		Vector3( 50.0f, -1.0f, -100.0f), Vector3(-50.0f, -1.0f, -100.0f)
+	};
+	OcclusionBuffer buffer;
+	buffer.Begin(CameraMatrix());
+	buffer.AddOccluder(floorVertices, wallIndices, 6, Matrix4());
+	buffer.Rasterise();
+
+	CHECK(!buffer.IsVisible(Box(Vector3(0, -10, -30), 1.0f)));
+	CHECK(buffer.IsVisible(Box(Vector3(0, 1, -30), 0.5f)));
+	// nothing above the horizon is covered
+	CHECK(buffer.GetDepth(buffer.GetWidth() / 2, buffer.GetHeight() - 1) == 1.0f);
+	CHECK(buffer.GetDepth(buffer.GetWidth() / 2, 0) < 1.0f);
+}
+
+static void TestThreadedMatchesSerial() {
+	ThreadPool pool(3);
+	OcclusionBuffer serial;
+	OcclusionBuffer threaded;
+	const Matrix4 model = Matrix4::Rotation(30.0f, Vector3(0, 0, 1));
+	DrawWall(serial, nullptr, model);
+	DrawWall(threaded, &pool, model);
+
+	bool same = true;
+	for (int y = 0; y < serial.GetHeight(); ++y) {
+		for (int x = 0; x < serial.GetWidth(); ++x) {
+			same = same && serial.GetDepth(x, y) == threaded.GetDepth(x, y);
+		}
+	}
+	CHECK(same);
+	CHECK(!threaded.IsVisible(Box(Vector3(0, 0, -20), 1.0f)));
+}
+
+int main() {
+	TestEmptyBuffer();
+	TestWallDepths();
+	TestVisibility();
+	TestClippedOccluder();
+	TestThreadedMatchesSerial();
+	if (failures) {
+		std::cout << failures << " checks failed\n";
+		return 1;
+	}
+	std::cout << "All checks passed\n";
+	return 0;
+}
@@ -38,6 +38,56 @@
 #include <stdlib.h>
 #include <string.h>
 
+/*	core profiles don't have glGetString( GL_EXTENSIONS ), and list the
+	extensions one at a time through glGetStringi instead - and needn't
+	list the ones that were made part of the core before 3.0 at all	*/
+#define SOIL_NUM_EXTENSIONS					0x821D
+typedef const GLubyte* (APIENTRY * P_SOIL_GLGETSTRINGIPROC) (GLenum name, GLuint index);
+static const char* SOIL_core_extensions[] =
+{
+	"GL_ARB_texture_non_power_of_two",
+	"GL_ARB_texture_cube_map",
+	"GL_ARB_texture_rectangle",
+	NULL
+};
+static const char* SOIL_find_extension( const char* name )
+{
+	const char* all = (const char*)glGetString( GL_EXTENSIONS );
+	P_SOIL_GLGETSTRINGIPROC get_stringi = NULL;
+	GLint count = 0;
+	GLint i;
+	if( NULL != all )
+	{
+		return strstr( all, name );
+	}
+	for( i = 0; NULL != SOIL_core_extensions[i]; ++i )
+	{
+		if( 0 == strcmp( SOIL_core_extensions[i], name ) )
+		{
+			return SOIL_core_extensions[i];
+		}
+	}
+	#ifdef WIN32
+		get_stringi = (P_SOIL_GLGETSTRINGIPROC)wglGetProcAddress( "glGetStringi" );
+	#elif !defined(__APPLE__) && !defined(__APPLE_CC__)
+		get_stringi = (P_SOIL_GLGETSTRINGIPROC)glXGetProcAddressARB( (const GLubyte *)"glGetStringi" );
+	#endif
+	if( NULL == get_stringi )
+	{
+		return NULL;
+	}
+	glGetIntegerv( SOIL_NUM_EXTENSIONS, &count );
+	for( i = 0; i < count; ++i )
+	{
+		const char* ext = (const char*)get_stringi( GL_EXTENSIONS, (GLuint)i );
+		if( (NULL != ext) && (0 == strcmp( ext, name )) )
+		{
+			return ext;
+		}
+	}
+	return NULL;
+}
+
 /*	error reporting	*/
 char *result_string_pointer = "SOIL initialized";
 
@@ -1877,8 +1927,7 @@ int query_NPOT_capability( void )
 	{
 		/*	we haven't yet checked for the capability, do so	*/
 		if(
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_ARB_texture_non_power_of_two" ) )
+			(NULL == SOIL_find_extension( "GL_ARB_texture_non_power_of_two" ) )
 			)
 		{
 			/*	not there, flag the failure	*/
@@ -1900,14 +1949,11 @@ int query_tex_rectangle_capability( void )
 	{
 		/*	we haven't yet checked for the capability, do so	*/
 		if(
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_ARB_texture_rectangle" ) )
+			(NULL == SOIL_find_extension( "GL_ARB_texture_rectangle" ) )
 		&&
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_EXT_texture_rectangle" ) )
+			(NULL == SOIL_find_extension( "GL_EXT_texture_rectangle" ) )
 		&&
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_NV_texture_rectangle" ) )
+			(NULL == SOIL_find_extension( "GL_NV_texture_rectangle" ) )
 			)
 		{
 			/*	not there, flag the failure	*/
@@ -1929,11 +1975,9 @@ int query_cubemap_capability( void )
 	{
 		/*	we haven't yet checked for the capability, do so	*/
 		if(
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_ARB_texture_cube_map" ) )
+			(NULL == SOIL_find_extension( "GL_ARB_texture_cube_map" ) )
 		&&
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_EXT_texture_cube_map" ) )
+			(NULL == SOIL_find_extension( "GL_EXT_texture_cube_map" ) )
 			)
 		{
 			/*	not there, flag the failure	*/
@@ -1954,9 +1998,7 @@ int query_DXT_capability( void )
 	if( has_DXT_capability == SOIL_CAPABILITY_UNKNOWN )
 	{
 		/*	we haven't yet checked for the capability, do so	*/
-		if( NULL == strstr(
-				(char const*)glGetString( GL_EXTENSIONS ),
-				"GL_EXT_texture_compression_s3tc" ) )
+		if( NULL == SOIL_find_extension( "GL_EXT_texture_compression_s3tc" ) )
 		{
 			/*	not there, flag the failure	*/
 			has_DXT_capability = SOIL_CAPABILITY_NONE;
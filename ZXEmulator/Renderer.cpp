@@ -42,6 +42,7 @@ Renderer::Renderer(Window &parent) : OGLRenderer(parent)	{
 		return;
 	}
 
+	GLStateCache::BindVertexArray(0);
 	glGenBuffers(1, &colourUBO);
 	glBindBuffer(GL_ARRAY_BUFFER, colourUBO);
 	glBufferStorage(GL_ARRAY_BUFFER, sizeof(palette), 0, GL_DYNAMIC_STORAGE_BIT );
@@ -70,7 +71,7 @@ Renderer::~Renderer(void)	{
 }
 
 void Renderer::RenderScene() {
-	glUseProgram(zxShader->GetProgram());
+	BindShader(zxShader);
 
 	const GLuint uboSlot	= 0;
 	const GLuint pixelSlot	= 1;
@@ -85,9 +86,8 @@ void Renderer::RenderScene() {
 
 	glUniform2f(glGetUniformLocation(zxShader->GetProgram(), "screen"), width, height);
 
-	glBindVertexArray(emptyVAO);
+	GLStateCache::BindVertexArray(emptyVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindVertexArray(0);
 }
 
 void Renderer::UpdateScene(float dt) {
@@ -0,0 +1,82 @@
+#pragma once
+#include "Vector3.h"
+#include <algorithm>
+
+/*
+Axis aligned bounding box, stored as its minimum and maximum corners.
+*/
+struct AABB {
+	Vector3 min;
+	Vector3 max;
+
+	AABB(void) {}
+	AABB(const Vector3& min, const Vector3& max) : min(min), max(max) {}
+
+	static AABB FromSphere(const Vector3& centre, float radius) {
+		Vector3 r(radius, radius, radius);
+		return AABB(centre - r, centre + r);
+	}
+
+	static AABB Union(const AABB& a, const AABB& b) {
+		return AABB(
+			Vector3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+			Vector3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+	}
+
+	Vector3	GetCentre()		const { return (min + max) * 0.5f; }
+	Vector3	GetHalfSize()	const { return (max - min) * 0.5f; }
+
+	//Half the surface area - only ever compared, so the 2 can go
+	float	GetHalfArea() const {
+		Vector3 d = max - min;
+		return (d.x * d.y) + (d.y * d.z) + (d.z * d.x);
+	}
+
+	AABB	Expanded(float margin) const {
+		Vector3 m(margin, margin, margin);
+		return AABB(min - m, max + m);
+	}
+
+	bool	Contains(const AABB& b) const {
+		return	min.x <= b.min.x && min.y <= b.min.y && min.z <= b.min.z &&
+				max.x >= b.max.x && max.y >= b.max.y && max.z >= b.max.z;
+	}
+
+	bool	Overlaps(const AABB& b) const {
+		return	min.x <= b.max.x && max.x >= b.min.x &&
+				min.y <= b.max.y && max.y >= b.min.y &&
+				min.z <= b.max.z && max.z >= b.min.z;
+	}
+
+	bool	OverlapsSphere(const Vector3& centre, float radius) const {
+		Vector3 nearest(
+			std::max(min.x, std::min(centre.x, max.x)),
+			std::max(min.y, std::min(centre.y, max.y)),
+			std::max(min.z, std::min(centre.z, max.z)));
+		Vector3 d = nearest - centre;
+		return Vector3::Dot(d, d) <= radius * radius;
+	}
+
+	//Slab test - invDir is 1 / ray direction per axis. On a hit, 'tNear' is
+	//where the ray enters the box (or 0 if it starts inside)
+	bool	RayIntersects(const Vector3& origin, const Vector3& invDir,
+		float maxDist, float& tNear) const {
+		float t1 = (min.x - origin.x) * invDir.x;
+		float t2 = (max.x - origin.x) * invDir.x;
+		float tMin = std::min(t1, t2);
+		float tMax = std::max(t1, t2);
+
+		t1 = (min.y - origin.y) * invDir.y;
+		t2 = (max.y - origin.y) * invDir.y;
+		tMin = std::max(tMin, std::min(t1, t2));
+		tMax = std::min(tMax, std::max(t1, t2));
+
+		t1 = (min.z - origin.z) * invDir.z;
+		t2 = (max.z - origin.z) * invDir.z;
+		tMin = std::max(tMin, std::min(t1, t2));
+		tMax = std::min(tMax, std::max(t1, t2));
+
+		tNear = std::max(tMin, 0.0f);
+		return tMax >= tNear && tNear <= maxDist;
+	}
+};
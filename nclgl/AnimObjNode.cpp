@@ -6,7 +6,8 @@
 AnimObjNode::AnimObjNode(Shader* shader, Mesh* imesh, 
 						MeshAnimation* anim, MeshMaterial* mat, 
 						Vector3 pos, float scale, float yRot, 
-						bool move) : ShadedSceneNode(shader, imesh) {
+						bool move, const vector<GLuint>* textures)
+						: ShadedSceneNode(shader, imesh) {
 	this->anim = anim;
 	this->mat = mat;
 	this->pos = pos;
@@ -14,7 +15,10 @@ AnimObjNode::AnimObjNode(Shader* shader, Mesh* imesh,
 	this->yRot = yRot;
 	this->move = move;
 
-	for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
+	if (textures) {
+		matTextures = *textures;
+	}
+	else for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
 		const MeshMaterialEntry* matEntry = mat->GetMaterialForLayer(i);
 
 		const string* filename = nullptr;
@@ -26,6 +30,10 @@ AnimObjNode::AnimObjNode(Shader* shader, Mesh* imesh,
 	}
 	currentFrame = 0;
 	frameTime = 0.0f;
+	oneInfluenceShader = nullptr;
+	twoInfluenceShader = nullptr;
+	// bind pose bounds, with some room for the animation to move about in
+	SetBoundingRadius(mesh->GetBoundingRadius() * scale * 1.5f);
 }
 
 void AnimObjNode::Update(float dt) {
@@ -38,6 +46,10 @@ void AnimObjNode::Update(float dt) {
 		// move the object
 		//pos.z += 5;
 	}
+	// local to the parent - the world transform adds its translation
+	SetTransform(Matrix4::Translation(pos) *
+				Matrix4::Scale(Vector3(scale, scale, scale)) *
+				Matrix4::Rotation(yRot, Vector3(0, 1, 0)));
 }
 
 void AnimObjNode::Draw(const OGLRenderer& r) {
@@ -45,28 +57,82 @@ void AnimObjNode::Draw(const OGLRenderer& r) {
 	UpdateShaderMatrices();
 	const Matrix4* invBindPose = mesh->GetInverseBindPose();
 	const Matrix4* frameData = anim->GetJointData(currentFrame);
-	transform.ToIdentity();
-
-	transform = transform * Matrix4::Translation(
-				parent->GetTransform().GetPositionVector() + pos);
-	transform = transform * Matrix4::Scale(
-				Vector3(scale, scale, scale));
-	transform = transform * Matrix4::Rotation(
-				yRot, Vector3(0, 1, 0));
 
-	vector<Matrix4> frameMatrices;
+	// only needed for this draw, so it comes from the frame allocator
+	FrameVector<Matrix4> frameMatrices(r.GetFrameAllocator());
+	frameMatrices.reserve(mesh->GetJointCount());
 
 	for (unsigned int i = 0; i < mesh->GetJointCount(); ++i) {
 		frameMatrices.emplace_back(frameData[i] * invBindPose[i]);
 	}
-	int j = glGetUniformLocation(shader->GetProgram(), "joints");
+	// the renderer bound the node's shader, and will expect it back
+	Shader* bound = shader;
+
+	if (mesh->GetSkinPartitionCount() == 0) {
+		shader->SetUniformArray(UNIFORM("joints"), frameMatrices.data(),
+							(int)frameMatrices.size());
+
+		for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
+			if (GetSubMeshShader(i) != bound) {
+				BindSubMeshShader(i, bound);
+				bound->SetUniformArray(UNIFORM("joints"), frameMatrices.data(),
+							(int)frameMatrices.size());
+			}
+			GLStateCache::BindTexture(0, GL_TEXTURE_2D, matTextures[i]);
+			mesh->DrawSubMesh(i);
+		}
+		if (bound != shader) {
+			GLStateCache::UseProgram(shader->GetProgram());
+		}
+		return;
+	}
+
+	// each partition only sees the joints it references, in its own slots
+	FrameVector<Matrix4> partitionMatrices(r.GetFrameAllocator());
+	partitionMatrices.reserve(mesh->GetJointCount());
+	int boundSubMesh = -1;
+
+	for (int i = 0; i < mesh->GetSkinPartitionCount(); ++i) {
+		const SkinPartition& p = mesh->GetSkinPartition(i);
+
+		partitionMatrices.clear();
+		for (int joint : p.joints) {
+			partitionMatrices.emplace_back(frameMatrices[joint]);
+		}
+		BindSubMeshShader(p.subMesh, bound);
+		bound->SetUniformArray(UNIFORM("joints"), partitionMatrices.data(),
+							(int)partitionMatrices.size());
+
+		if (p.subMesh != boundSubMesh && p.subMesh >= 0 &&
+			p.subMesh < (int)matTextures.size()) {
+			GLStateCache::BindTexture(0, GL_TEXTURE_2D, matTextures[p.subMesh]);
+			boundSubMesh = p.subMesh;
+		}
+		mesh->DrawSkinPartition(i);
+	}
+	if (bound != shader) {
+		GLStateCache::UseProgram(shader->GetProgram());
+	}
+}
 
-	glUniformMatrix4fv(j, frameMatrices.size(), false,
-						(float*)frameMatrices.data());
+// the cheapest permutation that covers every vertex in the submesh
+Shader* AnimObjNode::GetSubMeshShader(int subMesh) const {
+	switch (mesh->GetSubMeshInfluenceCount(subMesh)) {
+	case 1:		return oneInfluenceShader ? oneInfluenceShader : shader;
+	case 2:		return twoInfluenceShader ? twoInfluenceShader : shader;
+	default:	return shader;
+	}
+}
 
-	for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, matTextures[i]);
-		mesh->DrawSubMesh(i);
+// the per-frame matrices and light are in uniform blocks every program
+// shares, so switching only needs this node's own uniforms setting
+void AnimObjNode::BindSubMeshShader(int subMesh, Shader*& bound) {
+	Shader* s = GetSubMeshShader(subMesh);
+	if (s == bound) {
+		return;
 	}
+	bound = s;
+	GLStateCache::UseProgram(s->GetProgram());
+	s->SetUniform(UNIFORM("modelMatrix"), GetWorldTransform());
+	s->SetUniform(UNIFORM("diffuseTex"), 0);
 }
@@ -9,13 +9,29 @@ class AnimObjNode :
     public ShadedSceneNode
 {
 public:
+	//If textures is given, it's used for the material's textures, instead
+	//of this node loading its own copies
 	AnimObjNode(Shader* shader, Mesh* mesh, MeshAnimation* anim,
 					MeshMaterial* mat, Vector3 pos, float scale, 
-											float yRot, bool move);
+											float yRot, bool move,
+					const vector<GLuint>* textures = nullptr);
+
+	// every instance is posed differently
+	bool CanInstance() const { return false; }
+
+	//Cheaper skinning permutations for submeshes whose vertices use at
+	//most one or two joints - the node's own shader is used for the rest
+	void SetInfluenceShaders(Shader* one, Shader* two) {
+		oneInfluenceShader = one;
+		twoInfluenceShader = two;
+	}
 protected:
 	void Draw(const OGLRenderer& r);
 	void Update(float dt);
 
+	Shader*	GetSubMeshShader(int subMesh) const;
+	void	BindSubMeshShader(int subMesh, Shader*& bound);
+
 	MeshAnimation*	anim;
 	MeshMaterial*	mat;
 	Vector3			pos;
@@ -25,5 +41,7 @@ protected:
 	vector<GLuint>	matTextures;
 	int				currentFrame;
 	float			frameTime;
+	Shader*			oneInfluenceShader;
+	Shader*			twoInfluenceShader;
 };
 
@@ -0,0 +1,430 @@
+#include "BVH.h"
+#include "Frustum.h"
+
+const int BVH::NULL_NODE;
+
+//How many buckets centroids get sorted into when looking for a split
+static const int SAH_BINS = 12;
+
+static float GetAxis(const Vector3& v, int axis) {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+BVH::BVH(float margin) {
+	root		= NULL_NODE;
+	freeList	= NULL_NODE;
+	proxyCount	= 0;
+	this->margin = margin;
+}
+
+int BVH::AllocateNode() {
+	int index;
+	if (freeList != NULL_NODE) {
+		index		= freeList;
+		freeList	= nodes[index].parent;
+	}
+	else {
+		index = (int)nodes.size();
+		nodes.emplace_back();
+	}
+	Node& n		= nodes[index];
+	n.parent	= NULL_NODE;
+	n.left		= NULL_NODE;
+	n.right		= NULL_NODE;
+	n.height	= 0;
+	n.node		= NULL;
+	return index;
+}
+
+void BVH::FreeNode(int index) {
+	nodes[index].parent	= freeList;
+	nodes[index].height	= -1;
+	freeList			= index;
+}
+
+BVH::ProxyID BVH::Insert(const AABB& bounds, SceneNode* node) {
+	int leaf = AllocateNode();
+	nodes[leaf].bounds	= bounds.Expanded(margin);
+	nodes[leaf].node	= node;
+	InsertLeaf(leaf);
+	++proxyCount;
+	return leaf;
+}
+
+void BVH::Remove(ProxyID id) {
+	RemoveLeaf(id);
+	FreeNode(id);
+	--proxyCount;
+}
+
+bool BVH::Update(ProxyID id, const AABB& bounds) {
+	if (nodes[id].bounds.Contains(bounds)) {
+		return false;
+	}
+	RemoveLeaf(id);
+	nodes[id].bounds = bounds.Expanded(margin);
+	InsertLeaf(id);
+	return true;
+}
+
+void BVH::Refit(ProxyID id, const AABB& bounds) {
+	nodes[id].bounds = bounds.Expanded(margin);
+	RefitAncestors(nodes[id].parent);
+}
+
+int BVH::GetHeight() const {
+	return root == NULL_NODE ? 0 : nodes[root].height;
+}
+
+void BVH::RefitAncestors(int index) {
+	while (index != NULL_NODE) {
+		Node& n = nodes[index];
+		const Node& l = nodes[n.left];
+		const Node& r = nodes[n.right];
+		n.bounds = AABB::Union(l.bounds, r.bounds);
+		n.height = 1 + std::max(l.height, r.height);
+		index = n.parent;
+	}
+}
+
+/*
+Walks down from the root, each step going towards whichever child would
+grow the least from taking the new leaf, and stopping when making a new
+sibling at the current node is cheaper than going any deeper.
+*/
+void BVH::InsertLeaf(int leaf) {
+	if (root == NULL_NODE) {
+		root = leaf;
+		nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+	const AABB leafBounds = nodes[leaf].bounds;
+
+	int index = root;
+	while (!nodes[index].IsLeaf()) {
+		const Node& n = nodes[index];
+
+		float area			= n.bounds.GetHalfArea();
+		float combinedArea	= AABB::Union(n.bounds, leafBounds).GetHalfArea();
+
+		//cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+		//every node below here grows by at least this much if we go down
+		float inheritance = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		int children[2] = { n.left, n.right };
+		for (int i = 0; i < 2; ++i) {
+			const Node& c = nodes[children[i]];
+			float grown = AABB::Union(c.bounds, leafBounds).GetHalfArea();
+			childCost[i] = c.IsLeaf() ? grown + inheritance
+				: (grown - c.bounds.GetHalfArea()) + inheritance;
+		}
+		if (cost < childCost[0] && cost < childCost[1]) {
+			break;
+		}
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	int sibling		= index;
+	int oldParent	= nodes[sibling].parent;
+	int newParent	= AllocateNode();
+
+	nodes[newParent].parent	= oldParent;
+	nodes[newParent].left	= sibling;
+	nodes[newParent].right	= leaf;
+	nodes[sibling].parent	= newParent;
+	nodes[leaf].parent		= newParent;
+
+	if (oldParent == NULL_NODE) {
+		root = newParent;
+	}
+	else if (nodes[oldParent].left == sibling) {
+		nodes[oldParent].left = newParent;
+	}
+	else {
+		nodes[oldParent].right = newParent;
+	}
+	RefitAncestors(newParent);
+}
+
+void BVH::RemoveLeaf(int leaf) {
+	if (leaf == root) {
+		root = NULL_NODE;
+		return;
+	}
+	int parent		= nodes[leaf].parent;
+	int grandParent	= nodes[parent].parent;
+	int sibling		= nodes[parent].left == leaf ?
+		nodes[parent].right : nodes[parent].left;
+
+	//the sibling takes the place of the parent
+	if (grandParent == NULL_NODE) {
+		root = sibling;
+		nodes[sibling].parent = NULL_NODE;
+	}
+	else {
+		if (nodes[grandParent].left == parent) {
+			nodes[grandParent].left = sibling;
+		}
+		else {
+			nodes[grandParent].right = sibling;
+		}
+		nodes[sibling].parent = grandParent;
+		RefitAncestors(grandParent);
+	}
+	FreeNode(parent);
+	nodes[leaf].parent = NULL_NODE;
+}
+
+void BVH::Rebuild() {
+	std::vector<int> leaves;
+	leaves.reserve(proxyCount);
+	for (int i = 0; i < (int)nodes.size(); ++i) {
+		if (nodes[i].height < 0) {
+			continue;
+		}
+		if (nodes[i].IsLeaf()) {
+			leaves.emplace_back(i);
+		}
+		else {
+			FreeNode(i);
+		}
+	}
+	root = leaves.empty() ? NULL_NODE :
+		BuildRange(leaves, 0, (int)leaves.size(), NULL_NODE);
+}
+
+/*
+Top down build - sorts the leaves in [begin, end) into buckets along the
+longest axis of their centres, then splits between whichever two buckets
+give the lowest surface area cost. If the centres are all on top of each
+other there's nothing to go on, so it just splits the range in half.
+*/
+int BVH::BuildRange(std::vector<int>& leaves, int begin, int end, int parent) {
+	if (end - begin == 1) {
+		nodes[leaves[begin]].parent = parent;
+		return leaves[begin];
+	}
+
+	AABB centres(nodes[leaves[begin]].bounds.GetCentre(),
+		nodes[leaves[begin]].bounds.GetCentre());
+	for (int i = begin + 1; i < end; ++i) {
+		Vector3 c = nodes[leaves[i]].bounds.GetCentre();
+		centres = AABB::Union(centres, AABB(c, c));
+	}
+	Vector3 extent = centres.max - centres.min;
+	int axis = 0;
+	if (extent.y > extent.x) {
+		axis = 1;
+	}
+	if (extent.z > GetAxis(extent, axis)) {
+		axis = 2;
+	}
+	const float axisMin		= GetAxis(centres.min, axis);
+	const float axisExtent	= GetAxis(extent, axis);
+
+	int mid = (begin + end) / 2;
+	if (axisExtent > 0.0f) {
+		auto binOf = [&](int leaf) {
+			float c = GetAxis(nodes[leaf].bounds.GetCentre(), axis);
+			int b = (int)(SAH_BINS * ((c - axisMin) / axisExtent));
+			return std::min(b, SAH_BINS - 1);
+		};
+
+		int		binCount[SAH_BINS] = { 0 };
+		AABB	binBounds[SAH_BINS];
+		for (int i = begin; i < end; ++i) {
+			int b = binOf(leaves[i]);
+			binBounds[b] = binCount[b] ? AABB::Union(binBounds[b], nodes[leaves[i]].bounds)
+				: nodes[leaves[i]].bounds;
+			++binCount[b];
+		}
+
+		//sweep from the right to get the cost of everything above each split
+		float	rightCost[SAH_BINS];
+		AABB	running;
+		int		count = 0;
+		for (int b = SAH_BINS - 1; b > 0; --b) {
+			if (binCount[b]) {
+				running = count ? AABB::Union(running, binBounds[b]) : binBounds[b];
+				count += binCount[b];
+			}
+			rightCost[b] = count ? running.GetHalfArea() * count : 0.0f;
+		}
+
+		float	bestCost	= -1.0f;
+		int		bestSplit	= 0;
+		count = 0;
+		for (int b = 0; b < SAH_BINS - 1; ++b) {
+			if (binCount[b]) {
+				running = count ? AABB::Union(running, binBounds[b]) : binBounds[b];
+				count += binCount[b];
+			}
+			if (count == 0 || count == end - begin) {
+				continue;
+			}
+			float cost = running.GetHalfArea() * count + rightCost[b + 1];
+			if (bestCost < 0.0f || cost < bestCost) {
+				bestCost	= cost;
+				bestSplit	= b;
+			}
+		}
+		if (bestCost >= 0.0f) {
+			mid = (int)(std::partition(leaves.begin() + begin, leaves.begin() + end,
+				[&](int leaf) { return binOf(leaf) <= bestSplit; }) - leaves.begin());
+		}
+	}
+
+	int index = AllocateNode();
+	nodes[index].parent = parent;
+	int left	= BuildRange(leaves, begin, mid, index);
+	int right	= BuildRange(leaves, mid, end, index);
+
+	Node& n		= nodes[index];
+	n.left		= left;
+	n.right		= right;
+	n.bounds	= AABB::Union(nodes[left].bounds, nodes[right].bounds);
+	n.height	= 1 + std::max(nodes[left].height, nodes[right].height);
+	return index;
+}
+
+void BVH::CollectLeaves(int index, std::vector<SceneNode*>& out) const {
+	//recursive, as this runs in the middle of a query that's using the stack
+	const Node& n = nodes[index];
+	if (n.IsLeaf()) {
+		out.emplace_back(n.node);
+		return;
+	}
+	CollectLeaves(n.left, out);
+	CollectLeaves(n.right, out);
+}
+
+void BVH::QueryFrustum(const Frustum& f, std::vector<SceneNode*>& out) const {
+	if (root == NULL_NODE) {
+		return;
+	}
+	std::vector<int>& stack = queryStack;
+	stack.assign(1, root);
+	while (!stack.empty()) {
+		int index = stack.back();
+		stack.pop_back();
+		const Node& n = nodes[index];
+
+		Frustum::Containment c = f.ClassifyBox(n.bounds);
+		if (c == Frustum::OUTSIDE) {
+			continue;
+		}
+		if (c == Frustum::INSIDE) {
+			CollectLeaves(index, out);
+		}
+		else if (n.IsLeaf()) {
+			out.emplace_back(n.node);
+		}
+		else {
+			stack.emplace_back(n.left);
+			stack.emplace_back(n.right);
+		}
+	}
+}
+
+void BVH::QuerySphere(const Vector3& centre, float radius,
+	std::vector<SceneNode*>& out) const {
+	if (root == NULL_NODE) {
+		return;
+	}
+	std::vector<int>& stack = queryStack;
+	stack.assign(1, root);
+	while (!stack.empty()) {
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+		if (!n.bounds.OverlapsSphere(centre, radius)) {
+			continue;
+		}
+		if (n.IsLeaf()) {
+			out.emplace_back(n.node);
+		}
+		else {
+			stack.emplace_back(n.left);
+			stack.emplace_back(n.right);
+		}
+	}
+}
+
+void BVH::QueryBox(const AABB& box, std::vector<SceneNode*>& out) const {
+	if (root == NULL_NODE) {
+		return;
+	}
+	std::vector<int>& stack = queryStack;
+	stack.assign(1, root);
+	while (!stack.empty()) {
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+		if (!n.bounds.Overlaps(box)) {
+			continue;
+		}
+		if (n.IsLeaf()) {
+			out.emplace_back(n.node);
+		}
+		else {
+			stack.emplace_back(n.left);
+			stack.emplace_back(n.right);
+		}
+	}
+}
+
+/*
+Visits the nearer child first, and skips anything that starts further away
+than the closest hit found so far.
+*/
+SceneNode* BVH::RayCast(const Vector3& origin, const Vector3& dir,
+	float maxDist, float& hitDist) const {
+	SceneNode* hit = NULL;
+	if (root == NULL_NODE) {
+		return hit;
+	}
+	Vector3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+	float t;
+	if (!nodes[root].bounds.RayIntersects(origin, invDir, maxDist, t)) {
+		return hit;
+	}
+	hitDist = maxDist;
+
+	std::vector<RayEntry>& stack = rayStack;
+	stack.assign(1, RayEntry{ root, t });
+	while (!stack.empty()) {
+		RayEntry e = stack.back();
+		stack.pop_back();
+		if (e.t > hitDist) {
+			continue;
+		}
+		const Node& n = nodes[e.index];
+		if (n.IsLeaf()) {
+			hit		= n.node;
+			hitDist	= e.t;
+			continue;
+		}
+		float tl, tr;
+		bool hitLeft	= nodes[n.left].bounds.RayIntersects(origin, invDir, hitDist, tl);
+		bool hitRight	= nodes[n.right].bounds.RayIntersects(origin, invDir, hitDist, tr);
+		//pushed furthest first, so the nearest gets popped next
+		if (hitLeft && hitRight) {
+			if (tl < tr) {
+				stack.emplace_back(RayEntry{ n.right, tr });
+				stack.emplace_back(RayEntry{ n.left, tl });
+			}
+			else {
+				stack.emplace_back(RayEntry{ n.left, tl });
+				stack.emplace_back(RayEntry{ n.right, tr });
+			}
+		}
+		else if (hitLeft) {
+			stack.emplace_back(RayEntry{ n.left, tl });
+		}
+		else if (hitRight) {
+			stack.emplace_back(RayEntry{ n.right, tr });
+		}
+	}
+	return hit;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "AABB.h"
+#include <vector>
+
+class SceneNode;
+class Frustum;
+
+/*
+Dynamic bounding volume hierarchy over scene nodes, for answering spatial
+queries without walking the whole scene graph.
+
+Each node is given a proxy, which is a leaf holding a slightly 'fat' copy
+of its bounds - small movements that stay within the fat box then cost
+nothing, and anything moving further is taken out and reinserted, picking
+the spot in the tree that adds the least surface area. Lots of reinserts
+slowly make the tree worse, so Rebuild can be called to build the whole
+thing again from scratch, splitting by the surface area heuristic.
+*/
+class BVH {
+public:
+	typedef int ProxyID;
+	static const int NULL_NODE = -1;
+
+	//Proxies are given bounds 'margin' bigger than asked for on each side
+	BVH(float margin = 0.0f);
+	~BVH(void) {};
+
+	ProxyID	Insert(const AABB& bounds, SceneNode* node);
+	void	Remove(ProxyID id);
+	//Returns true if the proxy had to be reinserted
+	bool	Update(ProxyID id, const AABB& bounds);
+	//Cheaper than Update for small moves, as the leaf stays where it is and
+	//only its ancestors are grown or shrunk to fit - but it doesn't improve
+	//the tree, so rebuild every now and again
+	void	Refit(ProxyID id, const AABB& bounds);
+
+	void	Rebuild();
+
+	SceneNode*	GetNode(ProxyID id)			const { return nodes[id].node; }
+	const AABB&	GetFatBounds(ProxyID id)	const { return nodes[id].bounds; }
+
+	size_t	GetProxyCount()	const { return proxyCount; }
+	int		GetHeight()		const;
+
+	void	QueryFrustum(const Frustum& f, std::vector<SceneNode*>& out) const;
+	void	QuerySphere(const Vector3& centre, float radius, std::vector<SceneNode*>& out) const;
+	void	QueryBox(const AABB& box, std::vector<SceneNode*>& out) const;
+
+	//Closest proxy whose bounds the ray passes through, or NULL. Only tests
+	//bounds, not the mesh inside them
+	SceneNode*	RayCast(const Vector3& origin, const Vector3& dir,
+		float maxDist, float& hitDist) const;
+
+protected:
+	struct Node {
+		AABB		bounds;
+		int			parent;
+		int			left;
+		int			right;
+		int			height;	//0 for leaves
+		SceneNode*	node;	//NULL for internal nodes
+
+		bool IsLeaf() const { return left == NULL_NODE; }
+	};
+
+	int		AllocateNode();
+	void	FreeNode(int index);
+
+	void	InsertLeaf(int leaf);
+	void	RemoveLeaf(int leaf);
+	void	RefitAncestors(int index);
+	void	CollectLeaves(int index, std::vector<SceneNode*>& out) const;
+
+	int		BuildRange(std::vector<int>& leaves, int begin, int end, int parent);
+
+	std::vector<Node>	nodes;
+	int					root;
+	int					freeList;	//chained through Node::parent
+	size_t				proxyCount;
+	float				margin;
+
+	//Kept between queries so they don't allocate once they've warmed up -
+	//which does mean one BVH can't be queried from two threads at once
+	struct RayEntry {
+		int		index;
+		float	t;
+	};
+	mutable std::vector<int>		queryStack;
+	mutable std::vector<RayEntry>	rayStack;
+};
@@ -1,8 +1,11 @@
 #include "Camera.h"
+#ifdef _WIN32
 #include "Window.h"
+#endif
 #include <algorithm>
 
 void Camera::UpdateCamera(float dt) {
+#ifdef _WIN32	//No window means no input, so the camera stays put
 	pitch	-= (Window::GetMouse()->GetRelativePosition().y);
 	yaw		-= (Window::GetMouse()->GetRelativePosition().x);
 
@@ -43,6 +46,7 @@ void Camera::UpdateCamera(float dt) {
 	if (Window::GetKeyboard()->KeyDown(KEYBOARD_SPACE)) {
 		position.y -= speed;
 	}
+#endif
 }
 
 Matrix4 Camera::BuildViewMatrix() {
@@ -43,6 +43,7 @@ ComputeShader::ComputeShader(const std::string& filename) {
 ComputeShader::~ComputeShader(void) {
 	glDetachShader(programID, shaderID);
 	glDeleteShader(shaderID);
+	GLStateCache::ForgetProgram(programID);
 	glDeleteProgram(programID);
 }
 
@@ -51,9 +52,9 @@ void ComputeShader::Dispatch(unsigned int x, unsigned int y, unsigned int z) con
 }
 
 void ComputeShader::Bind()		const {
-	glUseProgram(programID);
+	GLStateCache::UseProgram(programID);
 }
 
 void ComputeShader::Unbind()	const {
-	glUseProgram(0);
+	GLStateCache::UseProgram(0);
 }
\ No newline at end of file
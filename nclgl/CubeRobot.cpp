@@ -6,6 +6,7 @@ CubeRobot::CubeRobot(Mesh * cube) {
 	SceneNode * body = new SceneNode(cube, Vector4(1, 0, 0, 1)); //Red!
 	body->SetModelScale(Vector3(10, 15, 5));
 	body->SetTransform(Matrix4::Translation(Vector3(0, 35, 0)));
+	body->ReserveChildren(5);
 	AddChild(body);
 	
 	head = new SceneNode(cube, Vector4(0, 1, 0, 1)); //Green!
@@ -44,8 +45,8 @@ CubeRobot::CubeRobot(Mesh * cube) {
 }
 
 void CubeRobot::Update(float dt) {
-	transform = transform * Matrix4::Rotation
-							(30.0f * dt, Vector3(0, 1, 0));
+	SetTransform(GetTransform() * Matrix4::Rotation
+							(30.0f * dt, Vector3(0, 1, 0)));
 
 	head->SetTransform(head->GetTransform() * Matrix4::Rotation
 							(-30.0f * dt, Vector3(0, 1, 0)));
@@ -1,5 +1,5 @@
 #pragma once
-#include "..\nclgl\scenenode.h"
+#include "../nclgl/SceneNode.h"
 
 class CubeRobot : public SceneNode {
 public:
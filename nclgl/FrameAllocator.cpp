@@ -0,0 +1,66 @@
+#include "FrameAllocator.h"
+#include <algorithm>
+#include <cstdint>
+
+FrameAllocator::FrameAllocator(size_t bytesPerFrame) {
+	for (Buffer& b : buffers) {
+		b.data			= new char[bytesPerFrame];
+		b.size			= bytesPerFrame;
+		b.used			= 0;
+		b.overflowBytes	= 0;
+	}
+	current = 0;
+
+	lastFrameHeapAllocations	= 0;
+	lastFrameBytesUsed			= 0;
+}
+
+FrameAllocator::~FrameAllocator(void) {
+	for (Buffer& b : buffers) {
+		for (void* p : b.overflow) {
+			delete[] (char*)p;
+		}
+		delete[] b.data;
+	}
+}
+
+void* FrameAllocator::Allocate(size_t bytes, size_t alignment) {
+	Buffer& b = buffers[current];
+
+	uintptr_t start		= (uintptr_t)(b.data + b.used);
+	uintptr_t aligned	= (start + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+	size_t	  end		= (size_t)(aligned - (uintptr_t)b.data) + bytes;
+
+	if (end <= b.size) {
+		b.used = end;
+		return (void*)aligned;
+	}
+	//Out of room - the heap will have to do for now
+	char* block = new char[bytes + alignment];
+	b.overflow.push_back(block);
+	b.overflowBytes += bytes + alignment;
+	return (void*)(((uintptr_t)block + (alignment - 1)) & ~(uintptr_t)(alignment - 1));
+}
+
+void FrameAllocator::BeginFrame() {
+	lastFrameHeapAllocations	= buffers[current].overflow.size();
+	lastFrameBytesUsed			= buffers[current].used + buffers[current].overflowBytes;
+
+	current = 1 - current;
+	Buffer& b = buffers[current];
+
+	for (void* p : b.overflow) {
+		delete[] (char*)p;
+	}
+	b.overflow.clear();
+
+	//Make it big enough for everything it was asked for last time around
+	if (b.overflowBytes > 0) {
+		size_t needed = b.used + b.overflowBytes;
+		delete[] b.data;
+		b.size = std::max(b.size * 2, needed);
+		b.data = new char[b.size];
+	}
+	b.used			= 0;
+	b.overflowBytes	= 0;
+}
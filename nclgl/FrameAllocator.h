@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/*
+Linear allocator for data that only needs to live for a frame or so. Each
+allocation just bumps an offset into a big buffer, freeing does nothing,
+and the whole lot is thrown away at once when the buffer is reused.
+
+There are two buffers, swapped by BeginFrame, so anything allocated during
+one frame is still valid all through the next - handy for anything that
+gets read back a frame late.
+
+If a buffer runs out, allocations fall back to the heap (and are counted),
+and the buffer is grown to fit the next time it's reset, so a scene that
+doesn't change much stops hitting the heap after a frame or two.
+*/
+class FrameAllocator {
+public:
+	FrameAllocator(size_t bytesPerFrame = 1 << 20);
+	~FrameAllocator(void);
+
+	void*	Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	void	BeginFrame();
+
+	//Allocations that didn't fit, so had to come from the heap instead
+	size_t	GetHeapAllocations()			const { return buffers[current].overflow.size(); }
+	size_t	GetLastFrameHeapAllocations()	const { return lastFrameHeapAllocations; }
+	size_t	GetLastFrameBytesUsed()			const { return lastFrameBytesUsed; }
+	size_t	GetCapacity()					const { return buffers[current].size; }
+
+protected:
+	struct Buffer {
+		char*				data;
+		size_t				size;
+		size_t				used;
+		std::vector<void*>	overflow;
+		size_t				overflowBytes;
+	};
+
+	Buffer	buffers[2];
+	int		current;
+
+	size_t	lastFrameHeapAllocations;
+	size_t	lastFrameBytesUsed;
+};
+
+/*
+Lets STL containers take their memory from a FrameAllocator. Containers
+using one must not outlive the frame after the one they were filled in.
+*/
+template <class T>
+class FrameAdaptor {
+public:
+	typedef T value_type;
+
+	FrameAdaptor(FrameAllocator& a) : allocator(&a) {}
+	template <class U>
+	FrameAdaptor(const FrameAdaptor<U>& other) : allocator(other.allocator) {}
+
+	T*		allocate(size_t n) {
+		return (T*)allocator->Allocate(n * sizeof(T), alignof(T));
+	}
+	void	deallocate(T* p, size_t n) {}
+
+	template <class U>
+	bool operator==(const FrameAdaptor<U>& other) const { return allocator == other.allocator; }
+	template <class U>
+	bool operator!=(const FrameAdaptor<U>& other) const { return allocator != other.allocator; }
+
+	FrameAllocator* allocator;
+};
+
+template <class T>
+using FrameVector = std::vector<T, FrameAdaptor<T>>;
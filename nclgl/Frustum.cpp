@@ -2,17 +2,210 @@
 #include "SceneNode.h"
 #include "Matrix4.h"
 
+#if defined(__AVX__)
+#define FRUSTUM_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE
+#endif
+#if defined(FRUSTUM_AVX) || defined(FRUSTUM_SSE)
+#include <immintrin.h>
+#endif
+
 bool Frustum::InsideFrustum(SceneNode& n) {
+	const Vector3	position	= n.GetWorldTransform().GetPositionVector();
+	const float		radius		= n.GetBoundingRadius();
 	for (int p = 0; p < 6; ++p) {
-		if (!planes[p].SphereInPlane(
-			n.GetWorldTransform().GetPositionVector(), 
-			n.GetBoundingRadius())) {
+		if (!planes[p].SphereInPlane(position, radius)) {
 			return false;
 		}
 	}
 	return true;
 }
 
+int Frustum::GetBatchWidth() {
+#if defined(FRUSTUM_AVX)
+	return 8;
+#elif defined(FRUSTUM_SSE)
+	return 4;
+#else
+	return 1;
+#endif
+}
+
+//Every lane whose bit is set in 'mask' is visible - write out their indices
+static size_t WriteVisible(int mask, unsigned int base, unsigned int* visible) {
+	size_t written = 0;
+	while (mask) {
+		int lane = 0;
+		while (!(mask & (1 << lane))) {
+			++lane;
+		}
+		visible[written++] = base + lane;
+		mask &= mask - 1;
+	}
+	return written;
+}
+
+/*
+Each object gets its signed distance to every plane, and stays visible as
+long as none of those are at or below -extent - where the extent is the
+radius for a sphere, or how far the box reaches along the plane normal.
+*/
+size_t Frustum::CullSpheres(const float* x, const float* y, const float* z,
+	const float* radius, size_t count, unsigned int* visible) const {
+	size_t i		= 0;
+	size_t written	= 0;
+#if defined(FRUSTUM_AVX)
+	for (; i + 8 <= count; i += 8) {
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 pz = _mm256_loadu_ps(z + i);
+		__m256 nr = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+		__m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			const Vector3 n = planes[p].GetNormal();
+			__m256 d = _mm256_add_ps(_mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(n.x)), _mm256_mul_ps(py, _mm256_set1_ps(n.y))),
+				_mm256_mul_ps(pz, _mm256_set1_ps(n.z))), _mm256_set1_ps(planes[p].GetDistance()));
+			in = _mm256_and_ps(in, _mm256_cmp_ps(d, nr, _CMP_GT_OQ));
+		}
+		written += WriteVisible(_mm256_movemask_ps(in), (unsigned int)i, visible + written);
+	}
+#endif
+#if defined(FRUSTUM_SSE)
+	for (; i + 4 <= count; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+		__m128 nr = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			const Vector3 n = planes[p].GetNormal();
+			__m128 d = _mm_add_ps(_mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(n.x)), _mm_mul_ps(py, _mm_set1_ps(n.y))),
+				_mm_mul_ps(pz, _mm_set1_ps(n.z))), _mm_set1_ps(planes[p].GetDistance()));
+			in = _mm_and_ps(in, _mm_cmpgt_ps(d, nr));
+		}
+		written += WriteVisible(_mm_movemask_ps(in), (unsigned int)i, visible + written);
+	}
+#endif
+	for (; i < count; ++i) {
+		bool in = true;
+		for (int p = 0; p < 6 && in; ++p) {
+			in = planes[p].SphereInPlane(Vector3(x[i], y[i], z[i]), radius[i]);
+		}
+		if (in) {
+			visible[written++] = (unsigned int)i;
+		}
+	}
+	return written;
+}
+
+size_t Frustum::CullBoxes(const float* x, const float* y, const float* z,
+	const float* halfX, const float* halfY, const float* halfZ,
+	size_t count, unsigned int* visible) const {
+	size_t i		= 0;
+	size_t written	= 0;
+#if defined(FRUSTUM_AVX)
+	for (; i + 8 <= count; i += 8) {
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 pz = _mm256_loadu_ps(z + i);
+		__m256 hx = _mm256_loadu_ps(halfX + i);
+		__m256 hy = _mm256_loadu_ps(halfY + i);
+		__m256 hz = _mm256_loadu_ps(halfZ + i);
+		__m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			const Vector3 n = planes[p].GetNormal();
+			__m256 d = _mm256_add_ps(_mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(n.x)), _mm256_mul_ps(py, _mm256_set1_ps(n.y))),
+				_mm256_mul_ps(pz, _mm256_set1_ps(n.z))), _mm256_set1_ps(planes[p].GetDistance()));
+			__m256 reach = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(hx, _mm256_set1_ps(fabs(n.x))),
+							  _mm256_mul_ps(hy, _mm256_set1_ps(fabs(n.y)))),
+				_mm256_mul_ps(hz, _mm256_set1_ps(fabs(n.z))));
+			in = _mm256_and_ps(in, _mm256_cmp_ps(
+				_mm256_add_ps(d, reach), _mm256_setzero_ps(), _CMP_GT_OQ));
+		}
+		written += WriteVisible(_mm256_movemask_ps(in), (unsigned int)i, visible + written);
+	}
+#endif
+#if defined(FRUSTUM_SSE)
+	for (; i + 4 <= count; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+		__m128 hx = _mm_loadu_ps(halfX + i);
+		__m128 hy = _mm_loadu_ps(halfY + i);
+		__m128 hz = _mm_loadu_ps(halfZ + i);
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			const Vector3 n = planes[p].GetNormal();
+			__m128 d = _mm_add_ps(_mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(n.x)), _mm_mul_ps(py, _mm_set1_ps(n.y))),
+				_mm_mul_ps(pz, _mm_set1_ps(n.z))), _mm_set1_ps(planes[p].GetDistance()));
+			__m128 reach = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(hx, _mm_set1_ps(fabs(n.x))),
+						   _mm_mul_ps(hy, _mm_set1_ps(fabs(n.y)))),
+				_mm_mul_ps(hz, _mm_set1_ps(fabs(n.z))));
+			in = _mm_and_ps(in, _mm_cmpgt_ps(_mm_add_ps(d, reach), _mm_setzero_ps()));
+		}
+		written += WriteVisible(_mm_movemask_ps(in), (unsigned int)i, visible + written);
+	}
+#endif
+	for (; i < count; ++i) {
+		bool in = true;
+		for (int p = 0; p < 6 && in; ++p) {
+			const Vector3 n = planes[p].GetNormal();
+			float d = n.x * x[i] + n.y * y[i] + n.z * z[i] + planes[p].GetDistance();
+			float reach = fabs(n.x) * halfX[i] + fabs(n.y) * halfY[i] + fabs(n.z) * halfZ[i];
+			in = d + reach > 0.0f;
+		}
+		if (in) {
+			visible[written++] = (unsigned int)i;
+		}
+	}
+	return written;
+}
+
+Frustum::Containment Frustum::ClassifySphere(const Vector3& position,
+	float radius) const {
+	Containment result = INSIDE;
+	for (int p = 0; p < 6; ++p) {
+		float dist = Vector3::Dot(position, planes[p].GetNormal()) +
+			planes[p].GetDistance();
+		if (dist <= -radius) {
+			return OUTSIDE;
+		}
+		if (dist < radius) {
+			result = INTERSECTING;
+		}
+	}
+	return result;
+}
+
+Frustum::Containment Frustum::ClassifyBox(const AABB& box) const {
+	Vector3 centre		= box.GetCentre();
+	Vector3 halfSize	= box.GetHalfSize();
+
+	Containment result = INSIDE;
+	for (int p = 0; p < 6; ++p) {
+		Vector3 n = planes[p].GetNormal();
+		//how far the box reaches along the plane normal
+		float reach = halfSize.x * fabs(n.x) + halfSize.y * fabs(n.y) +
+			halfSize.z * fabs(n.z);
+		float dist = Vector3::Dot(centre, n) + planes[p].GetDistance();
+		if (dist <= -reach) {
+			return OUTSIDE;
+		}
+		if (dist < reach) {
+			result = INTERSECTING;
+		}
+	}
+	return result;
+}
+
 void Frustum::FromMatrix(const Matrix4& mat) {
 	Vector3 xaxis = Vector3(mat.values[0], mat.values[4], mat.values[8]);
 	Vector3 yaxis = Vector3(mat.values[1], mat.values[5], mat.values[9]);
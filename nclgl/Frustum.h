@@ -1,16 +1,45 @@
 #pragma once
 #include "Plane.h"
+#include "AABB.h"
 
 class SceneNode;
 class Matrix4;
 
 class Frustum {
 public :
+	enum Containment {
+		OUTSIDE,
+		INTERSECTING,
+		INSIDE
+	};
+
 	Frustum(void) {};
 	~Frustum(void) {};
 
 	void FromMatrix(const Matrix4& mvp);
 	bool InsideFrustum(SceneNode& n);
+	//Whether a whole node subtree can be thrown away, or kept without
+	//testing any of its children
+	Containment ClassifySphere(const Vector3& position, float radius) const;
+	Containment ClassifyBox(const AABB& box) const;
+
+	/*
+	Batched versions of the above, for culling lots of objects at once.
+	Inputs are structure-of-arrays, and the indices of everything that
+	isn't entirely outside the frustum are written out, in order, to
+	'visible' - which needs room for 'count' of them. Returns how many
+	were written. Tests 8 at a time with AVX, 4 with SSE, or one at a
+	time if neither is available.
+	*/
+	size_t	CullSpheres(const float* x, const float* y, const float* z,
+				const float* radius, size_t count, unsigned int* visible) const;
+	//Boxes are given as their centres, and half their size on each axis
+	size_t	CullBoxes(const float* x, const float* y, const float* z,
+				const float* halfX, const float* halfY, const float* halfZ,
+				size_t count, unsigned int* visible) const;
+
+	//How many objects the batched functions test at once
+	static int GetBatchWidth();
 
 protected:
 	Plane planes[6];
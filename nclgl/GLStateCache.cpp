@@ -0,0 +1,192 @@
+#include "GLStateCache.h"
+
+GLuint	GLStateCache::program			= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::vertexArray		= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::drawFramebuffer	= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::readFramebuffer	= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::defaultFramebuffer	= 0;
+GLuint	GLStateCache::activeUnit		= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::textures[MAX_TEXTURE_UNITS][2];
+GLuint	GLStateCache::capabilities[CAP_MAX];
+GLuint	GLStateCache::depthMask			= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::depthFunc			= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::blendSource		= GLStateCache::UNKNOWN;
+GLuint	GLStateCache::blendDest			= GLStateCache::UNKNOWN;
+
+size_t	GLStateCache::frameIssued		= 0;
+size_t	GLStateCache::frameElided		= 0;
+size_t	GLStateCache::lastFrameIssued	= 0;
+size_t	GLStateCache::lastFrameElided	= 0;
+
+bool GLStateCache::Change(GLuint& shadow, GLuint value) {
+	if (shadow == value) {
+		++frameElided;
+		return false;
+	}
+	shadow = value;
+	++frameIssued;
+	return true;
+}
+
+int GLStateCache::GetCapability(GLenum cap) {
+	switch (cap) {
+		case GL_BLEND:			return CAP_BLEND;
+		case GL_DEPTH_TEST:		return CAP_DEPTH_TEST;
+		case GL_CULL_FACE:		return CAP_CULL_FACE;
+		case GL_STENCIL_TEST:	return CAP_STENCIL_TEST;
+	}
+	return -1;
+}
+
+int GLStateCache::GetTextureTarget(GLenum target) {
+	switch (target) {
+		case GL_TEXTURE_2D:			return 0;
+		case GL_TEXTURE_CUBE_MAP:	return 1;
+	}
+	return -1;
+}
+
+void GLStateCache::UseProgram(GLuint p) {
+	if (Change(program, p)) {
+		glUseProgram(p);
+	}
+}
+
+void GLStateCache::BindVertexArray(GLuint vao) {
+	if (Change(vertexArray, vao)) {
+		glBindVertexArray(vao);
+	}
+}
+
+void GLStateCache::BindFramebuffer(GLenum target, GLuint fbo) {
+	if (fbo == 0) {
+		fbo = defaultFramebuffer;
+	}
+	if (target == GL_FRAMEBUFFER) {
+		if (drawFramebuffer == fbo && readFramebuffer == fbo) {
+			++frameElided;
+			return;
+		}
+		drawFramebuffer = fbo;
+		readFramebuffer = fbo;
+		++frameIssued;
+		glBindFramebuffer(target, fbo);
+	}
+	else if (Change(target == GL_READ_FRAMEBUFFER ? readFramebuffer :
+		drawFramebuffer, fbo)) {
+		glBindFramebuffer(target, fbo);
+	}
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+	int t = GetTextureTarget(target);
+	if (t < 0 || unit >= MAX_TEXTURE_UNITS) {
+		if (Change(activeUnit, unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+		++frameIssued;
+		glBindTexture(target, texture);
+		return;
+	}
+	if (textures[unit][t] == texture) {
+		++frameElided;
+		return;
+	}
+	if (Change(activeUnit, unit)) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	Change(textures[unit][t], texture);
+	glBindTexture(target, texture);
+}
+
+void GLStateCache::SetEnabled(GLenum cap, bool enabled) {
+	int c = GetCapability(cap);
+	if (c < 0) {
+		++frameIssued;
+		enabled ? glEnable(cap) : glDisable(cap);
+	}
+	else if (Change(capabilities[c], enabled ? 1 : 0)) {
+		enabled ? glEnable(cap) : glDisable(cap);
+	}
+}
+
+void GLStateCache::DepthMask(bool write) {
+	if (Change(depthMask, write ? 1 : 0)) {
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::DepthFunc(GLenum func) {
+	if (Change(depthFunc, func)) {
+		glDepthFunc(func);
+	}
+}
+
+void GLStateCache::BlendFunc(GLenum source, GLenum dest) {
+	if (blendSource == source && blendDest == dest) {
+		++frameElided;
+		return;
+	}
+	blendSource	= source;
+	blendDest	= dest;
+	++frameIssued;
+	glBlendFunc(source, dest);
+}
+
+//Deleting something that's bound puts 0 back in its place
+void GLStateCache::ForgetProgram(GLuint p) {
+	if (program == p) {
+		program = UNKNOWN;
+	}
+}
+
+void GLStateCache::ForgetVertexArray(GLuint vao) {
+	if (vertexArray == vao) {
+		vertexArray = 0;
+	}
+}
+
+void GLStateCache::ForgetFramebuffer(GLuint fbo) {
+	if (drawFramebuffer == fbo) {
+		drawFramebuffer = 0;
+	}
+	if (readFramebuffer == fbo) {
+		readFramebuffer = 0;
+	}
+}
+
+void GLStateCache::ForgetTexture(GLuint texture) {
+	for (GLuint i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+		for (int t = 0; t < 2; ++t) {
+			if (textures[i][t] == texture) {
+				textures[i][t] = 0;
+			}
+		}
+	}
+}
+
+void GLStateCache::Invalidate() {
+	program			= UNKNOWN;
+	vertexArray		= UNKNOWN;
+	drawFramebuffer	= UNKNOWN;
+	readFramebuffer	= UNKNOWN;
+	activeUnit		= UNKNOWN;
+	for (GLuint i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+		textures[i][0] = UNKNOWN;
+		textures[i][1] = UNKNOWN;
+	}
+	for (GLuint& c : capabilities) {
+		c = UNKNOWN;
+	}
+	depthMask	= UNKNOWN;
+	depthFunc	= UNKNOWN;
+	blendSource	= UNKNOWN;
+	blendDest	= UNKNOWN;
+}
+
+void GLStateCache::BeginFrame() {
+	lastFrameIssued	= frameIssued;
+	lastFrameElided	= frameElided;
+	frameIssued		= 0;
+	frameElided		= 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "glad/glad.h"
+#include <cstddef>
+
+/*
+Shadows the GL state that gets set over and over while drawing - the bound
+program, VAO and framebuffers, the 2D and cube map texture on each unit,
+and the depth and blend switches - and drops any call that wouldn't change
+it. There's only ever the one context, so it's all static, for meshes and
+nodes to use without a renderer to hand.
+
+Whatever is set through here must only ever be set through here. Code
+that binds things behind its back (texture loading, say) has to call
+Invalidate afterwards, so the next call of each kind goes through, and
+anything deleted has to be forgotten, in case GL hands its name out again.
+
+Meshes leave their VAO bound after drawing, so a run of draws from one
+mesh only binds it once. Anything setting up buffers outside a mesh's own
+VAO binds VAO 0 through here first, so none of it can end up recorded in
+whichever mesh happened to be drawn last.
+*/
+class GLStateCache {
+public:
+	static const GLuint MAX_TEXTURE_UNITS = 16;
+
+	static void	UseProgram(GLuint program);
+	static void	BindVertexArray(GLuint vao);
+	//GL_FRAMEBUFFER sets both the draw and read framebuffer, as in GL
+	static void	BindFramebuffer(GLenum target, GLuint fbo);
+	//What binding framebuffer 0 actually binds - for contexts with no
+	//window, which draw into an FBO instead
+	static void	SetDefaultFramebuffer(GLuint fbo) { defaultFramebuffer = fbo; }
+	//Only GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP are tracked - anything
+	//else is always passed straight on
+	static void	BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	//GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE and GL_STENCIL_TEST are tracked
+	static void	SetEnabled(GLenum cap, bool enabled);
+	static void	DepthMask(bool write);
+	static void	DepthFunc(GLenum func);
+	static void	BlendFunc(GLenum source, GLenum dest);
+
+	static void	ForgetProgram(GLuint program);
+	static void	ForgetVertexArray(GLuint vao);
+	static void	ForgetFramebuffer(GLuint fbo);
+	static void	ForgetTexture(GLuint texture);
+
+	static void	Invalidate();
+
+	//Calls passed on to GL, and dropped as redundant, over the last frame
+	static void		BeginFrame();
+	static size_t	GetLastFrameIssued()	{ return lastFrameIssued; }
+	static size_t	GetLastFrameElided()	{ return lastFrameElided; }
+
+protected:
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	enum Capability {
+		CAP_BLEND,
+		CAP_DEPTH_TEST,
+		CAP_CULL_FACE,
+		CAP_STENCIL_TEST,
+		CAP_MAX
+	};
+	static int	GetCapability(GLenum cap);
+	static int	GetTextureTarget(GLenum target);
+
+	//Updates the shadow, and returns true if GL needs telling
+	static bool	Change(GLuint& shadow, GLuint value);
+
+	static GLuint	program;
+	static GLuint	vertexArray;
+	static GLuint	drawFramebuffer;
+	static GLuint	readFramebuffer;
+	static GLuint	defaultFramebuffer;
+	static GLuint	activeUnit;
+	static GLuint	textures[MAX_TEXTURE_UNITS][2];
+	static GLuint	capabilities[CAP_MAX];
+	static GLuint	depthMask;
+	static GLuint	depthFunc;
+	static GLuint	blendSource;
+	static GLuint	blendDest;
+
+	static size_t	frameIssued;
+	static size_t	frameElided;
+	static size_t	lastFrameIssued;
+	static size_t	lastFrameElided;
+};
@@ -0,0 +1,127 @@
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include <cstddef>
+
+GeometryArena::GeometryArena(void) {
+	arrayObject		= 0;
+	vertexBuffer	= 0;
+	indexBuffer		= 0;
+	drawIDBuffer	= 0;
+	vertexCount		= 0;
+	indexCount		= 0;
+}
+
+GeometryArena::~GeometryArena(void) {
+	if (arrayObject) {
+		GLStateCache::ForgetVertexArray(arrayObject);
+		glDeleteVertexArrays(1, &arrayObject);
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+}
+
+bool GeometryArena::Add(const Mesh* m) {
+	if (Contains(m)) {
+		return true;
+	}
+	if (arrayObject || m->type != GL_TRIANGLES || !m->vertices || m->numVertices == 0) {
+		return false;
+	}
+	Entry e;
+	e.whole.baseVertex	= (GLint)vertices.size();
+	e.whole.firstIndex	= (GLuint)indices.size();
+	e.whole.indexCount	= m->indices ? m->numIndices : m->numVertices;
+
+	for (GLuint i = 0; i < m->numVertices; ++i) {
+		Vertex v;
+		v.position	= m->vertices[i];
+		v.texCoord	= m->textureCoords	? m->textureCoords[i]	: Vector2(0, 0);
+		v.normal	= m->normals		? m->normals[i]			: Vector3(0, 1, 0);
+		vertices.push_back(v);
+	}
+	//Meshes without indices get an index per vertex, so submesh ranges
+	//(which count vertices for those) still line up
+	if (m->indices) {
+		indices.insert(indices.end(), m->indices, m->indices + m->numIndices);
+	}
+	else for (GLuint i = 0; i < m->numVertices; ++i) {
+		indices.push_back(i);
+	}
+
+	for (const Mesh::SubMesh& s : m->meshLayers) {
+		Range r;
+		r.baseVertex	= e.whole.baseVertex;
+		r.firstIndex	= e.whole.firstIndex + s.start;
+		r.indexCount	= s.count;
+		e.subMeshes.push_back(r);
+	}
+	entries.insert(std::make_pair(m, e));
+	vertexCount	= vertices.size();
+	indexCount	= indices.size();
+	return true;
+}
+
+const GeometryArena::Range* GeometryArena::GetRange(const Mesh* m, int subMesh) const {
+	auto i = entries.find(m);
+	if (i == entries.end()) {
+		return NULL;
+	}
+	if (subMesh < 0) {
+		return &i->second.whole;
+	}
+	if (subMesh >= (int)i->second.subMeshes.size()) {
+		return NULL;
+	}
+	return &i->second.subMeshes[subMesh];
+}
+
+void GeometryArena::Upload() {
+	if (arrayObject) {
+		return;
+	}
+	glGenVertexArrays(1, &arrayObject);
+	GLStateCache::BindVertexArray(arrayObject);
+
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+		vertices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(VERTEX_BUFFER, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		(const GLvoid*)offsetof(Vertex, position));
+	glEnableVertexAttribArray(VERTEX_BUFFER);
+	glVertexAttribPointer(TEXTURE_BUFFER, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		(const GLvoid*)offsetof(Vertex, texCoord));
+	glEnableVertexAttribArray(TEXTURE_BUFFER);
+	glVertexAttribPointer(NORMAL_BUFFER, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		(const GLvoid*)offsetof(Vertex, normal));
+	glEnableVertexAttribArray(NORMAL_BUFFER);
+	glObjectLabel(GL_BUFFER, vertexBuffer, -1, "Arena Vertices");
+
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+		indices.data(), GL_STATIC_DRAW);
+	glObjectLabel(GL_BUFFER, indexBuffer, -1, "Arena Indices");
+
+	GLStateCache::BindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	//Swapped with empty vectors, as clearing alone keeps the memory
+	std::vector<Vertex>().swap(vertices);
+	std::vector<GLuint>().swap(indices);
+}
+
+void GeometryArena::SetDrawIDBuffer(GLuint buffer) {
+	if (!arrayObject || buffer == drawIDBuffer) {
+		return;
+	}
+	drawIDBuffer = buffer;
+
+	GLStateCache::BindVertexArray(arrayObject);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribIPointer(Mesh::DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0, 0);
+	glVertexAttribDivisor(Mesh::DRAW_ID_ATTRIBUTE, 1);
+	glEnableVertexAttribArray(Mesh::DRAW_ID_ATTRIBUTE);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
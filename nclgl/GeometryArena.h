@@ -0,0 +1,76 @@
+#pragma once
+#include "OGLRenderer.h"
+#include <vector>
+#include <unordered_map>
+
+class Mesh;
+
+/*
+One big vertex and index buffer that many meshes are copied into, so they
+can all be drawn from the same VAO - and so from a single multi-draw call.
+
+Every mesh is stored in the same format (position, texture coordinate and
+normal, in the slots Shader binds those names to), as an indexed triangle
+list, with its indices relative to where its vertices start. Meshes are
+only ever added, while the scene is being built, and then the whole lot
+is uploaded in one go - after which the CPU copy is freed, as nothing
+reads it again.
+
+The VAO also gets the per-instance drawID attribute, pointed at the
+ObjectBuffer's drawIDs like any other mesh's, so shaders can find each
+draw's object data.
+*/
+class GeometryArena {
+public:
+	struct Vertex {
+		Vector3	position;
+		Vector2	texCoord;
+		Vector3	normal;
+	};
+
+	//Where a mesh, or one of its submeshes, ended up
+	struct Range {
+		GLuint	firstIndex;
+		GLuint	indexCount;
+		GLint	baseVertex;
+	};
+
+	GeometryArena(void);
+	~GeometryArena(void);
+
+	//Copies the mesh in, if it's a triangle list - anything else is left out
+	//and false returned, as is anything new once it's been uploaded. Adding
+	//the same mesh again does nothing
+	bool	Add(const Mesh* m);
+	bool	Contains(const Mesh* m) const { return entries.count(m) > 0; }
+	//The whole mesh if subMesh is -1. NULL if it isn't in here
+	const Range*	GetRange(const Mesh* m, int subMesh = -1) const;
+
+	//Creates the buffers, and frees the CPU copy
+	void	Upload();
+	//As Mesh::SetDrawIDBuffer
+	void	SetDrawIDBuffer(GLuint buffer);
+
+	GLuint	GetArrayObject()	const { return arrayObject; }
+	size_t	GetMeshCount()		const { return entries.size(); }
+	size_t	GetVertexCount()	const { return vertexCount; }
+	size_t	GetIndexCount()		const { return indexCount; }
+
+protected:
+	struct Entry {
+		Range				whole;
+		std::vector<Range>	subMeshes;
+	};
+	std::unordered_map<const Mesh*, Entry>	entries;
+
+	//Only until Upload
+	std::vector<Vertex>	vertices;
+	std::vector<GLuint>	indices;
+	size_t	vertexCount;
+	size_t	indexCount;
+
+	GLuint	arrayObject;
+	GLuint	vertexBuffer;
+	GLuint	indexBuffer;
+	GLuint	drawIDBuffer;	//not ours - just what the VAO points at
+};
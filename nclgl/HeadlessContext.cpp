@@ -0,0 +1,170 @@
+#include "HeadlessContext.h"
+#ifdef NCLGL_HEADLESS
+#include "GLStateCache.h"
+#include "SOIL/SOIL.h"
+#include <EGL/eglext.h>
+#include <iostream>
+#include <cstring>
+
+HeadlessContext::HeadlessContext(int width, int height) {
+	this->width		= width > 1 ? width : 1;
+	this->height	= height > 1 ? height : 1;
+	display			= EGL_NO_DISPLAY;
+	context			= EGL_NO_CONTEXT;
+	framebuffer		= 0;
+	colourTex		= 0;
+	depthStencil	= 0;
+	init			= false;
+
+	if (!CreateContext() || !CreateFramebuffer()) {
+		return;
+	}
+	init = true;
+}
+
+HeadlessContext::~HeadlessContext(void) {
+	if (context != EGL_NO_CONTEXT) {
+		if (framebuffer) {
+			GLStateCache::ForgetFramebuffer(framebuffer);
+			GLStateCache::ForgetTexture(colourTex);
+			glDeleteFramebuffers(1, &framebuffer);
+			glDeleteTextures(1, &colourTex);
+			glDeleteRenderbuffers(1, &depthStencil);
+		}
+		GLStateCache::SetDefaultFramebuffer(0);
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+	}
+	if (display != EGL_NO_DISPLAY) {
+		eglTerminate(display);
+	}
+}
+
+bool HeadlessContext::CreateContext() {
+	//The surfaceless platform doesn't need a GPU, an X server, or anything
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+			EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint major = 0;
+	EGLint minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+		std::cout << "HeadlessContext::CreateContext(): Cannot initialise EGL!\n";
+		return false;
+	}
+	std::cout << "HeadlessContext::CreateContext(): EGL " << major << "." << minor << "\n";
+
+	const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+		std::cout << "HeadlessContext::CreateContext(): EGL can't make a context current without a surface!\n";
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "HeadlessContext::CreateContext(): EGL doesn't support desktop OpenGL!\n";
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE,		EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE,	EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) ||
+		configCount < 1) {
+		std::cout << "HeadlessContext::CreateContext(): No suitable EGL config!\n";
+		return false;
+	}
+
+	//4.3 is the oldest that has everything the coursework renderer uses
+	//(storage buffers and multi-draw indirect)
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION,			4,
+		EGL_CONTEXT_MINOR_VERSION,			3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK,	EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT) {
+		std::cout << "HeadlessContext::CreateContext(): Cannot create an OpenGL 4.3 context!\n";
+		return false;
+	}
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::cout << "HeadlessContext::CreateContext(): Cannot make the context current!\n";
+		return false;
+	}
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+		std::cout << "HeadlessContext::CreateContext(): Cannot initialise GLAD!\n";
+		return false;
+	}
+	std::cout << "HeadlessContext::CreateContext(): " << glGetString(GL_VERSION)
+		<< " on " << glGetString(GL_RENDERER) << "\n";
+	return true;
+}
+
+bool HeadlessContext::CreateFramebuffer() {
+	glGenTextures(1, &colourTex);
+	glBindTexture(GL_TEXTURE_2D, colourTex);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &depthStencil);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_TEXTURE_2D, colourTex, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+		GL_RENDERBUFFER, depthStencil);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glObjectLabel(GL_FRAMEBUFFER, framebuffer, -1, "Headless Backbuffer");
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "HeadlessContext::CreateFramebuffer(): Framebuffer incomplete!\n";
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return false;
+	}
+	GLStateCache::SetDefaultFramebuffer(framebuffer);
+	GLStateCache::Invalidate();
+	return true;
+}
+
+void HeadlessContext::ReadPixels(std::vector<unsigned char>& into) const {
+	const size_t rowBytes = (size_t)width * 4;
+	into.resize(rowBytes * height);
+
+	GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, into.data());
+
+	//GL reads bottom row first
+	std::vector<unsigned char> row(rowBytes);
+	for (int y = 0; y < height / 2; ++y) {
+		unsigned char* top		= &into[y * rowBytes];
+		unsigned char* bottom	= &into[(height - 1 - y) * rowBytes];
+		memcpy(row.data(), top, rowBytes);
+		memcpy(top, bottom, rowBytes);
+		memcpy(bottom, row.data(), rowBytes);
+	}
+}
+
+bool HeadlessContext::SaveImage(const std::string& filename) const {
+	std::vector<unsigned char> pixels;
+	ReadPixels(pixels);
+	if (!SOIL_save_image(filename.c_str(), SOIL_SAVE_TYPE_TGA, width, height,
+		4, pixels.data())) {
+		std::cout << "HeadlessContext::SaveImage(): Couldn't write " << filename << "\n";
+		return false;
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+#ifdef NCLGL_HEADLESS
+#include "glad/glad.h"
+#include <EGL/egl.h>
+#include <string>
+#include <vector>
+
+/*
+An OpenGL context with no window behind it, for running renderers on
+machines without a display - benchmarks and image comparisons, mostly.
+
+It's made through EGL, on Mesa's surfaceless platform where there is one
+(which works with its software rasteriser too), falling back to the
+default display. A surfaceless context has no default framebuffer, so
+this makes an FBO of the requested size to stand in for it, and tells
+GLStateCache to bind that whenever framebuffer 0 is asked for.
+
+Only built with NCLGL_HEADLESS defined, and needs EGL to link against -
+the CMakeLists.txt at the top of the repository builds it that way.
+*/
+class HeadlessContext {
+public:
+	HeadlessContext(int width, int height);
+	~HeadlessContext(void);
+
+	bool	HasInitialised()	const { return init; }
+	GLuint	GetFramebuffer()	const { return framebuffer; }
+	int		GetWidth()			const { return width; }
+	int		GetHeight()			const { return height; }
+
+	//The colour buffer as RGBA, top row first
+	void	ReadPixels(std::vector<unsigned char>& into) const;
+	//Saves the colour buffer as a TGA, for comparing against a reference
+	bool	SaveImage(const std::string& filename) const;
+
+protected:
+	bool	CreateContext();
+	bool	CreateFramebuffer();
+
+	EGLDisplay	display;
+	EGLContext	context;
+
+	GLuint	framebuffer;
+	GLuint	colourTex;
+	GLuint	depthStencil;
+
+	int		width;
+	int		height;
+	bool	init;
+};
+#endif
@@ -0,0 +1,51 @@
+#include "HeapCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+size_t HeapCounter::frameStartAllocations	= 0;
+size_t HeapCounter::lastFrameAllocations	= 0;
+
+#ifndef NDEBUG
+//Constant initialised, so it's already there for allocations made by
+//other files' static constructors
+static std::atomic<size_t> allocations(0);
+
+static void* CountedAllocate(size_t bytes) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void* p = malloc(bytes ? bytes : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(size_t bytes)					{ return CountedAllocate(bytes); }
+void* operator new[](size_t bytes)					{ return CountedAllocate(bytes); }
+void operator delete(void* p) noexcept				{ free(p); }
+void operator delete[](void* p) noexcept			{ free(p); }
+void operator delete(void* p, size_t) noexcept		{ free(p); }
+void operator delete[](void* p, size_t) noexcept	{ free(p); }
+
+bool HeapCounter::IsCounting() {
+	return true;
+}
+
+size_t HeapCounter::GetTotalAllocations() {
+	return allocations.load(std::memory_order_relaxed);
+}
+#else
+bool HeapCounter::IsCounting() {
+	return false;
+}
+
+size_t HeapCounter::GetTotalAllocations() {
+	return 0;
+}
+#endif
+
+void HeapCounter::BeginFrame() {
+	const size_t now		= GetTotalAllocations();
+	lastFrameAllocations	= now - frameStartAllocations;
+	frameStartAllocations	= now;
+}
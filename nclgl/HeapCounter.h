@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+
+/*
+Counts every allocation made through the global operator new, by any
+thread, so the renderer's stats can show whether a frame really went
+without touching the heap - not just whether the frame allocator had to
+fall back to it.
+
+Only debug builds replace operator new to do the counting. In release
+builds it's left alone, IsCounting returns false, and the counts are
+always zero.
+*/
+class HeapCounter {
+public:
+	static bool		IsCounting();
+
+	//Starts the next frame's count. OGLRenderer::SwapBuffers calls this
+	static void		BeginFrame();
+	static size_t	GetLastFrameAllocations() { return lastFrameAllocations; }
+	static size_t	GetTotalAllocations();
+
+protected:
+	static size_t	frameStartAllocations;
+	static size_t	lastFrameAllocations;
+};
@@ -1,7 +1,14 @@
 #include "HeightMap.h"
 #include <iostream>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 HeightMap::HeightMap(const std::string& name) {
+	mapWidth = 0;
+	mapDepth = 0;
+	cellSize = 1.0f;
+
 	int iWidth, iHeight, iChans;
 	unsigned char* data = SOIL_load_image(name.c_str(),
 		&iWidth, &iHeight, &iChans, 1);
@@ -10,6 +17,8 @@ HeightMap::HeightMap(const std::string& name) {
 		return;
 	}
 
+	mapWidth		= iWidth;
+	mapDepth		= iHeight;
 	numVertices		= iWidth * iHeight;
 	numIndices		= (iWidth - 1) * (iHeight - 1) * 6;
 	vertices		= new Vector3[numVertices];
@@ -54,4 +63,139 @@ HeightMap::HeightMap(const std::string& name) {
 	heightmapSize.x = vertexScale.x * (iWidth - 1);
 	heightmapSize.y = vertexScale.y * 255.0f;
 	heightmapSize.z = vertexScale.z * (iHeight - 1);
-}
\ No newline at end of file
+
+	cellSize = vertexScale.x;
+	BuildPyramid();
+}
+
+void HeightMap::BuildPyramid() {
+	//Bottom level has one cell per quad of the mesh, covering its 4 corners
+	PyramidLevel base;
+	base.width = mapWidth - 1;
+	base.depth = mapDepth - 1;
+	base.lowest.resize(base.width * base.depth);
+	base.highest.resize(base.width * base.depth);
+	for (int z = 0; z < base.depth; ++z) {
+		for (int x = 0; x < base.width; ++x) {
+			float a = vertices[(z * mapWidth) + x].y;
+			float b = vertices[(z * mapWidth) + x + 1].y;
+			float c = vertices[((z + 1) * mapWidth) + x].y;
+			float d = vertices[((z + 1) * mapWidth) + x + 1].y;
+			base.lowest[(z * base.width) + x]	= std::min(std::min(a, b), std::min(c, d));
+			base.highest[(z * base.width) + x]	= std::max(std::max(a, b), std::max(c, d));
+		}
+	}
+	pyramid.push_back(base);
+
+	while (pyramid.back().width > 1 || pyramid.back().depth > 1) {
+		const PyramidLevel& below = pyramid.back();
+		PyramidLevel level;
+		level.width = (below.width + 1) / 2;
+		level.depth = (below.depth + 1) / 2;
+		level.lowest.resize(level.width * level.depth);
+		level.highest.resize(level.width * level.depth);
+		for (int z = 0; z < level.depth; ++z) {
+			for (int x = 0; x < level.width; ++x) {
+				float lowest	= below.lowest[(z * 2 * below.width) + x * 2];
+				float highest	= below.highest[(z * 2 * below.width) + x * 2];
+				//The last row or column may only have one cell below it
+				for (int bz = z * 2; bz < std::min(z * 2 + 2, below.depth); ++bz) {
+					for (int bx = x * 2; bx < std::min(x * 2 + 2, below.width); ++bx) {
+						lowest	= std::min(lowest, below.lowest[(bz * below.width) + bx]);
+						highest	= std::max(highest, below.highest[(bz * below.width) + bx]);
+					}
+				}
+				level.lowest[(z * level.width) + x]		= lowest;
+				level.highest[(z * level.width) + x]	= highest;
+			}
+		}
+		pyramid.push_back(level);
+	}
+}
+
+bool HeightMap::GetHeightRange(int level, float minX, float minZ, float maxX, float maxZ,
+	float& lowest, float& highest) const {
+	if (pyramid.empty()) {
+		return false;
+	}
+	level = std::min(std::max(level, 0), GetPyramidLevels() - 1);
+	const PyramidLevel& l = pyramid[level];
+	const float size = GetPyramidCellSize(level);
+
+	int x0 = (int)floor(minX / size);
+	int z0 = (int)floor(minZ / size);
+	int x1 = (int)floor(maxX / size);
+	int z1 = (int)floor(maxZ / size);
+	if (x1 < 0 || z1 < 0 || x0 >= l.width || z0 >= l.depth) {
+		return false;
+	}
+	bool offEdge = x0 < 0 || z0 < 0 || x1 >= l.width || z1 >= l.depth;
+	x0 = std::max(x0, 0);
+	z0 = std::max(z0, 0);
+	x1 = std::min(x1, l.width - 1);
+	z1 = std::min(z1, l.depth - 1);
+
+	lowest	= l.lowest[(z0 * l.width) + x0];
+	highest	= l.highest[(z0 * l.width) + x0];
+	for (int z = z0; z <= z1; ++z) {
+		for (int x = x0; x <= x1; ++x) {
+			lowest	= std::min(lowest, l.lowest[(z * l.width) + x]);
+			highest	= std::max(highest, l.highest[(z * l.width) + x]);
+		}
+	}
+	if (offEdge) {
+		lowest = -FLT_MAX;
+	}
+	return true;
+}
+
+void HeightMap::BuildOccluder(int step, std::vector<Vector3>& outVertices,
+	std::vector<unsigned int>& outIndices) const {
+	outVertices.clear();
+	outIndices.clear();
+	if (mapWidth < 2 || mapDepth < 2 || step < 1) {
+		return;
+	}
+	//Always include the last row and column, so the edges line up
+	std::vector<int> xs, zs;
+	for (int x = 0; x < mapWidth - 1; x += step) {
+		xs.push_back(x);
+	}
+	xs.push_back(mapWidth - 1);
+	for (int z = 0; z < mapDepth - 1; z += step) {
+		zs.push_back(z);
+	}
+	zs.push_back(mapDepth - 1);
+
+	for (int z : zs) {
+		for (int x : xs) {
+			float lowest = vertices[(z * mapWidth) + x].y;
+			for (int nz = std::max(z - step, 0); nz <= std::min(z + step, mapDepth - 1); ++nz) {
+				for (int nx = std::max(x - step, 0); nx <= std::min(x + step, mapWidth - 1); ++nx) {
+					lowest = std::min(lowest, vertices[(nz * mapWidth) + nx].y);
+				}
+			}
+			Vector3 v = vertices[(z * mapWidth) + x];
+			v.y = lowest;
+			outVertices.push_back(v);
+		}
+	}
+
+	const unsigned int rowLength = (unsigned int)xs.size();
+	for (unsigned int z = 0; z < zs.size() - 1; ++z) {
+		for (unsigned int x = 0; x < rowLength - 1; ++x) {
+			unsigned int a = (z * rowLength) + x;
+			unsigned int b = (z * rowLength) + (x + 1);
+			unsigned int c = ((z + 1) * rowLength) + (x + 1);
+			unsigned int d = ((z + 1) * rowLength) + x;
+
+			outIndices.push_back(a);
+			outIndices.push_back(c);
+			outIndices.push_back(b);
+
+			outIndices.push_back(c);
+			outIndices.push_back(a);
+			outIndices.push_back(d);
+		}
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "Mesh.h"
 
 class HeightMap : public Mesh {
@@ -9,7 +10,38 @@ public:
 
 	Vector3 GetHeightmapSize() const { return heightmapSize; }
 
+	//Coarse copy of the terrain, one vertex every 'step' samples, for use as
+	//an occluder. Each vertex takes the lowest height around it, so the copy
+	//never pokes up above the real terrain
+	void BuildOccluder(int step, std::vector<Vector3>& outVertices,
+		std::vector<unsigned int>& outIndices) const;
+
+	//The pyramid holds the lowest and highest height in each cell of the
+	//map, then in each 2x2 block of cells, and so on up to a single cell
+	int		GetPyramidLevels() const { return (int)pyramid.size(); }
+	float	GetPyramidCellSize(int level) const { return cellSize * (float)(1 << level); }
+	//Height range of the terrain over a local space rectangle, taken from
+	//whichever cells of the given level overlap it - so coarser levels are
+	//quicker, but looser. Any part of the rectangle off the edge of the map
+	//counts as having no terrain at all. Returns false if none of it is on
+	//the map
+	bool	GetHeightRange(int level, float minX, float minZ, float maxX, float maxZ,
+				float& lowest, float& highest) const;
+
 protected:
+	void	BuildPyramid();
+
+	struct PyramidLevel {
+		int					width;
+		int					depth;
+		std::vector<float>	lowest;
+		std::vector<float>	highest;
+	};
+
 	Vector3 heightmapSize;
+	int		mapWidth;
+	int		mapDepth;
+	float	cellSize;
+	std::vector<PyramidLevel>	pyramid;
 };
 
@@ -0,0 +1,84 @@
+#include "HorizonCuller.h"
+#include "HeightMap.h"
+#include <algorithm>
+#include <cmath>
+
+HorizonCuller::HorizonCuller(const HeightMap* map, const Vector3& origin) {
+	SetHeightMap(map, origin);
+}
+
+void HorizonCuller::SetHeightMap(const HeightMap* map, const Vector3& origin) {
+	this->heightMap	= map;
+	this->origin	= origin;
+}
+
+bool HorizonCuller::IsOccluded(const Vector3& centre, float radius) const {
+	if (!heightMap || heightMap->GetPyramidLevels() == 0) {
+		return false;
+	}
+	//Everything from here on is in the heightmap's space
+	const Vector3 camera	= cameraPosition - origin;
+	const Vector3 target	= centre - origin;
+
+	const float dx		= target.x - camera.x;
+	const float dz		= target.z - camera.z;
+	const float dist	= sqrt((dx * dx) + (dz * dz));
+	const float end		= dist - radius;
+	if (end <= 0.0f) {
+		return false; //camera is above or inside it
+	}
+	const float dirX = dx / dist;
+	const float dirZ = dz / dist;
+
+	//Steepest any sight line to the object can be...
+	const float rise		= target.y + radius - camera.y;
+	const float topSlope	= rise / (rise > 0.0f ? end : dist + radius);
+	//...and how far those sight lines can spread out sideways, per unit
+	//travelled towards it
+	const float spread		= radius / end;
+
+	const int topLevel	= heightMap->GetPyramidLevels() - 1;
+	int		level		= 0;
+	float	t			= 0.0f;
+	while (t < end) {
+		const float next	= std::min(t + heightMap->GetPyramidCellSize(level), end);
+		const float width	= next * spread;
+
+		const float ax = camera.x + (dirX * t);
+		const float az = camera.z + (dirZ * t);
+		const float bx = camera.x + (dirX * next);
+		const float bz = camera.z + (dirZ * next);
+
+		float lowest, highest;
+		if (!heightMap->GetHeightRange(level,
+			std::min(ax, bx) - width, std::min(az, bz) - width,
+			std::max(ax, bx) + width, std::max(az, bz) + width,
+			lowest, highest)) {
+			t = next;
+			continue;
+		}
+		//Sight lines cross this stretch somewhere between these distances
+		const float nearDist	= std::max(t - width, 0.001f);
+		const float farDist		= next + width;
+
+		const float highSlope = (highest - camera.y) /
+			(highest > camera.y ? nearDist : farDist);
+		if (highSlope < topSlope) {
+			//Nothing here gets high enough, so try bigger steps
+			t		= next;
+			level	= std::min(level + 1, topLevel);
+			continue;
+		}
+		const float lowSlope = (lowest - camera.y) /
+			(lowest > camera.y ? farDist : nearDist);
+		if (lowSlope >= topSlope) {
+			return true;
+		}
+		if (level > 0) {
+			--level;	//not sure either way, so look closer
+			continue;
+		}
+		t = next;
+	}
+	return false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Vector3.h"
+
+class HeightMap;
+
+/*
+Cheap occlusion test for things hidden behind hills. Looking from the
+camera towards an object, the terrain in between forms a horizon - if the
+whole object is below it, it can't be seen.
+
+Tests march outwards from the camera across the heightmap's min/max
+pyramid. Stretches whose highest point can't reach up to the object are
+skipped a whole (and growing) pyramid cell at a time, and the march only
+drops down to finer cells where the terrain gets close. The object is
+rejected as soon as the lowest terrain across the whole band of sight
+lines to it rises above its top, so it never culls something that's
+actually visible.
+*/
+class HorizonCuller {
+public:
+	//origin is where the heightmap's corner sits in world space
+	HorizonCuller(const HeightMap* map = NULL, const Vector3& origin = Vector3());
+	~HorizonCuller(void) {};
+
+	void	SetHeightMap(const HeightMap* map, const Vector3& origin);
+	void	SetCameraPosition(const Vector3& position) { cameraPosition = position; }
+
+	//True if the sphere is entirely hidden by the terrain
+	bool	IsOccluded(const Vector3& centre, float radius) const;
+
+protected:
+	const HeightMap*	heightMap;
+	Vector3				origin;
+	Vector3				cameraPosition;
+};
@@ -0,0 +1,155 @@
+#include "IndirectDrawList.h"
+#include "GeometryArena.h"
+#include "SceneNode.h"
+#include <algorithm>
+
+IndirectDrawList::IndirectDrawList(int minItems) {
+	this->minItems	= std::max(minItems, 1);
+	objectCount		= 0;
+	commandBuffer	= 0;
+	commandCapacity	= 0;
+}
+
+IndirectDrawList::~IndirectDrawList(void) {
+	if (commandBuffer) {
+		glDeleteBuffers(1, &commandBuffer);
+	}
+}
+
+void IndirectDrawList::SetIndirectShader(Shader* shader, Shader* indirect) {
+	for (ShaderPair& p : shaders) {
+		if (p.shader == shader) {
+			p.indirect = indirect;
+			return;
+		}
+	}
+	shaders.push_back(ShaderPair{ shader, indirect });
+}
+
+Shader* IndirectDrawList::GetIndirectShader(const Shader* shader) const {
+	for (const ShaderPair& p : shaders) {
+		if (p.shader == shader) {
+			return p.indirect;
+		}
+	}
+	return NULL;
+}
+
+GLuint IndirectDrawList::GetDrawTexture(const SceneNode* n) {
+	return n->GetMesh()->GetSubMeshCount() > 0 ?
+		n->GetSubMeshTexture(0) : n->GetTexture();
+}
+
+bool IndirectDrawList::CanDraw(const SceneNode* n, const GeometryArena& arena) const {
+	const Mesh* m = n->GetMesh();
+	if (!m || !n->CanInstance() || !arena.Contains(m) ||
+		!GetIndirectShader(n->GetShader())) {
+		return false;
+	}
+	//Submeshes with their own textures would need a command each
+	for (int i = 1; i < m->GetSubMeshCount(); ++i) {
+		if (n->GetSubMeshTexture(i) != n->GetSubMeshTexture(0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void IndirectDrawList::Clear() {
+	batches.clear();
+	commands.clear();
+	objectCount = 0;
+}
+
+void IndirectDrawList::Build(const std::vector<RenderQueueItem>& items,
+	const GeometryArena& arena) {
+	//Kept between frames, so it's only ever allocated while it grows
+	drawItems.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i) {
+		const SceneNode* n	= items[i].node;
+		DrawItem& d			= drawItems[i];
+		d.shader = NULL;
+		if (CanDraw(n, arena)) {
+			d.meshID	= n->GetMesh()->GetSortID();
+			d.range		= *arena.GetRange(n->GetMesh());
+			d.shader	= GetIndirectShader(n->GetShader());
+			d.texture	= GetDrawTexture(n);
+		}
+	}
+	Build(drawItems);
+}
+
+void IndirectDrawList::Build(const std::vector<DrawItem>& items) {
+	Clear();
+
+	size_t i = 0;
+	while (i < items.size()) {
+		Shader* shader	= items[i].shader;
+		GLuint texture	= items[i].texture;
+		size_t end		= i + 1;
+		if (!shader) {
+			i = end;
+			continue;
+		}
+		while (end < items.size() && items[end].shader == shader &&
+			items[end].texture == texture) {
+			++end;
+		}
+		if ((int)(end - i) >= minItems) {
+			Batch b;
+			b.first			= i;
+			b.itemCount		= end - i;
+			b.firstCommand	= commands.size();
+			b.texture		= texture;
+
+			for (size_t j = i; j < end; ++j) {
+				const DrawItem& d = items[j];
+				//The queue keeps the same mesh together, so these are
+				//mostly instances of the one command
+				if (j > i && d.meshID == items[j - 1].meshID) {
+					commands.back().instanceCount++;
+				}
+				else {
+					DrawElementsIndirectCommand c;
+					c.count			= d.range.indexCount;
+					c.instanceCount	= 1;
+					c.firstIndex	= d.range.firstIndex;
+					c.baseVertex	= d.range.baseVertex;
+					c.baseInstance	= (GLuint)j;
+					commands.push_back(c);
+				}
+			}
+			objectCount += end - i;
+			b.commandCount = commands.size() - b.firstCommand;
+			batches.push_back(b);
+		}
+		i = end;
+	}
+}
+
+void IndirectDrawList::Upload() {
+	if (commands.empty()) {
+		return;
+	}
+	if (!commandBuffer) {
+		glGenBuffers(1, &commandBuffer);
+	}
+	GLStateCache::BindVertexArray(0);
+
+	//Orphaned each time, so the driver never has to wait for last frame
+	commandCapacity = std::max(commands.size(), commandCapacity);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER,
+		commandCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+		commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void IndirectDrawList::Draw(const Batch& b) {
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		(const GLvoid*)(b.firstCommand * sizeof(DrawElementsIndirectCommand)),
+		(GLsizei)b.commandCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
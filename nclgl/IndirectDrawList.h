@@ -0,0 +1,95 @@
+#pragma once
+#include "OGLRenderer.h"
+#include "GeometryArena.h"
+#include "RenderQueue.h"
+#include <vector>
+
+class SceneNode;
+class Shader;
+
+//Laid out as glMultiDrawElementsIndirect expects
+struct DrawElementsIndirectCommand {
+	GLuint	count;
+	GLuint	instanceCount;
+	GLuint	firstIndex;
+	GLint	baseVertex;
+	GLuint	baseInstance;
+};
+
+/*
+Packs runs of a sorted render queue into multi-draw indirect commands, for
+meshes that live in a GeometryArena.
+
+A batch is a run of consecutive items that share a shader and texture -
+their meshes can all differ, as they're drawn from the one arena VAO. Each
+item becomes a command (or adds an instance to the last one, if it has the
+same mesh), with the command's base instance set to its first item's
+index - which is where that item's entry in the ObjectBuffer is, so
+shaders find each instance's transform through the drawID attribute. The
+commands go in a draw indirect buffer, orphaned and refilled each frame.
+
+The batching itself only needs each item's DrawItem, so it can be built
+from those directly, without any nodes or arena. Building the list
+doesn't touch GL at all, only Upload and Draw do.
+*/
+class IndirectDrawList {
+public:
+	struct Batch {
+		size_t	first;			//index of the first item in the queue
+		size_t	itemCount;
+		size_t	firstCommand;
+		size_t	commandCount;
+		GLuint	texture;
+	};
+	//What the batching needs to know about each item. Its transform and
+	//material are in the ObjectBuffer, at the item's index
+	struct DrawItem {
+		GLuint					meshID;	//Mesh::GetSortID
+		GeometryArena::Range	range;
+		Shader*					shader;	//the indirect one, NULL if it can't be
+		GLuint					texture;
+	};
+
+	IndirectDrawList(int minItems = 2);
+	~IndirectDrawList(void);
+
+	//Nodes using shader can be drawn indirectly, with indirect in its place
+	void	SetIndirectShader(Shader* shader, Shader* indirect);
+	Shader*	GetIndirectShader(const Shader* shader) const;
+
+	//Can n be drawn by a single arena command, with one texture?
+	bool	CanDraw(const SceneNode* n, const GeometryArena& arena) const;
+	//The one texture it's drawn with
+	static GLuint	GetDrawTexture(const SceneNode* n);
+
+	void	Build(const std::vector<RenderQueueItem>& items, const GeometryArena& arena);
+	void	Build(const std::vector<DrawItem>& items);
+	void	Clear();
+
+	void	Upload();
+	//The arena's VAO, the ObjectBuffer and the right shader and texture
+	//need binding first
+	void	Draw(const Batch& b);
+
+	const std::vector<Batch>&	GetBatches()	const { return batches; }
+	const std::vector<DrawElementsIndirectCommand>& GetCommands() const { return commands; }
+	//How many nodes the batches draw between them
+	size_t	GetObjectCount()	const { return objectCount; }
+
+protected:
+	int		minItems;
+
+	std::vector<DrawItem>						drawItems;
+	std::vector<Batch>							batches;
+	std::vector<DrawElementsIndirectCommand>	commands;
+	size_t	objectCount;
+
+	GLuint	commandBuffer;
+	size_t	commandCapacity;
+
+	struct ShaderPair {
+		Shader*	shader;
+		Shader*	indirect;
+	};
+	std::vector<ShaderPair>	shaders;
+};
@@ -0,0 +1,64 @@
+#include "InstanceBatcher.h"
+#include "SceneNode.h"
+#include <algorithm>
+
+InstanceBatcher::InstanceBatcher(int minInstances) {
+	this->minInstances	= std::max(minInstances, 1);
+	instanceCount		= 0;
+}
+
+void InstanceBatcher::SetInstancedShader(Shader* shader, Shader* instanced) {
+	for (ShaderPair& p : shaders) {
+		if (p.shader == shader) {
+			p.instanced = instanced;
+			return;
+		}
+	}
+	shaders.push_back(ShaderPair{ shader, instanced });
+}
+
+Shader* InstanceBatcher::GetInstancedShader(const Shader* shader) const {
+	for (const ShaderPair& p : shaders) {
+		if (p.shader == shader) {
+			return p.instanced;
+		}
+	}
+	return NULL;
+}
+
+bool InstanceBatcher::CanShareDraw(const SceneNode* a, const SceneNode* b) {
+	if (a->GetMesh() != b->GetMesh() || a->GetShader() != b->GetShader() ||
+		a->GetTexture() != b->GetTexture()) {
+		return false;
+	}
+	for (int i = 0; i < a->GetMesh()->GetSubMeshCount(); ++i) {
+		if (a->GetSubMeshTexture(i) != b->GetSubMeshTexture(i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void InstanceBatcher::Build(const std::vector<RenderQueueItem>& items) {
+	Clear();
+
+	size_t i = 0;
+	while (i < items.size()) {
+		const SceneNode* first = items[i].node;
+		size_t end = i + 1;
+		if (!first->CanInstance() || !first->GetMesh() ||
+			!GetInstancedShader(first->GetShader())) {
+			i = end;
+			continue;
+		}
+		while (end < items.size() && items[end].node->CanInstance() &&
+			CanShareDraw(first, items[end].node)) {
+			++end;
+		}
+		if ((int)(end - i) >= minInstances) {
+			groups.push_back(Group{ i, (int)(end - i), (int)i });
+			instanceCount += end - i;
+		}
+		i = end;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "OGLRenderer.h"
+#include "RenderQueue.h"
+#include <vector>
+
+class SceneNode;
+class Shader;
+
+/*
+Finds nodes in a sorted render queue that can be drawn together as one
+instanced draw.
+
+The queue already puts draws sharing a shader, texture and mesh next to
+each other, so a group is just a run of consecutive items whose nodes
+agree on all three (and on every submesh texture), allow instancing, and
+whose shader has an instanced variant registered. The ObjectBuffer has an
+entry per queue item at the same index, so a group's base instance is
+just its first item, and the instanced shaders read each instance's
+transform from there.
+
+Runs shorter than minInstances are left to be drawn normally - a "group"
+of one is still worth having, as it needs no uniforms setting. Nodes that
+can't be instanced, or have no instanced shader, never start a group.
+*/
+class InstanceBatcher {
+public:
+	struct Group {
+		size_t	first;			//index of the first item in the queue
+		int		count;
+		int		baseInstance;	//index of its first object in the ObjectBuffer
+	};
+
+	InstanceBatcher(int minInstances = 2);
+	~InstanceBatcher(void) {};
+
+	//Nodes using shader can be drawn instanced, with instanced in its place
+	void	SetInstancedShader(Shader* shader, Shader* instanced);
+	Shader*	GetInstancedShader(const Shader* shader) const;
+
+	void	Build(const std::vector<RenderQueueItem>& items);
+	void	Clear() { groups.clear(); instanceCount = 0; }
+
+	const std::vector<Group>& GetGroups() const { return groups; }
+	//How many nodes the groups draw between them
+	size_t	GetInstanceCount() const { return instanceCount; }
+
+	static bool	CanShareDraw(const SceneNode* a, const SceneNode* b);
+
+protected:
+	int			minInstances;
+	size_t		instanceCount;
+
+	std::vector<Group>		groups;
+
+	struct ShaderPair {
+		Shader*	shader;
+		Shader*	instanced;
+	};
+	std::vector<ShaderPair>	shaders;
+};
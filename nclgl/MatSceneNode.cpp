@@ -32,16 +32,14 @@ void MatSceneNode::Draw(const OGLRenderer& r)
 {
 	for (int i = 0; i < mesh->GetSubMeshCount(); ++i)
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, matTextures[i]);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, matTextures[i]);
 		if (!bumpTextures.empty())
 		{
 			//glActiveTexture(GL_TEXTURE1);
 			//glBindTexture(GL_TEXTURE_2D, bumpTextures[i]);
 
-			glUniform1i(glGetUniformLocation(shader->GetProgram(), "bumpTex"), 1);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, bumpTextures[i]);
+			shader->SetUniform(UNIFORM("bumpTex"), 1);
+			GLStateCache::BindTexture(1, GL_TEXTURE_2D, bumpTextures[i]);
 		}
 		mesh->DrawSubMesh(i);
 	}
@@ -9,6 +9,11 @@ public:
 	~MatSceneNode();
 
 	void Draw(const OGLRenderer& r) override;
+
+	bool IsStatic() const override { return true; }
+	GLuint GetSubMeshTexture(int i) const override {
+		return i < (int)matTextures.size() ? matTextures[i] : texture;
+	}
 protected:
 	MeshMaterial* meshMat;
 	vector <GLuint > matTextures;
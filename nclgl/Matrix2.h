@@ -10,6 +10,7 @@ https://research.ncl.ac.uk/game/
 #include "Vector2.h"
 #include "Vector3.h"
 #include <assert.h>
+#include <cstring>
 class Matrix2 {
 public:
 	Matrix2(void);
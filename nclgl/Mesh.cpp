@@ -1,10 +1,15 @@
 #include "Mesh.h"
 #include "Matrix2.h"
+#include <algorithm>
 
 using std::string;
 
+unsigned int Mesh::nextSortID = 0;
+
 Mesh::Mesh(void)	{
 	glGenVertexArrays(1, &arrayObject);
+	drawIDBuffer = 0;
+	sortID = nextSortID++;
 	
 	for(int i = 0; i < MAX_BUFFER; ++i) {
 		bufferObject[i] = 0;
@@ -22,9 +27,13 @@ Mesh::Mesh(void)	{
 	colours			= nullptr;
 	weights			= nullptr;
 	weightIndices	= nullptr;
+
+	packedWeights		= nullptr;
+	packedWeightIndices	= nullptr;
 }
 
 Mesh::~Mesh(void)	{
+	GLStateCache::ForgetVertexArray(arrayObject);
 	glDeleteVertexArrays(1, &arrayObject);			//Delete our VAO
 	glDeleteBuffers(MAX_BUFFER, bufferObject);		//Delete our VBOs
 
@@ -36,17 +45,18 @@ Mesh::~Mesh(void)	{
 	delete[]	colours;
 	delete[]	weights;
 	delete[]	weightIndices;
+	delete[]	packedWeights;
+	delete[]	packedWeightIndices;
 }
 
 void Mesh::Draw()	{
-	glBindVertexArray(arrayObject);
+	GLStateCache::BindVertexArray(arrayObject);
 	if(bufferObject[INDEX_BUFFER]) {
 		glDrawElements(type, numIndices, GL_UNSIGNED_INT, 0);
 	}
 	else{
 		glDrawArrays(type, 0, numVertices);
 	}
-	glBindVertexArray(0);	
 }
 
 void Mesh::DrawSubMesh(int i) {
@@ -55,7 +65,7 @@ void Mesh::DrawSubMesh(int i) {
 	}
 	SubMesh m = meshLayers[i];
 
-	glBindVertexArray(arrayObject);
+	GLStateCache::BindVertexArray(arrayObject);
 	if (bufferObject[INDEX_BUFFER]) {
 		const GLvoid* offset = (const GLvoid * )(m.start * sizeof(unsigned int)); 
 		glDrawElements(type, m.count, GL_UNSIGNED_INT, offset);
@@ -63,7 +73,62 @@ void Mesh::DrawSubMesh(int i) {
 	else {
 		glDrawArrays(type, m.start, m.count);	//Draw the triangle!
 	}
-	glBindVertexArray(0);
+}
+
+void Mesh::SetDrawIDBuffer(GLuint buffer) {
+	if (buffer == drawIDBuffer) {
+		return;
+	}
+	drawIDBuffer = buffer;
+
+	//Shaders that don't read it just ignore the extra attribute
+	GLStateCache::BindVertexArray(arrayObject);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0, 0);
+	glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+	glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::DrawInstanced(int count, int baseInstance) {
+	GLStateCache::BindVertexArray(arrayObject);
+	if (bufferObject[INDEX_BUFFER]) {
+		glDrawElementsInstancedBaseInstance(type, numIndices, GL_UNSIGNED_INT,
+			0, count, baseInstance);
+	}
+	else {
+		glDrawArraysInstancedBaseInstance(type, 0, numVertices, count,
+			baseInstance);
+	}
+}
+
+void Mesh::DrawSubMeshInstanced(int i, int count, int baseInstance) {
+	if (i < 0 || i >= (int)meshLayers.size()) {
+		return;
+	}
+	SubMesh m = meshLayers[i];
+
+	GLStateCache::BindVertexArray(arrayObject);
+	if (bufferObject[INDEX_BUFFER]) {
+		const GLvoid* offset = (const GLvoid*)(m.start * sizeof(unsigned int));
+		glDrawElementsInstancedBaseInstance(type, m.count, GL_UNSIGNED_INT,
+			offset, count, baseInstance);
+	}
+	else {
+		glDrawArraysInstancedBaseInstance(type, m.start, m.count, count,
+			baseInstance);
+	}
+}
+
+void Mesh::DrawSkinPartition(int i) {
+	if (i < 0 || i >= (int)skinPartitions.size()) {
+		return;
+	}
+	const SkinPartition& p = skinPartitions[i];
+
+	GLStateCache::BindVertexArray(arrayObject);
+	const GLvoid* offset = (const GLvoid*)(p.start * sizeof(unsigned int));
+	glDrawElements(type, p.count, GL_UNSIGNED_INT, offset);
 }
 
 void UploadAttribute(GLuint* id, int numElements, int dataSize, int attribSize, int attribID, void* pointer, const string&debugName) {
@@ -78,7 +143,7 @@ void UploadAttribute(GLuint* id, int numElements, int dataSize, int attribSize,
 }
 
 void	Mesh::BufferData()	{
-	glBindVertexArray(arrayObject);
+	GLStateCache::BindVertexArray(arrayObject);
 
 	////Buffer vertex data
 	UploadAttribute(&bufferObject[VERTEX_BUFFER], numVertices, sizeof(Vector3), 3, VERTEX_BUFFER, vertices, "Positions");
@@ -99,12 +164,30 @@ void	Mesh::BufferData()	{
 		UploadAttribute(&bufferObject[TANGENT_BUFFER], numVertices, sizeof(Vector4), 4, TANGENT_BUFFER, tangents, "Tangents");
 	}
 
-	if (weights) {		//Buffer weights data
+	if (packedWeights) {	//Buffer weights data as normalised bytes
+		glGenBuffers(1, &bufferObject[WEIGHTVALUE_BUFFER]);
+		glBindBuffer(GL_ARRAY_BUFFER, bufferObject[WEIGHTVALUE_BUFFER]);
+		glBufferData(GL_ARRAY_BUFFER, numVertices * 4, packedWeights, GL_STATIC_DRAW);
+		glVertexAttribPointer(WEIGHTVALUE_BUFFER, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, 0);
+		glEnableVertexAttribArray(WEIGHTVALUE_BUFFER);
+
+		glObjectLabel(GL_BUFFER, bufferObject[WEIGHTVALUE_BUFFER], -1, "Packed Weights");
+	}
+	else if (weights) {		//Buffer weights data
 		UploadAttribute(&bufferObject[WEIGHTVALUE_BUFFER], numVertices, sizeof(Vector4), 4, WEIGHTVALUE_BUFFER, weights, "Weights");
 	}
 
+	if (packedWeightIndices) {
+		glGenBuffers(1, &bufferObject[WEIGHTINDEX_BUFFER]);
+		glBindBuffer(GL_ARRAY_BUFFER, bufferObject[WEIGHTINDEX_BUFFER]);
+		glBufferData(GL_ARRAY_BUFFER, numVertices * 4, packedWeightIndices, GL_STATIC_DRAW);
+		glVertexAttribIPointer(WEIGHTINDEX_BUFFER, 4, GL_UNSIGNED_BYTE, 0, 0);
+		glEnableVertexAttribArray(WEIGHTINDEX_BUFFER);
+
+		glObjectLabel(GL_BUFFER, bufferObject[WEIGHTINDEX_BUFFER], -1, "Packed Weight Indices");
+	}
 	//Buffer weight indices data...uses a different function since its integers...
-	if (weightIndices) {
+	else if (weightIndices) {
 		glGenBuffers(1, &bufferObject[WEIGHTINDEX_BUFFER]);
 		glBindBuffer(GL_ARRAY_BUFFER, bufferObject[WEIGHTINDEX_BUFFER]);
 		glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(int) * 4, weightIndices, GL_STATIC_DRAW);
@@ -122,7 +205,7 @@ void	Mesh::BufferData()	{
 
 		glObjectLabel(GL_BUFFER, bufferObject[INDEX_BUFFER], -1, "Indices");
 	}
-	glBindVertexArray(0);	
+	GLStateCache::BindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
@@ -216,13 +299,13 @@ void ReadJointParents(std::ifstream& file, vector<int>& dest) {
 	}
 }
 
-void ReadJointNames(std::ifstream& file, vector<string>& dest) {
+void ReadJointNames(std::ifstream& file, vector<NameID>& dest) {
 	int jointCount = 0;
 	file >> jointCount;
 	for (int i = 0; i < jointCount; ++i) {
 		std::string jointName;
 		file >> jointName;
-		dest.emplace_back(jointName);
+		dest.emplace_back(NameID(jointName));
 	}
 }
 
@@ -250,14 +333,14 @@ void ReadSubMeshes(std::ifstream& file, int count, vector<Mesh::SubMesh> & subMe
 	}
 }
 
-void ReadSubMeshNames(std::ifstream& file, int count, vector<string>& names) {
+void ReadSubMeshNames(std::ifstream& file, int count, vector<NameID>& names) {
 	std::string scrap;
 	std::getline(file, scrap);
 
 	for (int i = 0; i < count; ++i) {
 		std::string meshName;
 		std::getline(file, meshName);
-		names.emplace_back(meshName);
+		names.emplace_back(NameID(meshName));
 	}
 }
 
@@ -327,6 +410,7 @@ Mesh* Mesh::LoadFromMeshFile(const string& name) {
 		}
 	}
 	//Now that the data has been read, we can shove it into the actual Mesh object
+	mesh->BuildNameLookups();
 
 	mesh->numVertices	= numVertices;
 	mesh->numIndices	= numIndices;
@@ -370,36 +454,155 @@ Mesh* Mesh::LoadFromMeshFile(const string& name) {
 		memcpy(mesh->weightIndices, readWeightIndices.data(), numVertices * sizeof(int) * 4);
 	}
 
+	if (mesh->weights && mesh->weightIndices) {
+		MeshSkinning::PruneWeights(mesh->numVertices, mesh->weights,
+			mesh->weightIndices, SKIN_WEIGHT_THRESHOLD);
+		if (mesh->indices) {
+			mesh->PartitionJoints(MAX_SKINNING_JOINTS);
+		}
+		mesh->PackSkinWeights();
+	}
+
 	mesh->BufferData();
 
 	return mesh;
 }
 
-int Mesh::GetIndexForJoint(const std::string& name) const {
-	for (unsigned int i = 0; i < jointNames.size(); ++i) {
-		if (jointNames[i] == name) {
-			return i;
-		}
+template <class T>
+void RemapVertexArray(T*& data, const vector<unsigned int>& remap) {
+	if (!data) {
+		return;
+	}
+	T* remapped = new T[remap.size()];
+	for (size_t i = 0; i < remap.size(); ++i) {
+		remapped[i] = data[remap[i]];
 	}
-	return -1;
+	delete[] data;
+	data = remapped;
 }
 
-int Mesh::GetParentForJoint(const std::string& name) const {
-	int i = GetIndexForJoint(name);
-	if (i == -1) {
+/*
+Splits every submesh into runs of triangles that each reference no more
+than maxJoints joints, so that rigs with more joints than the shader's
+palette can hold still skin correctly, and each draw only has to upload
+the joints it actually uses. Vertices on the border between two runs are
+duplicated, as their joint indices are rewritten to be local to the run.
+Rigs that already fit in the palette are left alone. Any indices no
+submesh covers are partitioned too, as submesh -1 - the vertices get
+reordered, so they can't be left pointing at the old ones.
+Must be called before BufferData.
+*/
+void Mesh::PartitionJoints(unsigned int maxJoints) {
+	if (type != GL_TRIANGLES) {
+		return;
+	}
+	int usedJoints = 0;
+	for (GLuint i = 0; i < numVertices * 4; ++i) {
+		usedJoints = std::max(usedJoints, weightIndices[i] + 1);
+	}
+	if ((unsigned int)usedJoints <= maxJoints) {
+		return;
+	}
+	vector<std::pair<int, int>> subMeshes;
+	for (const SubMesh& m : meshLayers) {
+		subMeshes.emplace_back(m.start, m.count);
+	}
+	SkinPartitionResult result;
+	MeshSkinning::PartitionMesh(result, maxJoints, weights, weightIndices,
+		indices, numIndices, subMeshes);
+
+	RemapVertexArray(vertices,		result.vertexRemap);
+	RemapVertexArray(colours,		result.vertexRemap);
+	RemapVertexArray(textureCoords,	result.vertexRemap);
+	RemapVertexArray(normals,		result.vertexRemap);
+	RemapVertexArray(tangents,		result.vertexRemap);
+	RemapVertexArray(weights,		result.vertexRemap);
+
+	delete[] weightIndices;
+	weightIndices = new int[result.weightIndices.size()];
+	memcpy(weightIndices, result.weightIndices.data(), result.weightIndices.size() * sizeof(int));
+	memcpy(indices, result.indices.data(), numIndices * sizeof(unsigned int));
+
+	numVertices		= (GLuint)result.vertexRemap.size();
+	skinPartitions	= std::move(result.partitions);
+}
+
+/*
+Builds the 8-bit weight and joint index arrays that BufferData will upload
+in place of the float ones, and works out how many influences each submesh
+actually needs. Joint indices only fit in a byte once they've been made
+local by PartitionJoints (or if the rig is small enough anyway) - if they
+don't, the mesh is left on the float path.
+*/
+void Mesh::PackSkinWeights() {
+	packedWeights		= new unsigned char[numVertices * 4];
+	packedWeightIndices	= new unsigned char[numVertices * 4];
+
+	if (!MeshSkinning::QuantiseWeights(numVertices, weights, weightIndices,
+		packedWeights, packedWeightIndices)) {
+		delete[] packedWeights;
+		delete[] packedWeightIndices;
+		packedWeights		= nullptr;
+		packedWeightIndices	= nullptr;
+	}
+
+	subMeshInfluences.clear();
+	if (!indices) {
+		return;
+	}
+	for (const SubMesh& m : meshLayers) {
+		subMeshInfluences.emplace_back(
+			MeshSkinning::CountInfluences(weights, indices, m.start, m.count));
+	}
+}
+
+float Mesh::GetBoundingRadius() const {
+	float radiusSquared = 0.0f;
+	for (GLuint i = 0; i < numVertices; ++i) {
+		radiusSquared = std::max(radiusSquared, Vector3::Dot(vertices[i], vertices[i]));
+	}
+	return sqrt(radiusSquared);
+}
+
+void Mesh::BuildNameLookups() {
+	jointLookup.clear();
+	layerLookup.clear();
+	for (int i = 0; i < (int)jointNames.size(); ++i) {
+		jointLookup.emplace(jointNames[i].GetID(), i);
+	}
+	for (int i = 0; i < (int)layerNames.size(); ++i) {
+		layerLookup.emplace(layerNames[i].GetID(), i);
+	}
+}
+
+int Mesh::GetIndexForJoint(NameID name) const {
+	auto i = jointLookup.find(name.GetID());
+	if (i == jointLookup.end()) {
 		return -1;
 	}
-	return jointParents[i];
+	return i->second;
+}
+
+int Mesh::GetIndexForJoint(const std::string& name) const {
+	return GetIndexForJoint(NameID::Find(name));
+}
+
+int Mesh::GetParentForJoint(NameID name) const {
+	return GetParentForJoint(GetIndexForJoint(name));
+}
+
+int Mesh::GetParentForJoint(const std::string& name) const {
+	return GetParentForJoint(GetIndexForJoint(name));
 }
 
 int Mesh::GetParentForJoint(int i) const {
-	if (i == -1 || i >= (int)jointParents.size()) {
+	if (i < 0 || i >= (int)jointParents.size()) {
 		return -1;
 	}
 	return jointParents[i];
 }
 
-bool Mesh::GetSubMesh(int i, const SubMesh* s) const {
+bool Mesh::GetSubMesh(int i, const SubMesh*& s) const {
 	if (i < 0 || i >= (int)meshLayers.size()) {
 		return false;
 	}
@@ -407,13 +610,137 @@ bool Mesh::GetSubMesh(int i, const SubMesh* s) const {
 	return true;
 }
 
-bool Mesh::GetSubMesh(const string& name, const SubMesh* s) const {
-	for (unsigned int i = 0; i < layerNames.size(); ++i) {
-		if (layerNames[i] == name) {
-			return GetSubMesh(i, s);
+int Mesh::GetSubMeshIndex(NameID name) const {
+	auto i = layerLookup.find(name.GetID());
+	if (i == layerLookup.end()) {
+		return -1;
+	}
+	return i->second;
+}
+
+bool Mesh::GetSubMesh(NameID name, const SubMesh*& s) const {
+	return GetSubMesh(GetSubMeshIndex(name), s);
+}
+
+bool Mesh::GetSubMesh(const string& name, const SubMesh*& s) const {
+	return GetSubMesh(NameID::Find(name), s);
+}
+
+Mesh* Mesh::GenerateCombined(const std::vector<CombinePiece>& pieces) {
+	bool hasColours		= false;
+	bool hasTexCoords	= false;
+	bool hasNormals		= false;
+	bool hasTangents	= false;
+	for (const CombinePiece& p : pieces) {
+		hasColours		|= p.mesh->colours != nullptr;
+		hasTexCoords	|= p.mesh->textureCoords != nullptr;
+		hasNormals		|= p.mesh->normals != nullptr;
+		hasTangents		|= p.mesh->tangents != nullptr;
+	}
+	std::vector<Vector3>		outVertices;
+	std::vector<Vector4>		outColours;
+	std::vector<Vector2>		outTexCoords;
+	std::vector<Vector3>		outNormals;
+	std::vector<Vector4>		outTangents;
+	std::vector<unsigned int>	outIndices;
+	std::vector<unsigned int>	sourceIndices;
+	std::vector<int>			remap;
+
+	for (const CombinePiece& p : pieces) {
+		const Mesh* src = p.mesh;
+		int start	= 0;
+		int count	= src->indices ? src->numIndices : src->numVertices;
+		if (p.subMesh >= 0 && p.subMesh < (int)src->meshLayers.size()) {
+			start	= src->meshLayers[p.subMesh].start;
+			count	= src->meshLayers[p.subMesh].count;
+		}
+		//Normals need the inverse transpose, in case of any non-uniform scale
+		const Matrix4 inverse = p.transform.Inverse();
+
+		//Strips get unrolled into separate triangles, flipping every other
+		//one so they all keep the same winding
+		sourceIndices.clear();
+		for (int i = start; i < start + count; ++i) {
+			sourceIndices.emplace_back(src->indices ? src->indices[i] : (unsigned int)i);
+		}
+		if (src->type == GL_TRIANGLE_STRIP) {
+			std::vector<unsigned int> strip;
+			strip.swap(sourceIndices);
+			for (size_t i = 2; i < strip.size(); ++i) {
+				sourceIndices.emplace_back(strip[i - 2]);
+				sourceIndices.emplace_back(strip[(i % 2) ? i : i - 1]);
+				sourceIndices.emplace_back(strip[(i % 2) ? i - 1 : i]);
+			}
 		}
+
+		//Only copy the vertices this piece actually uses, and each just once
+		remap.assign(src->numVertices, -1);
+		for (unsigned int v : sourceIndices) {
+			if (remap[v] < 0) {
+				remap[v] = (int)outVertices.size();
+				outVertices.emplace_back(p.transform * src->vertices[v]);
+				if (hasColours) {
+					outColours.emplace_back(src->colours ? src->colours[v] : Vector4(1, 1, 1, 1));
+				}
+				if (hasTexCoords) {
+					outTexCoords.emplace_back(src->textureCoords ? src->textureCoords[v] : Vector2());
+				}
+				if (hasNormals) {
+					Vector3 n;
+					if (src->normals) {
+						const Vector3& sn = src->normals[v];
+						n = Vector3(
+							Vector3::Dot(Vector3(inverse.values[0], inverse.values[1], inverse.values[2]), sn),
+							Vector3::Dot(Vector3(inverse.values[4], inverse.values[5], inverse.values[6]), sn),
+							Vector3::Dot(Vector3(inverse.values[8], inverse.values[9], inverse.values[10]), sn));
+						n.Normalise();
+					}
+					outNormals.emplace_back(n);
+				}
+				if (hasTangents) {
+					Vector4 t;
+					if (src->tangents) {
+						const Vector4& st = src->tangents[v];
+						Vector4 moved = p.transform * Vector4(st.x, st.y, st.z, 0.0f);
+						Vector3 dir(moved.x, moved.y, moved.z);
+						dir.Normalise();
+						t = Vector4(dir.x, dir.y, dir.z, st.w);
+					}
+					outTangents.emplace_back(t);
+				}
+			}
+			outIndices.emplace_back((unsigned int)remap[v]);
+		}
+	}
+
+	Mesh* m = new Mesh();
+	m->type			= GL_TRIANGLES;
+	m->numVertices	= (GLuint)outVertices.size();
+	m->numIndices	= (GLuint)outIndices.size();
+
+	m->vertices = new Vector3[m->numVertices];
+	std::copy(outVertices.begin(), outVertices.end(), m->vertices);
+	if (hasColours) {
+		m->colours = new Vector4[m->numVertices];
+		std::copy(outColours.begin(), outColours.end(), m->colours);
 	}
-	return false;
+	if (hasTexCoords) {
+		m->textureCoords = new Vector2[m->numVertices];
+		std::copy(outTexCoords.begin(), outTexCoords.end(), m->textureCoords);
+	}
+	if (hasNormals) {
+		m->normals = new Vector3[m->numVertices];
+		std::copy(outNormals.begin(), outNormals.end(), m->normals);
+	}
+	if (hasTangents) {
+		m->tangents = new Vector4[m->numVertices];
+		std::copy(outTangents.begin(), outTangents.end(), m->tangents);
+	}
+	m->indices = new unsigned int[m->numIndices];
+	std::copy(outIndices.begin(), outIndices.end(), m->indices);
+
+	m->BufferData();
+	return m;
 }
 
 Mesh* Mesh::GenerateTriangle() {
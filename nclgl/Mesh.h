@@ -19,8 +19,11 @@ _-_-_-_-_-_-_-""  ""
 #pragma once
 
 #include "OGLRenderer.h"
+#include "MeshSkinning.h"
+#include "NameID.h"
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 //A handy enumerator, to determine which member of the bufferObject array
 //holds which data
@@ -40,17 +43,34 @@ enum MeshBuffer {
 };
 
 class Mesh	{
+	//Copies the vertex data out
+	friend class GeometryArena;
 public:	
 	struct SubMesh {
 		int start;
 		int count;
 	};
 
+	//Must match the size of the joints array in SkinningVertex.glsl
+	static const unsigned int MAX_SKINNING_JOINTS = 128;
+	//Influences lighter than this are dropped when a skinned mesh is loaded
+	static constexpr float SKIN_WEIGHT_THRESHOLD = 0.01f;
+	//Per-instance index into the ObjectBuffer - past everything in MeshBuffer
+	static const GLuint DRAW_ID_ATTRIBUTE = 8;
+
 	Mesh(void);
 	~Mesh(void);
 
 	void Draw();
 	void DrawSubMesh(int i);
+	void DrawSkinPartition(int i);
+
+	//Points the drawID attribute at a buffer of uints, one per instance.
+	//Only does any work if the buffer has changed
+	void SetDrawIDBuffer(GLuint buffer);
+	//Draws count copies, with drawIDs from baseInstance onwards
+	void DrawInstanced(int count, int baseInstance);
+	void DrawSubMeshInstanced(int i, int count, int baseInstance);
 
 	static Mesh* LoadFromMeshFile(const std::string& name);
 
@@ -64,10 +84,21 @@ public:
 	}
 
 
+	//The NameID overloads are O(1) and never allocate, so prefer them for
+	//anything done every frame - intern the name once and keep it
 	int GetIndexForJoint(const std::string& name) const;
+	int GetIndexForJoint(NameID name) const;
 	int GetParentForJoint(const std::string& name) const;
+	int GetParentForJoint(NameID name) const;
 	int GetParentForJoint(int i) const;
 
+	NameID GetJointName(int i) const {
+		if (i < 0 || i >= (int)jointNames.size()) {
+			return NameID();
+		}
+		return jointNames[i];
+	}
+
 	const Matrix4* GetBindPose() const {
 		return bindPose;
 	}
@@ -80,8 +111,47 @@ public:
 		return (int)meshLayers.size(); 
 	}
 
-	bool GetSubMesh(int i, const SubMesh* s) const;
-	bool GetSubMesh(const std::string& name, const SubMesh* s) const;
+	bool GetSubMesh(int i, const SubMesh*& s) const;
+	bool GetSubMesh(const std::string& name, const SubMesh*& s) const;
+	bool GetSubMesh(NameID name, const SubMesh*& s) const;
+
+	int		GetSubMeshIndex(NameID name) const;
+
+	int		GetSkinPartitionCount() const {
+		return (int)skinPartitions.size();
+	}
+
+	const SkinPartition& GetSkinPartition(int i) const {
+		return skinPartitions[i];
+	}
+
+	//1, 2 or 4 - how far the skinning shader has to loop for this submesh
+	int		GetSubMeshInfluenceCount(int i) const {
+		if (i < 0 || i >= (int)subMeshInfluences.size()) {
+			return MeshSkinning::MAX_INFLUENCES;
+		}
+		return subMeshInfluences[i];
+	}
+
+	//Radius of a sphere around the mesh origin that holds every vertex
+	float	GetBoundingRadius() const;
+
+	bool	HasNormals() const { return normals != NULL; }
+
+	//Small, stable number for this mesh, for building render sort keys
+	unsigned int GetSortID() const { return sortID; }
+
+	//Part of a combined mesh - one submesh of another mesh (or all of it,
+	//if subMesh is -1), and the transform to bake into its vertices
+	struct CombinePiece {
+		const Mesh*	mesh;
+		int			subMesh;
+		Matrix4		transform;
+	};
+	//Bakes the pieces into one triangle list, to draw with a single call.
+	//Takes triangle lists or strips, and anything skinned goes in as its
+	//bind pose
+	static Mesh* GenerateCombined(const std::vector<CombinePiece>& pieces);
 
 	static Mesh* GenerateTriangle();
 
@@ -96,8 +166,13 @@ public:
 
 protected:
 	void	BufferData();
+	void	PartitionJoints(unsigned int maxJoints);
+	void	PackSkinWeights();
 
 	GLuint	arrayObject;
+	GLuint	drawIDBuffer;
+	unsigned int sortID;
+	static unsigned int nextSortID;
 
 	GLuint	bufferObject[MAX_BUFFER];
 
@@ -115,15 +190,27 @@ protected:
 	Vector4*		weights;
 	int*			weightIndices;
 
+	//8-bit copies of the above, which are what gets sent to the GPU if present
+	unsigned char*	packedWeights;
+	unsigned char*	packedWeightIndices;
+
 	unsigned int*	indices;
 
 	Matrix4* bindPose;
 	Matrix4* inverseBindPose;
 
-	std::vector<std::string>	jointNames;
+	void	BuildNameLookups();
+
+	std::vector<NameID>			jointNames;
 	std::vector<int>			jointParents;
 	std::vector< SubMesh>		meshLayers;
-	std::vector<std::string>	layerNames;
+	std::vector<NameID>			layerNames;
+
+	//NameID -> index into the above, built once at load
+	std::unordered_map<unsigned int, int>	jointLookup;
+	std::unordered_map<unsigned int, int>	layerLookup;
+	std::vector<SkinPartition>	skinPartitions;
+	std::vector<int>			subMeshInfluences;
 
 	Vector4 GenerateTangent(int a, int b, int c);
 };
@@ -0,0 +1,264 @@
+#include "MeshSkinning.h"
+#include <algorithm>
+#include <unordered_map>
+
+static float GetInfluenceWeight(const Vector4& w, int i) {
+	return ((const float*)&w)[i];
+}
+
+//Writes the sorted, unique set of joints with a non-zero weight used by
+//the three vertices of a triangle into 'joints', returning how many.
+static int GatherTriangleJoints(const Vector4* weights, const int* weightIndices,
+	const unsigned int* tri, int* joints) {
+	int count = 0;
+	for (int v = 0; v < 3; ++v) {
+		for (int i = 0; i < MeshSkinning::MAX_INFLUENCES; ++i) {
+			if (GetInfluenceWeight(weights[tri[v]], i) <= 0.0f) {
+				continue;
+			}
+			joints[count++] = weightIndices[(tri[v] * 4) + i];
+		}
+	}
+	std::sort(joints, joints + count);
+	return (int)(std::unique(joints, joints + count) - joints);
+}
+
+struct OpenPartition {
+	std::vector<int>			joints;		//kept sorted
+	std::vector<unsigned int>	triangles;	//offsets of first index
+};
+
+void MeshSkinning::PartitionJoints(SkinPartitionResult& out, unsigned int maxJoints,
+	const Vector4* weights, const int* weightIndices,
+	const unsigned int* indices, int subMesh, int start, int count) {
+	if (maxJoints < MIN_PARTITION_JOINTS) {
+		maxJoints = MIN_PARTITION_JOINTS;
+	}
+
+	std::vector<OpenPartition> open;
+	int triJoints[3 * MAX_INFLUENCES];
+
+	//First fit - each triangle goes into the first partition that still has
+	//room for the joints it would add, which keeps triangle order mostly intact
+	for (int t = start; t + 2 < start + count; t += 3) {
+		int numJoints = GatherTriangleJoints(weights, weightIndices, &indices[t], triJoints);
+
+		size_t p = 0;
+		for (; p < open.size(); ++p) {
+			size_t added = 0;
+			for (int j = 0; j < numJoints; ++j) {
+				if (!std::binary_search(open[p].joints.begin(), open[p].joints.end(), triJoints[j])) {
+					++added;
+				}
+			}
+			if (open[p].joints.size() + added <= maxJoints) {
+				break;
+			}
+		}
+		if (p == open.size()) {
+			open.emplace_back();
+		}
+		std::vector<int>& joints = open[p].joints;
+		for (int j = 0; j < numJoints; ++j) {
+			auto at = std::lower_bound(joints.begin(), joints.end(), triJoints[j]);
+			if (at == joints.end() || *at != triJoints[j]) {
+				joints.insert(at, triJoints[j]);
+			}
+		}
+		open[p].triangles.emplace_back(t);
+	}
+
+	//Now lay each partition out contiguously, giving every partition its own
+	//copy of the vertices it uses so their joint indices can be made local
+	int writePos = start;
+	for (const OpenPartition& p : open) {
+		SkinPartition part;
+		part.subMesh	= subMesh;
+		part.start		= writePos;
+		part.joints		= p.joints;
+		if (part.joints.empty()) {
+			part.joints.emplace_back(0);
+		}
+
+		std::unordered_map<unsigned int, unsigned int> localVertices;
+		for (unsigned int t : p.triangles) {
+			for (int k = 0; k < 3; ++k) {
+				unsigned int src = indices[t + k];
+				auto found = localVertices.find(src);
+				if (found != localVertices.end()) {
+					out.indices[writePos++] = found->second;
+					continue;
+				}
+				unsigned int newIndex = (unsigned int)out.vertexRemap.size();
+				out.vertexRemap.emplace_back(src);
+				localVertices[src] = newIndex;
+
+				for (int i = 0; i < MAX_INFLUENCES; ++i) {
+					int local = 0;
+					if (GetInfluenceWeight(weights[src], i) > 0.0f) {
+						local = (int)(std::lower_bound(part.joints.begin(), part.joints.end(),
+							weightIndices[(src * 4) + i]) - part.joints.begin());
+					}
+					out.weightIndices.emplace_back(local);
+				}
+				out.indices[writePos++] = newIndex;
+			}
+		}
+		part.count = writePos - part.start;
+		out.partitions.emplace_back(part);
+	}
+}
+
+void MeshSkinning::PartitionMesh(SkinPartitionResult& out, unsigned int maxJoints,
+	const Vector4* weights, const int* weightIndices,
+	const unsigned int* indices, unsigned int numIndices,
+	const std::vector<std::pair<int, int>>& subMeshes) {
+	out.indices.assign(indices, indices + numIndices);
+
+	std::vector<bool> covered(numIndices, false);
+	for (int i = 0; i < (int)subMeshes.size(); ++i) {
+		const int start = subMeshes[i].first;
+		const int count = subMeshes[i].second;
+		PartitionJoints(out, maxJoints, weights, weightIndices,
+			indices, i, start, count);
+		for (int j = start; j < start + count && j < (int)numIndices; ++j) {
+			covered[j] = true;
+		}
+	}
+	for (unsigned int start = 0; start < numIndices; ) {
+		if (covered[start]) {
+			++start;
+			continue;
+		}
+		unsigned int end = start;
+		while (end < numIndices && !covered[end]) {
+			++end;
+		}
+		PartitionJoints(out, maxJoints, weights, weightIndices,
+			indices, -1, (int)start, (int)(end - start));
+		start = end;
+	}
+}
+
+void MeshSkinning::PruneWeights(unsigned int numVertices, Vector4* weights,
+	int* weightIndices, float threshold) {
+	for (unsigned int v = 0; v < numVertices; ++v) {
+		float*	w = (float*)&weights[v];
+		int*	j = &weightIndices[v * 4];
+
+		//Insertion sort by descending weight - there's only four of them!
+		for (int i = 1; i < MAX_INFLUENCES; ++i) {
+			for (int k = i; k > 0 && w[k] > w[k - 1]; --k) {
+				std::swap(w[k], w[k - 1]);
+				std::swap(j[k], j[k - 1]);
+			}
+		}
+
+		float total = 0.0f;
+		for (int i = 0; i < MAX_INFLUENCES; ++i) {
+			//always keep the heaviest influence, or the vertex would collapse
+			if (i > 0 && w[i] < threshold) {
+				w[i] = 0.0f;
+			}
+			if (w[i] <= 0.0f) {
+				w[i] = 0.0f;
+				j[i] = 0;
+			}
+			total += w[i];
+		}
+		if (total <= 0.0f) {
+			continue;
+		}
+		for (int i = 0; i < MAX_INFLUENCES; ++i) {
+			w[i] /= total;
+		}
+	}
+}
+
+bool MeshSkinning::QuantiseWeights(unsigned int numVertices, const Vector4* weights,
+	const int* weightIndices, unsigned char* packedWeights,
+	unsigned char* packedIndices) {
+	for (unsigned int v = 0; v < numVertices * MAX_INFLUENCES; ++v) {
+		if (weightIndices[v] < 0 || weightIndices[v] > 255) {
+			return false;
+		}
+	}
+	for (unsigned int v = 0; v < numVertices; ++v) {
+		const float*	w		= (const float*)&weights[v];
+		unsigned char*	outW	= &packedWeights[v * 4];
+		int				total	= 0;
+		int				largest	= 0;
+
+		for (int i = 0; i < MAX_INFLUENCES; ++i) {
+			float clamped = std::min(std::max(w[i], 0.0f), 1.0f);
+			outW[i] = (unsigned char)(clamped * 255.0f + 0.5f);
+			total += outW[i];
+			packedIndices[(v * 4) + i] = (unsigned char)weightIndices[(v * 4) + i];
+			if (outW[i] > outW[largest]) {
+				largest = i;
+			}
+		}
+		//Rounding can leave the sum a step or two off 255, which would make
+		//the vertex drift - push the error onto the heaviest influence
+		if (total > 0) {
+			outW[largest] = (unsigned char)(outW[largest] + (255 - total));
+		}
+	}
+	return true;
+}
+
+int MeshSkinning::CountInfluences(const Vector4* weights,
+	const unsigned int* indices, int start, int count) {
+	int influences = 1;
+	for (int i = start; i < start + count && influences < MAX_INFLUENCES; ++i) {
+		const Vector4& w = weights[indices[i]];
+		if (w.z > 0.0f || w.w > 0.0f) {
+			influences = MAX_INFLUENCES;
+		}
+		else if (w.y > 0.0f) {
+			influences = 2;
+		}
+	}
+	return influences;
+}
+
+Vector3 MeshSkinning::SkinPosition(const Vector3& position, const Vector4& weights,
+	const int* jointIndices, const Matrix4* palette) {
+	Vector4 localPos(position.x, position.y, position.z, 1.0f);
+	Vector4 skelPos(0, 0, 0, 0);
+
+	for (int i = 0; i < MAX_INFLUENCES; ++i) {
+		float w = GetInfluenceWeight(weights, i);
+		if (w <= 0.0f) {
+			continue;
+		}
+		skelPos += (palette[jointIndices[i]] * localPos) * w;
+	}
+	return Vector3(skelPos.x, skelPos.y, skelPos.z);
+}
+
+float MeshSkinning::CompareToUnpartitioned(const SkinPartitionResult& result,
+	const Vector3* positions, const Vector4* weights,
+	const int* weightIndices, const Matrix4* palette) {
+	float maxError = 0.0f;
+	std::vector<Matrix4> localPalette;
+
+	for (const SkinPartition& p : result.partitions) {
+		localPalette.clear();
+		for (int j : p.joints) {
+			localPalette.emplace_back(palette[j]);
+		}
+		for (int i = p.start; i < p.start + p.count; ++i) {
+			unsigned int v		= result.indices[i];
+			unsigned int src	= result.vertexRemap[v];
+
+			Vector3 expected = SkinPosition(positions[src], weights[src],
+				&weightIndices[src * 4], palette);
+			Vector3 actual = SkinPosition(positions[src], weights[src],
+				&result.weightIndices[v * 4], localPalette.data());
+
+			maxError = std::max(maxError, (expected - actual).Length());
+		}
+	}
+	return maxError;
+}
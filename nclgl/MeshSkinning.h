@@ -0,0 +1,80 @@
+#pragma once
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix4.h"
+#include <utility>
+#include <vector>
+
+/*
+Load-time helpers for skinned meshes. Everything in here works on plain
+CPU-side arrays, so it can be run (and checked) without a GL context.
+*/
+
+// A run of indices inside a submesh whose triangles only touch the joints
+// in 'joints'. The joint indices of the vertices drawn by this run are
+// local slots into 'joints', rather than global joint indices.
+struct SkinPartition {
+	int					subMesh;
+	int					start;
+	int					count;
+	std::vector<int>	joints;
+};
+
+struct SkinPartitionResult {
+	std::vector<unsigned int>	vertexRemap;	// new vertex -> source vertex
+	std::vector<int>			weightIndices;	// 4 per new vertex, partition-local
+	std::vector<unsigned int>	indices;		// same layout as the source indices
+	std::vector<SkinPartition>	partitions;
+};
+
+class MeshSkinning {
+public:
+	static const int MAX_INFLUENCES = 4;
+	// One triangle can touch up to 3 * MAX_INFLUENCES joints, so a partition
+	// can never be smaller than that.
+	static const unsigned int MIN_PARTITION_JOINTS = 3 * MAX_INFLUENCES;
+
+	// Splits the triangles in [start, start + count) of 'indices' into runs
+	// that each reference at most 'maxJoints' joints. Vertices shared between
+	// runs are duplicated. 'out.indices' must already hold a copy of the
+	// source indices - only the given range is rewritten.
+	static void PartitionJoints(SkinPartitionResult& out, unsigned int maxJoints,
+		const Vector4* weights, const int* weightIndices,
+		const unsigned int* indices, int subMesh, int start, int count);
+
+	// Partitions a whole mesh: each submesh, given as a (start, count) pair,
+	// and then every run of indices no submesh covers, as submesh -1 - the
+	// vertices get reordered, so those can't be left pointing at the old ones.
+	// Fills in 'out.indices' itself.
+	static void PartitionMesh(SkinPartitionResult& out, unsigned int maxJoints,
+		const Vector4* weights, const int* weightIndices,
+		const unsigned int* indices, unsigned int numIndices,
+		const std::vector<std::pair<int, int>>& subMeshes);
+
+	// Drops influences with a weight below 'threshold', sorts what is left by
+	// descending weight and renormalises it to sum to one. Dropped slots get
+	// a weight of zero and a joint index of zero.
+	static void PruneWeights(unsigned int numVertices, Vector4* weights,
+		int* weightIndices, float threshold);
+
+	// Packs weights into 8-bit unorms that still sum to exactly 255, and
+	// joint indices into bytes. Fails if any joint index is above 255.
+	static bool QuantiseWeights(unsigned int numVertices, const Vector4* weights,
+		const int* weightIndices, unsigned char* packedWeights,
+		unsigned char* packedIndices);
+
+	// How many influences the vertex shader must loop over to draw the given
+	// index range of pruned, sorted weights - always 1, 2 or 4.
+	static int CountInfluences(const Vector4* weights,
+		const unsigned int* indices, int start, int count);
+
+	static Vector3 SkinPosition(const Vector3& position, const Vector4& weights,
+		const int* jointIndices, const Matrix4* palette);
+
+	// Skins every partitioned vertex twice - once through its partition's
+	// local palette, once through the full palette with the source joint
+	// indices - and returns the largest positional difference.
+	static float CompareToUnpartitioned(const SkinPartitionResult& result,
+		const Vector3* positions, const Vector4* weights,
+		const int* weightIndices, const Matrix4* palette);
+};
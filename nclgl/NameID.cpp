@@ -0,0 +1,32 @@
+#include "NameID.h"
+
+std::vector<std::string>						NameID::names;
+std::unordered_map<std::string, unsigned int>	NameID::lookup;
+
+unsigned int NameID::Intern(const std::string& name) {
+	auto i = lookup.find(name);
+	if (i != lookup.end()) {
+		return i->second;
+	}
+	unsigned int id = (unsigned int)names.size();
+	names.emplace_back(name);
+	lookup.emplace(name, id);
+	return id;
+}
+
+NameID NameID::Find(const std::string& name) {
+	NameID n;
+	auto i = lookup.find(name);
+	if (i != lookup.end()) {
+		n.id = i->second;
+	}
+	return n;
+}
+
+const std::string& NameID::GetString() const {
+	static const std::string invalid;
+	if (id >= names.size()) {
+		return invalid;
+	}
+	return names[id];
+}
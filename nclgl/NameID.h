@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/*
+A string interned into one global table, so it can be stored, compared and
+hashed as a single integer. Make these once - at load time, or when setting
+up gameplay code - and keep them around: constructing one from a string
+costs a hash lookup, but after that copies and comparisons are free.
+
+Interning isn't thread safe, so don't create new names from worker threads.
+*/
+class NameID {
+public:
+	static const unsigned int INVALID = 0xFFFFFFFF;
+
+	NameID() : id(INVALID) {}
+	explicit NameID(const std::string& name) : id(Intern(name)) {}
+
+	//Looks a name up without adding it to the table - returns an invalid
+	//NameID if it has never been interned.
+	static NameID Find(const std::string& name);
+
+	unsigned int		GetID()		const { return id; }
+	bool				IsValid()	const { return id != INVALID; }
+	const std::string&	GetString()	const;
+
+	bool operator==(const NameID& a) const { return id == a.id; }
+	bool operator!=(const NameID& a) const { return id != a.id; }
+
+protected:
+	static unsigned int Intern(const std::string& name);
+
+	unsigned int id;
+
+	static std::vector<std::string>						names;
+	static std::unordered_map<std::string, unsigned int>	lookup;
+};
@@ -14,7 +14,9 @@ _-_-_-_-_-_-_-""  ""
 */
 #include "OGLRenderer.h"
 #include "Shader.h"
+#include "HeapCounter.h"
 #include <algorithm>
+#include <cstring>
 
 using std::string;
 
@@ -26,8 +28,9 @@ static const float biasValues[16] = {
 	0.0, 0.0, 0.5, 0.0,
 	0.5, 0.5, 0.5, 1.0
 };
-static const Matrix4 biasMatrix(biasValues);
+const Matrix4 biasMatrix(biasValues);
 
+#ifdef _WIN32
 /*
 Creates an OpenGL 3.2 CORE PROFILE rendering context. Sets itself
 as the current renderer of the passed 'parent' Window. Not the best
@@ -35,6 +38,10 @@ way to do it - but it kept the Tutorial code down to a minimum!
 */
 OGLRenderer::OGLRenderer(Window &window)	{
 	init					= false;
+	renderContext			= 0;
+#ifdef NCLGL_HEADLESS
+	headless				= NULL;
+#endif
 	HWND windowHandle = window.GetHandle();
 
 	// Did We Get A Device Context?
@@ -132,7 +139,42 @@ OGLRenderer::OGLRenderer(Window &window)	{
 	wglDeleteContext(tempContext);	//We don't need the temporary context any more!
 
 	//If we get this far, everything's going well!
+	InitialiseGL();
+
+	window.SetRenderer(this);					//Tell our window about the new renderer! (Which will in turn resize the renderer window to fit...)
+}
+#endif
+
+#ifdef NCLGL_HEADLESS
+/*
+Creates a context with no window at all, through EGL, so renderers can
+run on machines with no display. Everything that would have gone to the
+window's back buffer goes into an offscreen framebuffer instead, which
+SaveFrame can write out. If the context can't be made, headless is left
+NULL, so a derived renderer can tell not to go on and load anything.
+*/
+OGLRenderer::OGLRenderer(int width, int height)	{
+	init		= false;
+#ifdef _WIN32
+	renderContext	= 0;
+#endif
+	headless	= new HeadlessContext(width, height);
+	if (!headless->HasInitialised()) {
+		std::cout << "OGLRenderer::OGLRenderer(): Cannot create a headless context!\n";
+		delete headless;
+		headless = NULL;
+		return;
+	}
+	InitialiseGL();
+	Resize(headless->GetWidth(), headless->GetHeight());
+}
 
+bool OGLRenderer::SaveFrame(const std::string& filename) const {
+	return headless && headless->SaveImage(filename);
+}
+#endif
+
+void OGLRenderer::InitialiseGL() {
 #ifdef OPENGL_DEBUGGING
 	glDebugMessageCallbackARB(&OGLRenderer::DebugCallback, NULL);
 	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
@@ -141,15 +183,26 @@ OGLRenderer::OGLRenderer(Window &window)	{
 	glClearColor(0.2f,0.2f,0.2f,1.0f);			//When we clear the screen, we want it to be dark grey
 
 	currentShader = 0;							//0 is the 'null' object name for shader programs...
-
-	window.SetRenderer(this);					//Tell our window about the new renderer! (Which will in turn resize the renderer window to fit...)
+	frameBlockWritten = false;
+	lightBlockWritten = false;
+	GLStateCache::Invalidate();					//Nothing is known to be bound in a new context
+	Profiler::SetThreadName("Main");
 }
 
 /*
 Destructor. Deletes the default shader, and the OpenGL rendering context.
 */
 OGLRenderer::~OGLRenderer(void)	{
-	wglDeleteContext(renderContext);
+	uniformRing.Release();
+	Profiler::Release();
+#ifdef NCLGL_HEADLESS
+	delete headless;
+#endif
+#ifdef _WIN32
+	if (renderContext) {
+		wglDeleteContext(renderContext);
+	}
+#endif
 }
 
 /*
@@ -160,6 +213,14 @@ bool OGLRenderer::HasInitialised() const{
 	return init;
 }
 
+bool OGLRenderer::IsHeadless() const {
+#ifdef NCLGL_HEADLESS
+	return headless != NULL;
+#else
+	return false;
+#endif
+}
+
 /*
 Resizes the rendering area. Should only be called by the Window class!
 Does lower bounds checking on input values, so should be reasonably safe
@@ -179,7 +240,27 @@ your application.
 void OGLRenderer::SwapBuffers() {
 	//We call the windows OS SwapBuffers on win32. Wrapping it in this 
 	//function keeps all the tutorial code 100% cross-platform (kinda).
-	::SwapBuffers(deviceContext);
+	//Headless, there's nothing to present, so the frame is just flushed -
+	//the uniform ring's fences stop it running more than a few frames ahead
+#ifdef NCLGL_HEADLESS
+	if (headless) {
+		glFlush();
+	}
+#endif
+#ifdef _WIN32
+	if (renderContext) {
+		::SwapBuffers(deviceContext);
+	}
+#endif
+	frameAllocator.BeginFrame();
+	HeapCounter::BeginFrame();
+	Shader::BeginFrameCounts();
+	GLStateCache::BeginFrame();
+	//Last frame's blocks live in a region that's about to be reused
+	uniformRing.NextFrame();
+	frameBlockWritten = false;
+	lightBlockWritten = false;
+	Profiler::NextFrame();
 }
 /*
 Used by some later tutorials when we want to have framerate-independent
@@ -196,25 +277,34 @@ void OGLRenderer::UpdateScene(float msec)	{
 }
 
 /*
-Updates the uniform matrices of the current shader. Assumes that
-the shader has uniform matrices called modelMatrix, viewMatrix,
-projMatrix, and textureMatrix. Updates them with the relevant
-matrix data. Sanity checks currentShader, so is always safe to
-call.
+Updates the uniform matrices of the current shader. The view and
+projection matrices, and the camera position, go in the FrameData
+uniform block, which is only written again if they've changed - the
+per-object modelMatrix, textureMatrix and shadowMatrix are still
+plain uniforms, set on the current shader. Sanity checks
+currentShader, so is always safe to call.
 */
 void OGLRenderer::UpdateShaderMatrices()	{
+	FrameBlock block;
+	block.viewMatrix	= viewMatrix;
+	block.projMatrix	= projMatrix;
+	block.cameraPos		= cameraPos;
+	block.padding		= 0.0f;
+	if (!frameBlockWritten || memcmp(&block, &frameBlock, sizeof(block)) != 0) {
+		frameBlock			= block;
+		frameBlockWritten	= true;
+		uniformRing.Bind(FRAME_DATA_BINDING, frameBlock);
+	}
 	if(currentShader) {
-		glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "modelMatrix")   ,	1,false, modelMatrix.values);
-		glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "viewMatrix")    ,	1,false, viewMatrix.values);
-		glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "projMatrix")    ,	1,false, projMatrix.values);
-		glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "textureMatrix") , 1,false, textureMatrix.values);
-		glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "shadowMatrix")  , 1,false, shadowMatrix.values);
+		currentShader->SetUniform(UNIFORM("modelMatrix")	, modelMatrix);
+		currentShader->SetUniform(UNIFORM("textureMatrix")	, textureMatrix);
+		currentShader->SetUniform(UNIFORM("shadowMatrix")	, shadowMatrix);
 	}
 }
 
 void OGLRenderer::BindShader(Shader*s) {
 	currentShader = s;
-	glUseProgram(s->GetProgram());
+	GLStateCache::UseProgram(s->GetProgram());
 }
 
 #ifdef OPENGL_DEBUGGING
@@ -259,19 +349,27 @@ void OGLRenderer::DebugCallback(GLenum source, GLenum type, GLuint id, GLenum se
 #endif
 
 void OGLRenderer::SetTextureRepeating(GLuint target, bool repeating) {
-	glBindTexture(GL_TEXTURE_2D, target);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, target);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
 		repeating ? GL_REPEAT : GL_CLAMP);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
 		repeating ? GL_REPEAT : GL_CLAMP);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
+/*
+Writes the light into the LightData uniform block, if it isn't
+what's in there already. Every shader reads the same block, so
+this doesn't need a shader bound.
+*/
 void OGLRenderer::SetShaderLight(const Light& l) {
-	glUniform3fv(glGetUniformLocation(currentShader->GetProgram(),
-		"lightPos"), 1, (float*)&l.GetPosition());
-	glUniform4fv(glGetUniformLocation(currentShader->GetProgram(),
-		"lightColour"), 1, (float*)&l.GetColour());
-	glUniform1f(glGetUniformLocation(currentShader->GetProgram(),
-		"lightRadius"), l.GetRadius());
+	LightBlock block;
+	block.lightColour	= l.GetColour();
+	block.lightPos		= l.GetPosition();
+	block.lightRadius	= l.GetRadius();
+	if (!lightBlockWritten || memcmp(&block, &lightBlock, sizeof(block)) != 0) {
+		lightBlock			= block;
+		lightBlockWritten	= true;
+		uniformRing.Bind(LIGHT_DATA_BINDING, lightBlock);
+	}
 }
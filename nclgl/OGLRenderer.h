@@ -13,17 +13,19 @@ _-_-_-_-_-_-_-|   /\_/\   NYANYANYAN
 _-_-_-_-_-_-_-""  ""   
 
 */
-#include "Common.h"
+#include "common.h"
 
 #include <string>
 #include <fstream>
 #include <vector>
 
-#include "KHR\khrplatform.h"
-#include "glad\glad.h"
+#include "KHR/khrplatform.h"
+#include "glad/glad.h"
 
+#ifdef _WIN32
 #include "GL/GL.h"
 #include "KHR/WGLext.h"
+#endif
 
 #include "SOIL/SOIL.h"
 
@@ -32,11 +34,18 @@ _-_-_-_-_-_-_-""  ""
 #include "Vector2.h"
 #include "Quaternion.h"
 #include "Matrix4.h"
+#ifdef _WIN32
 #include "Window.h"
+#endif
 #include "Shader.h"
 #include "Mesh.h"
 #include "Camera.h"
 #include "Light.h"
+#include "FrameAllocator.h"
+#include "GLStateCache.h"
+#include "UniformRing.h"
+#include "HeadlessContext.h"
+#include "Profiler.h"
 
 using std::vector;
 
@@ -49,8 +58,16 @@ class Shader;
 
 class OGLRenderer	{
 public:
+#ifdef _WIN32
 	friend class Window;
 	OGLRenderer(Window &parent);
+#endif
+#ifdef NCLGL_HEADLESS
+	//No window - draws into an offscreen framebuffer of this size instead
+	OGLRenderer(int width, int height);
+	//Saves what's been drawn so far this frame
+	bool			SaveFrame(const std::string& filename) const;
+#endif
 	virtual ~OGLRenderer(void);
 
 	virtual void	RenderScene()		= 0;
@@ -58,17 +75,31 @@ public:
 	void			SwapBuffers();
 
 	bool			HasInitialised() const;	
+	bool			IsHeadless() const;
+
+	//For anything that only needs to last until the end of the next frame
+	FrameAllocator&	GetFrameAllocator() const { return frameAllocator; }
 	
 protected:
 	virtual void	Resize(int x, int y);	
 	void			UpdateShaderMatrices();
 	void			BindShader(Shader*s);
 
+	//Each debug group is timed by the profiler too, on the CPU and GPU
 	void StartDebugGroup(const std::string& s) {
 		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, (GLsizei)s.length(), s.c_str());
+		if (Profiler::IsEnabled()) {
+			const char* name = Profiler::Intern(s);
+			Profiler::BeginCPU(name);
+			Profiler::BeginGPU(name);
+		}
 	}
 
 	void EndDebugGroup() {
+		if (Profiler::IsEnabled()) {
+			Profiler::EndGPU();
+			Profiler::EndCPU();
+		}
 		glPopDebugGroup();
 	}
 
@@ -77,6 +108,7 @@ protected:
 	Matrix4 viewMatrix;		//View matrix
 	Matrix4 textureMatrix;	//Texture matrix
 	Matrix4 shadowMatrix;
+	Vector3 cameraPos;		//World space camera position, for lighting
 
 	int		width;			//Render area width (not quite the same as window width)
 	int		height;			//Render area height (not quite the same as window height)
@@ -85,11 +117,44 @@ protected:
 	void SetTextureRepeating(GLuint target, bool state);
 
 	void SetShaderLight(const Light &l);
+
+	mutable FrameAllocator frameAllocator;
+
+	/*
+	std140 copies of the FrameData and LightData uniform blocks the stock
+	shaders declare. UpdateShaderMatrices and SetShaderLight write them into
+	the uniform ring, but only when they've changed since they were last
+	written - so every shader drawn with the same camera and light shares
+	one copy, rather than each being sent its own loose uniforms.
+	*/
+	struct FrameBlock {
+		Matrix4	viewMatrix;
+		Matrix4	projMatrix;
+		Vector3	cameraPos;
+		float	padding;
+	};
+	struct LightBlock {
+		Vector4	lightColour;
+		Vector3	lightPos;
+		float	lightRadius;
+	};
+	UniformRing	uniformRing;
 private:
 	Shader* currentShader;	
+	FrameBlock	frameBlock;			//What the blocks were last written as
+	LightBlock	lightBlock;
+	bool		frameBlockWritten;	//...this frame
+	bool		lightBlockWritten;
+	//Everything after the context itself has been made
+	void		InitialiseGL();
+#ifdef _WIN32
 	HDC		deviceContext;	//...Device context?
 	HGLRC	renderContext;	//Permanent Rendering Context
-#ifdef _DEBUG
-	static void CALLBACK DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+#endif
+#ifdef NCLGL_HEADLESS
+	HeadlessContext* headless;	//NULL when drawing to a window
+#endif
+#ifdef OPENGL_DEBUGGING
+	static void APIENTRY DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
 #endif
 };
\ No newline at end of file
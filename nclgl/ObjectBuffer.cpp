@@ -0,0 +1,63 @@
+#include "ObjectBuffer.h"
+#include "SceneNode.h"
+#include <algorithm>
+
+ObjectBuffer::ObjectBuffer(void) {
+	objectBuffer	= 0;
+	objectCapacity	= 0;
+	drawIDBuffer	= 0;
+	drawIDCount		= 0;
+}
+
+ObjectBuffer::~ObjectBuffer(void) {
+	if (objectBuffer) {
+		glDeleteBuffers(1, &objectBuffer);
+		glDeleteBuffers(1, &drawIDBuffer);
+	}
+}
+
+void ObjectBuffer::Build(const std::vector<RenderQueueItem>& items) {
+	objects.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i) {
+		ObjectData& o	= objects[i];
+		o.modelMatrix	= items[i].node->GetWorldTransform();
+		o.colour		= items[i].node->GetColour();
+	}
+}
+
+void ObjectBuffer::Upload() {
+	GLStateCache::BindVertexArray(0);
+	if (!objectBuffer) {
+		glGenBuffers(1, &objectBuffer);
+		glGenBuffers(1, &drawIDBuffer);
+		glObjectLabel(GL_BUFFER, objectBuffer, -1, "Object Data");
+	}
+	if (objects.empty()) {
+		return;
+	}
+	//Orphaned each time, so the driver never has to wait for last frame
+	objectCapacity = std::max(objects.size(), objectCapacity);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objectCapacity * sizeof(ObjectData),
+		NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+		objects.size() * sizeof(ObjectData), objects.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	//Grown in place, so VAOs already pointing at it don't need updating
+	if (objects.size() > drawIDCount) {
+		drawIDCount = std::max(objects.size(), drawIDCount * 2);
+		std::vector<GLuint> ids(drawIDCount);
+		for (size_t i = 0; i < drawIDCount; ++i) {
+			ids[i] = (GLuint)i;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+		glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(),
+			GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+void ObjectBuffer::Bind() const {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectBuffer);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "OGLRenderer.h"
+#include "RenderQueue.h"
+#include <vector>
+
+//One object's entry, laid out as std430 lays out ObjectData in the shaders
+struct ObjectData {
+	Matrix4	modelMatrix;
+	Vector4	colour;
+};
+
+/*
+Everything the shaders need to know about each object being drawn this
+frame, in one storage buffer - so drawing an object doesn't need any
+uniforms setting, and any number of objects can share a draw call.
+
+There's an entry per item in the sorted render queue, at the same index,
+so a draw's objects are always next to each other. Shaders find theirs
+through a per-instance drawID attribute, which just counts up from 0 -
+with the draw's base instance added on, that's the object's index. Meshes
+and the geometry arena are pointed at the drawID buffer kept here.
+
+The buffer is orphaned and refilled every frame.
+*/
+class ObjectBuffer {
+public:
+	//The storage buffer binding the objects are read from
+	static const GLuint OBJECT_BINDING = 0;
+
+	ObjectBuffer(void);
+	~ObjectBuffer(void);
+
+	//Copies out each item's data. Doesn't touch GL
+	void	Build(const std::vector<RenderQueueItem>& items);
+	void	Clear() { objects.clear(); }
+
+	//Sends the objects to the GPU, and makes sure there are enough drawIDs
+	void	Upload();
+	void	Bind() const;
+
+	GLuint	GetDrawIDBuffer()	const { return drawIDBuffer; }
+	size_t	GetObjectCount()	const { return objects.size(); }
+	const std::vector<ObjectData>& GetObjects() const { return objects; }
+
+protected:
+	std::vector<ObjectData>	objects;
+
+	GLuint	objectBuffer;
+	size_t	objectCapacity;
+	GLuint	drawIDBuffer;
+	size_t	drawIDCount;
+};
@@ -0,0 +1,293 @@
+#include "OcclusionBuffer.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "Vector4.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE
+#include <immintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) {
+	tilesX	= (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	tilesY	= (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	this->width		= tilesX * TILE_WIDTH;
+	this->height	= tilesY * TILE_HEIGHT;
+
+	depth.assign(this->width * this->height, 1.0f);
+	tileMaxDepth.assign(tilesX * tilesY, 1.0f);
+	tileBins.resize(tilesX * tilesY);
+}
+
+void OcclusionBuffer::Begin(const Matrix4& viewProj) {
+	this->viewProj = viewProj;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.0f);
+	triangles.clear();
+}
+
+void OcclusionBuffer::AddOccluder(const Vector3* vertices,
+	const unsigned int* indices, size_t indexCount, const Matrix4& model) {
+	Matrix4 mvp = viewProj * model;
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		const Vector3& a = vertices[indices[i]];
+		const Vector3& b = vertices[indices[i + 1]];
+		const Vector3& c = vertices[indices[i + 2]];
+		AddClipTriangle(mvp * Vector4(a.x, a.y, a.z, 1.0f),
+			mvp * Vector4(b.x, b.y, b.z, 1.0f),
+			mvp * Vector4(c.x, c.y, c.z, 1.0f));
+	}
+}
+
+static float NearDistance(const Vector4& v) {
+	return v.z + v.w; //positive in front of the near plane
+}
+
+/*
+Anything crossing the near plane gets clipped against it first, as the
+divide by w falls apart behind the camera. Clipping one corner off a
+triangle leaves a quad, so that's split back into two.
+*/
+void OcclusionBuffer::AddClipTriangle(const Vector4& a, const Vector4& b,
+	const Vector4& c) {
+	const Vector4 in[3] = { a, b, c };
+	float d[3] = { NearDistance(a), NearDistance(b), NearDistance(c) };
+
+	if (d[0] >= 0.0f && d[1] >= 0.0f && d[2] >= 0.0f) {
+		AddScreenTriangle(a, b, c);
+		return;
+	}
+	Vector4	out[4];
+	int		count = 0;
+	for (int i = 0; i < 3; ++i) {
+		int j = (i + 1) % 3;
+		if (d[i] >= 0.0f) {
+			out[count++] = in[i];
+		}
+		if ((d[i] >= 0.0f) != (d[j] >= 0.0f)) {
+			float t = d[i] / (d[i] - d[j]);
+			out[count++] = Vector4(
+				in[i].x + (in[j].x - in[i].x) * t,
+				in[i].y + (in[j].y - in[i].y) * t,
+				in[i].z + (in[j].z - in[i].z) * t,
+				in[i].w + (in[j].w - in[i].w) * t);
+		}
+	}
+	for (int i = 2; i < count; ++i) {
+		AddScreenTriangle(out[0], out[i - 1], out[i]);
+	}
+}
+
+void OcclusionBuffer::AddScreenTriangle(const Vector4& a, const Vector4& b,
+	const Vector4& c) {
+	const Vector4* v[3] = { &a, &b, &c };
+	Triangle t;
+	for (int i = 0; i < 3; ++i) {
+		float invW = 1.0f / v[i]->w;
+		t.x[i] = ((v[i]->x * invW) * 0.5f + 0.5f) * width;
+		t.y[i] = ((v[i]->y * invW) * 0.5f + 0.5f) * height;
+		t.z[i] = ((v[i]->z * invW) * 0.5f + 0.5f);
+	}
+	float minX = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+	float maxX = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+	float minY = std::min(t.y[0], std::min(t.y[1], t.y[2]));
+	float maxY = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) {
+		return;
+	}
+	t.minX = std::max(0, (int)floor(minX));
+	t.minY = std::max(0, (int)floor(minY));
+	t.maxX = std::min(width - 1, (int)floor(maxX));
+	t.maxY = std::min(height - 1, (int)floor(maxY));
+	triangles.push_back(t);
+}
+
+void OcclusionBuffer::Rasterise(ThreadPool* pool) {
+	for (std::vector<int>& bin : tileBins) {
+		bin.clear();
+	}
+	for (int i = 0; i < (int)triangles.size(); ++i) {
+		const Triangle& t = triangles[i];
+		for (int ty = t.minY / TILE_HEIGHT; ty <= t.maxY / TILE_HEIGHT; ++ty) {
+			for (int tx = t.minX / TILE_WIDTH; tx <= t.maxX / TILE_WIDTH; ++tx) {
+				tileBins[(ty * tilesX) + tx].push_back(i);
+			}
+		}
+	}
+	const int tileCount = tilesX * tilesY;
+	for (int tile = 0; tile < tileCount; ++tile) {
+		if (tileBins[tile].empty()) {
+			continue;
+		}
+		if (pool) {
+			pool->Submit([this, tile] { RasteriseTile(tile); });
+		}
+		else {
+			RasteriseTile(tile);
+		}
+	}
+	if (pool) {
+		pool->Wait();
+	}
+}
+
+void OcclusionBuffer::RasteriseTile(int tile) {
+	PROFILE_SCOPE("Rasterise tile");
+	const int x0 = (tile % tilesX) * TILE_WIDTH;
+	const int y0 = (tile / tilesX) * TILE_HEIGHT;
+	const int x1 = x0 + TILE_WIDTH - 1;
+	const int y1 = y0 + TILE_HEIGHT - 1;
+
+	for (int i : tileBins[tile]) {
+		RasteriseTriangle(triangles[i], x0, y0, x1, y1);
+	}
+	float furthest = 0.0f;
+	for (int y = y0; y <= y1; ++y) {
+		const float* row = &depth[(y * width) + x0];
+		for (int x = 0; x < TILE_WIDTH; ++x) {
+			furthest = std::max(furthest, row[x]);
+		}
+	}
+	tileMaxDepth[tile] = furthest;
+}
+
+/*
+Edge functions and depth are both planes in screen space, so they're set
+up once per triangle and then evaluated at each pixel centre - four pixels
+at a time with SSE. A pixel is covered if it's on the inside of all three
+edges, and keeps the nearest depth written to it.
+*/
+void OcclusionBuffer::RasteriseTriangle(const Triangle& t, int x0, int y0,
+	int x1, int y1) {
+	float x[3] = { t.x[0], t.x[1], t.x[2] };
+	float y[3] = { t.y[0], t.y[1], t.y[2] };
+	float z[3] = { t.z[0], t.z[1], t.z[2] };
+
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0.0f) {
+		return;
+	}
+	if (area < 0.0f) { //make the winding consistent, so inside is positive
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+	//edge i runs from vertex i to vertex i + 1, and weights the vertex opposite
+	float A[3], B[3], C[3];
+	for (int i = 0; i < 3; ++i) {
+		int j = (i + 1) % 3;
+		A[i] = y[i] - y[j];
+		B[i] = x[j] - x[i];
+		C[i] = -(A[i] * x[i] + B[i] * y[i]);
+	}
+	const float invArea = 1.0f / area;
+	//vertex 0 is weighted by edge 1, vertex 1 by edge 2, vertex 2 by edge 0
+	const float zA = (A[1] * z[0] + A[2] * z[1] + A[0] * z[2]) * invArea;
+	const float zB = (B[1] * z[0] + B[2] * z[1] + B[0] * z[2]) * invArea;
+	const float zC = (C[1] * z[0] + C[2] * z[1] + C[0] * z[2]) * invArea;
+
+	const int startX	= std::max(x0, t.minX) & ~3;
+	const int endX		= std::min(x1, t.maxX);
+	const int startY	= std::max(y0, t.minY);
+	const int endY		= std::min(y1, t.maxY);
+
+	for (int py = startY; py <= endY; ++py) {
+		const float cy = py + 0.5f;
+		float* row = &depth[py * width];
+		int px = startX;
+#if defined(OCCLUSION_SSE)
+		const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		for (; px <= endX; px += 4) {
+			__m128 cx = _mm_add_ps(_mm_set1_ps((float)px), laneOffsets);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int e = 0; e < 3; ++e) {
+				__m128 edge = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(A[e])),
+					_mm_set1_ps(B[e] * cy + C[e]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+			}
+			if (_mm_movemask_ps(inside) == 0) {
+				continue;
+			}
+			__m128 pz = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(zA)),
+				_mm_set1_ps(zB * cy + zC));
+			__m128 old = _mm_loadu_ps(row + px);
+			__m128 nearest = _mm_min_ps(old, pz);
+			_mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, nearest),
+				_mm_andnot_ps(inside, old)));
+		}
+#endif
+		for (; px <= endX; ++px) {
+			const float cx = px + 0.5f;
+			if (A[0] * cx + B[0] * cy + C[0] < 0.0f ||
+				A[1] * cx + B[1] * cy + C[1] < 0.0f ||
+				A[2] * cx + B[2] * cy + C[2] < 0.0f) {
+				continue;
+			}
+			row[px] = std::min(row[px], zA * cx + zB * cy + zC);
+		}
+	}
+}
+
+/*
+Projects the corners of the box to get its screen rectangle and nearest
+depth. It's hidden if every pixel under that rectangle already has
+something nearer in it - checked a tile at a time, as a tile whose
+furthest depth is nearer than the box hides its part of the rectangle
+without looking at its pixels.
+*/
+bool OcclusionBuffer::IsVisible(const AABB& box) const {
+	float minX = (float)width, minY = (float)height, minZ = 1.0f;
+	float maxX = 0.0f, maxY = 0.0f;
+	for (int i = 0; i < 8; ++i) {
+		Vector4 corner(
+			(i & 1) ? box.max.x : box.min.x,
+			(i & 2) ? box.max.y : box.min.y,
+			(i & 4) ? box.max.z : box.min.z, 1.0f);
+		Vector4 clip = viewProj * corner;
+		if (NearDistance(clip) <= 0.0f) {
+			return true; //too close to tell
+		}
+		float invW	= 1.0f / clip.w;
+		float sx	= ((clip.x * invW) * 0.5f + 0.5f) * width;
+		float sy	= ((clip.y * invW) * 0.5f + 0.5f) * height;
+		float sz	= ((clip.z * invW) * 0.5f + 0.5f);
+		minX = std::min(minX, sx);
+		maxX = std::max(maxX, sx);
+		minY = std::min(minY, sy);
+		maxY = std::max(maxY, sy);
+		minZ = std::min(minZ, sz);
+	}
+	if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) {
+		return true; //off screen - that's for the frustum to decide
+	}
+	const int x0 = std::max(0, (int)floor(minX));
+	const int y0 = std::max(0, (int)floor(minY));
+	const int x1 = std::min(width - 1, (int)floor(maxX));
+	const int y1 = std::min(height - 1, (int)floor(maxY));
+
+	for (int ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ++ty) {
+		for (int tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; ++tx) {
+			if (tileMaxDepth[(ty * tilesX) + tx] < minZ) {
+				continue;
+			}
+			const int px0 = std::max(x0, tx * TILE_WIDTH);
+			const int px1 = std::min(x1, (tx * TILE_WIDTH) + TILE_WIDTH - 1);
+			const int py0 = std::max(y0, ty * TILE_HEIGHT);
+			const int py1 = std::min(y1, (ty * TILE_HEIGHT) + TILE_HEIGHT - 1);
+			for (int py = py0; py <= py1; ++py) {
+				const float* row = &depth[py * width];
+				for (int px = px0; px <= px1; ++px) {
+					if (row[px] >= minZ) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
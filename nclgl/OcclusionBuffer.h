@@ -0,0 +1,70 @@
+#pragma once
+#include "Matrix4.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include "AABB.h"
+#include <vector>
+
+class ThreadPool;
+
+/*
+Small software depth buffer for occlusion culling. A handful of simple
+occluder meshes get rasterised into it on the CPU each frame, and then
+the screen space bounds of anything that might be drawn can be tested
+against it, without going anywhere near the GPU.
+
+The buffer is split into tiles. Triangles are binned into the tiles they
+touch, and each tile is then rasterised on its own - as tasks on a thread
+pool, if one is given - so no two threads ever write the same pixel. Each
+tile also keeps the furthest depth written anywhere in it, which lets most
+tests finish without looking at any pixels.
+
+Depths are post-projection z, mapped to [0, 1] - smaller is nearer.
+*/
+class OcclusionBuffer {
+public:
+	static const int TILE_WIDTH		= 32;
+	static const int TILE_HEIGHT	= 16;
+
+	//Width is rounded up to a whole number of tiles
+	OcclusionBuffer(int width = 256, int height = 128);
+	~OcclusionBuffer(void) {};
+
+	//Empties the buffer, and sets the camera everything is projected with
+	void	Begin(const Matrix4& viewProj);
+	void	AddOccluder(const Vector3* vertices, const unsigned int* indices,
+				size_t indexCount, const Matrix4& model);
+	//Fills the buffer with every occluder added since Begin
+	void	Rasterise(ThreadPool* pool = nullptr);
+
+	bool	IsVisible(const AABB& box) const;
+
+	int		GetWidth()	const { return width; }
+	int		GetHeight()	const { return height; }
+	float	GetDepth(int x, int y) const { return depth[(y * width) + x]; }
+
+protected:
+	struct Triangle {
+		float	x[3];
+		float	y[3];
+		float	z[3];
+		int		minX, minY, maxX, maxY;	//pixel bounds, inclusive
+	};
+
+	void	AddClipTriangle(const Vector4& a, const Vector4& b, const Vector4& c);
+	void	AddScreenTriangle(const Vector4& a, const Vector4& b, const Vector4& c);
+	void	RasteriseTile(int tile);
+	void	RasteriseTriangle(const Triangle& t, int x0, int y0, int x1, int y1);
+
+	int		width;
+	int		height;
+	int		tilesX;
+	int		tilesY;
+
+	Matrix4	viewProj;
+
+	std::vector<float>				depth;
+	std::vector<float>				tileMaxDepth;
+	std::vector<Triangle>			triangles;
+	std::vector<std::vector<int>>	tileBins;
+};
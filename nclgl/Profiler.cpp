@@ -0,0 +1,344 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_set>
+
+std::atomic<bool>	Profiler::enabled(false);
+
+std::mutex						Profiler::logLock;
+std::vector<Profiler::ThreadLog*>	Profiler::threadLogs;
+Profiler::Frame					Profiler::frames[FRAME_HISTORY];
+size_t							Profiler::frameCount	= 0;
+double							Profiler::frameStart	= 0.0;
+
+std::vector<Profiler::PendingQuery>	Profiler::pendingQueries[FRAME_HISTORY];
+std::vector<size_t>					Profiler::openQueries;
+std::vector<GLuint>					Profiler::freeQueries;
+GLint64								Profiler::gpuOffset		= 0;
+
+//Switching on and off waits for the end of the frame, so only whole
+//frames are ever recorded
+static std::atomic<bool> enableRequested(false);
+
+double Profiler::Now() {
+	static const std::chrono::steady_clock::time_point epoch =
+		std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - epoch).count();
+}
+
+Profiler::ThreadLog& Profiler::GetThreadLog() {
+	//Never freed - the trace may still want a thread's name after it's gone
+	static thread_local ThreadLog* log = nullptr;
+	if (!log) {
+		log = new ThreadLog();
+		std::lock_guard<std::mutex> guard(logLock);
+		log->name = "Thread " + std::to_string(threadLogs.size());
+		threadLogs.push_back(log);
+	}
+	return *log;
+}
+
+void Profiler::SetEnabled(bool on) {
+	enableRequested = on;
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+	ThreadLog& log = GetThreadLog();
+	std::lock_guard<std::mutex> guard(log.lock);
+	log.name = name;
+}
+
+const char* Profiler::Intern(const std::string& s) {
+	static std::mutex internLock;
+	static std::unordered_set<std::string> interned;
+	std::lock_guard<std::mutex> guard(internLock);
+	return interned.insert(s).first->c_str();
+}
+
+void Profiler::BeginCPU(const char* name) {
+	ThreadLog& log = GetThreadLog();
+	std::lock_guard<std::mutex> guard(log.lock);
+	log.open.push_back(log.events.size());
+	log.events.push_back(Event{ name, Now(), -1.0, (int)log.open.size() - 1 });
+}
+
+void Profiler::EndCPU() {
+	const double now = Now();
+	ThreadLog& log = GetThreadLog();
+	std::lock_guard<std::mutex> guard(log.lock);
+	if (log.open.empty()) {
+		return;
+	}
+	Event& e = log.events[log.open.back()];
+	e.duration = now - e.start;
+	log.open.pop_back();
+}
+
+GLuint Profiler::GetQuery() {
+	if (freeQueries.empty()) {
+		GLuint queries[16];
+		glGenQueries(16, queries);
+		freeQueries.insert(freeQueries.end(), queries, queries + 16);
+	}
+	GLuint q = freeQueries.back();
+	freeQueries.pop_back();
+	return q;
+}
+
+void Profiler::BeginGPU(const char* name) {
+	std::vector<PendingQuery>& pending = pendingQueries[frameCount % FRAME_HISTORY];
+	PendingQuery p = { name, GetQuery(), 0, (int)openQueries.size() };
+	glQueryCounter(p.begin, GL_TIMESTAMP);
+	openQueries.push_back(pending.size());
+	pending.push_back(p);
+}
+
+void Profiler::EndGPU() {
+	if (openQueries.empty()) {
+		return;
+	}
+	PendingQuery& p = pendingQueries[frameCount % FRAME_HISTORY][openQueries.back()];
+	p.end = GetQuery();
+	glQueryCounter(p.end, GL_TIMESTAMP);
+	openQueries.pop_back();
+}
+
+void Profiler::ResolveQueries(bool wait) {
+	//The current frame's queries might still be open, and openQueries
+	//indexes into them - NextFrame closes them all before moving on
+	const size_t current = frameCount % FRAME_HISTORY;
+	for (size_t i = 0; i < FRAME_HISTORY; ++i) {
+		if (i != current) {
+			ResolveFrame(i, wait);
+		}
+	}
+}
+
+void Profiler::ResolveFrame(size_t slot, bool wait) {
+	std::vector<PendingQuery>& pending = pendingQueries[slot];
+	if (pending.empty()) {
+		return;
+	}
+	//Queries finish in the order they were issued, and the last one to be
+	//issued is the end of the last top level scope - everything after it
+	//is nested inside - so if that's done, they all are
+	GLuint last = 0;
+	for (const PendingQuery& p : pending) {
+		if (p.depth == 0) {
+			last = p.end;
+		}
+	}
+	GLint available = 0;
+	glGetQueryObjectiv(last, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available && !wait) {
+		return;
+	}
+	Frame& f = frames[slot];
+	for (const PendingQuery& p : pending) {
+		GLuint64 begin	= 0;
+		GLuint64 end	= 0;
+		glGetQueryObjectui64v(p.begin, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(p.end, GL_QUERY_RESULT, &end);
+		f.gpuEvents.push_back(Event{ p.name,
+			(double)((GLint64)begin - gpuOffset) / 1000.0,
+			(double)(end - begin) / 1000.0, p.depth });
+		freeQueries.push_back(p.begin);
+		freeQueries.push_back(p.end);
+	}
+	pending.clear();
+	f.gpuResolved = true;
+}
+
+void Profiler::NextFrame() {
+	const double now = Now();
+	const bool wasEnabled = enabled;
+
+	if (wasEnabled) {
+		while (!openQueries.empty()) {
+			EndGPU();
+		}
+		Frame& f		= frames[frameCount % FRAME_HISTORY];
+		f.index			= frameCount;
+		f.start			= frameStart;
+		f.duration		= now - frameStart;
+		f.gpuResolved	= pendingQueries[frameCount % FRAME_HISTORY].empty();
+		f.gpuEvents.clear();
+
+		std::lock_guard<std::mutex> guard(logLock);
+		f.cpuEvents.resize(threadLogs.size());
+		for (size_t t = 0; t < threadLogs.size(); ++t) {
+			ThreadLog& log = *threadLogs[t];
+			std::lock_guard<std::mutex> threadGuard(log.lock);
+			f.cpuEvents[t].clear();
+			//A thread still inside a scope keeps its events for next frame
+			if (log.open.empty()) {
+				f.cpuEvents[t].swap(log.events);
+			}
+		}
+		++frameCount;
+	}
+
+	const bool on = enableRequested;
+	if (on && !wasEnabled) {
+		//Lines the GPU's clock up with ours, near enough
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		gpuOffset = gpuNow - (GLint64)(Now() * 1000.0);
+	}
+	enabled = on;
+
+	ResolveQueries(!on);
+	//The new frame's queries go where the oldest frame's were, so if the
+	//GPU is a whole history behind, there's nothing for it but to wait
+	ResolveFrame(frameCount % FRAME_HISTORY, true);
+	frameStart = Now();
+}
+
+std::vector<const Profiler::Frame*> Profiler::GetFrames() {
+	std::vector<const Frame*> out;
+	const size_t first = frameCount > FRAME_HISTORY ? frameCount - FRAME_HISTORY : 0;
+	for (size_t i = first; i < frameCount; ++i) {
+		out.push_back(&frames[i % FRAME_HISTORY]);
+	}
+	return out;
+}
+
+void Profiler::PrintSummary() {
+	struct Total {
+		double	cpu;
+		double	gpu;
+	};
+	std::map<std::string, Total> totals;
+	ResolveQueries(true);
+	const std::vector<const Frame*> recorded = GetFrames();
+	size_t gpuFrames	= 0;
+	double frameTime	= 0.0;
+	for (const Frame* f : recorded) {
+		frameTime += f->duration;
+		for (const std::vector<Event>& thread : f->cpuEvents) {
+			for (const Event& e : thread) {
+				if (e.depth == 0 && e.duration >= 0.0) {
+					totals[e.name].cpu += e.duration;
+				}
+			}
+		}
+		if (f->gpuResolved) {
+			++gpuFrames;
+			for (const Event& e : f->gpuEvents) {
+				if (e.depth == 0) {
+					totals[e.name].gpu += e.duration;
+				}
+			}
+		}
+	}
+	if (recorded.empty()) {
+		std::cout << "Profiler: nothing recorded\n";
+		return;
+	}
+	const double count = (double)recorded.size();
+	std::cout << "Profiler: " << recorded.size() << " frames, "
+		<< frameTime / count / 1000.0 << "ms each\n";
+	for (const auto& t : totals) {
+		std::cout << "\t" << t.first << ": " << t.second.cpu / count / 1000.0
+			<< "ms CPU, " << (gpuFrames ? t.second.gpu / gpuFrames / 1000.0 : 0.0)
+			<< "ms GPU\n";
+	}
+}
+
+static std::string EscapeJSON(const char* s) {
+	std::string out;
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			out += '\\';
+		}
+		out += (unsigned char)*s < 0x20 ? ' ' : *s;
+	}
+	return out;
+}
+
+static void WriteTraceEvent(std::ofstream& f, bool& first, const char* name,
+	int tid, double start, double duration) {
+	f << (first ? "\n" : ",\n") << "{\"name\":\"" << EscapeJSON(name)
+		<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+		<< ",\"ts\":" << start << ",\"dur\":" << duration << "}";
+	first = false;
+}
+
+static void WriteThreadName(std::ofstream& f, bool& first, int tid,
+	const std::string& name) {
+	f << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+		<< tid << ",\"args\":{\"name\":\"" << EscapeJSON(name.c_str()) << "\"}}";
+	f << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+		<< tid << ",\"args\":{\"sort_index\":" << tid << "}}";
+	first = false;
+}
+
+/*
+Writes the trace event format's JSON array form - frames on one track,
+the GPU's passes on another, then a track per thread.
+*/
+bool Profiler::ExportChromeTrace(const std::string& filename) {
+	std::ofstream f(filename);
+	if (!f) {
+		std::cout << "Profiler::ExportChromeTrace(): Couldn't write " << filename << "\n";
+		return false;
+	}
+	const int FRAME_TRACK	= 0;
+	const int GPU_TRACK		= 1;
+	const int FIRST_THREAD	= 2;
+	ResolveQueries(true);
+
+	f.precision(3);
+	f << std::fixed << "{\"traceEvents\":[";
+	bool first = true;
+	WriteThreadName(f, first, FRAME_TRACK, "Frames");
+	WriteThreadName(f, first, GPU_TRACK, "GPU");
+	{
+		std::lock_guard<std::mutex> guard(logLock);
+		for (size_t t = 0; t < threadLogs.size(); ++t) {
+			std::lock_guard<std::mutex> threadGuard(threadLogs[t]->lock);
+			WriteThreadName(f, first, FIRST_THREAD + (int)t, threadLogs[t]->name);
+		}
+	}
+	for (const Frame* frame : GetFrames()) {
+		const std::string name = "Frame " + std::to_string(frame->index);
+		WriteTraceEvent(f, first, name.c_str(), FRAME_TRACK, frame->start,
+			frame->duration);
+		for (const Event& e : frame->gpuEvents) {
+			WriteTraceEvent(f, first, e.name, GPU_TRACK, e.start, e.duration);
+		}
+		for (size_t t = 0; t < frame->cpuEvents.size(); ++t) {
+			for (const Event& e : frame->cpuEvents[t]) {
+				if (e.duration >= 0.0) {
+					WriteTraceEvent(f, first, e.name, FIRST_THREAD + (int)t,
+						e.start, e.duration);
+				}
+			}
+		}
+	}
+	f << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return (bool)f;
+}
+
+void Profiler::Release() {
+	ResolveQueries(true);
+	//The frame in progress never gets finished, so its queries are just
+	//handed back
+	std::vector<PendingQuery>& current = pendingQueries[frameCount % FRAME_HISTORY];
+	for (const PendingQuery& p : current) {
+		freeQueries.push_back(p.begin);
+		if (p.end) {
+			freeQueries.push_back(p.end);
+		}
+	}
+	current.clear();
+	openQueries.clear();
+	if (!freeQueries.empty()) {
+		glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+		freeQueries.clear();
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include "glad/glad.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+Records where each frame's time goes, as nested scopes - on the CPU, per
+thread, and on the GPU through timestamp queries - and keeps the last
+FRAME_HISTORY frames, which can be written out as a Chrome trace (open it
+in chrome://tracing or ui.perfetto.dev) or summed up per scope.
+
+Scopes are opened and closed with ProfileScope, or the PROFILE_SCOPE
+macro. CPU scopes can be opened on any thread; GPU scopes only on the one
+with the context, and OGLRenderer's StartDebugGroup/EndDebugGroup open
+one of each, so every debug group is a profiled pass too.
+
+Scope names aren't copied, so must outlive the frames they're recorded in
+- string literals, usually. Intern copies anything that won't.
+
+It's off until SetEnabled is called, and then all a scope costs is
+checking a flag. Defining NCLGL_NO_PROFILING compiles the scopes out.
+*/
+class Profiler {
+public:
+	static const size_t FRAME_HISTORY = 120;
+
+	struct Event {
+		const char*	name;
+		double		start;		//microseconds since the profiler was made
+		double		duration;
+		int			depth;
+	};
+	struct Frame {
+		size_t	index;
+		double	start;
+		double	duration;
+		std::vector<std::vector<Event>>	cpuEvents;	//per thread
+		std::vector<Event>				gpuEvents;
+		bool	gpuResolved;
+	};
+
+	static void	SetEnabled(bool on);
+	static bool	IsEnabled() { return enabled; }
+
+	//Ends the current frame and starts the next. OGLRenderer::SwapBuffers
+	//calls this, so nothing else needs to
+	static void	NextFrame();
+
+	static void	BeginCPU(const char* name);
+	static void	EndCPU();
+	//Only from the thread the GL context is current on
+	static void	BeginGPU(const char* name);
+	static void	EndGPU();
+
+	//Names threads in the trace - the main thread and pool workers name
+	//themselves, anything else is "Thread n"
+	static void	SetThreadName(const std::string& name);
+	//A copy of s that lives as long as the program
+	static const char*	Intern(const std::string& s);
+
+	//The recorded frames, oldest first. GPU times turn up a few frames late
+	static std::vector<const Frame*> GetFrames();
+	//These two wait for any GPU times still to come in from finished
+	//frames, so need the GL thread, but can be called mid-frame. The
+	//summary is mean milliseconds per frame of each top level scope
+	static void	PrintSummary();
+	static bool	ExportChromeTrace(const std::string& filename);
+
+	//Frees the queries - call before the context goes
+	static void	Release();
+
+protected:
+	struct ThreadLog {
+		std::mutex			lock;
+		std::vector<Event>	events;
+		std::vector<size_t>	open;
+		std::string			name;
+	};
+	struct PendingQuery {
+		const char*	name;
+		GLuint		begin;
+		GLuint		end;
+		int			depth;
+	};
+
+	static double		Now();
+	static ThreadLog&	GetThreadLog();
+	//Reads back the GPU scopes of any finished frame whose queries have
+	//finished - or of every finished frame, waiting if need be, if 'wait'
+	//is set. The frame being recorded is left alone
+	static void			ResolveQueries(bool wait);
+	static void			ResolveFrame(size_t slot, bool wait);
+	static GLuint		GetQuery();
+
+	static std::atomic<bool>	enabled;
+
+	static std::mutex				logLock;	//guards threadLogs and frames
+	static std::vector<ThreadLog*>	threadLogs;
+	static Frame					frames[FRAME_HISTORY];
+	static size_t					frameCount;
+	static double					frameStart;
+
+	static std::vector<PendingQuery>	pendingQueries[FRAME_HISTORY];
+	static std::vector<size_t>			openQueries;
+	static std::vector<GLuint>			freeQueries;
+	static GLint64						gpuOffset;	//GPU timestamp of CPU time 0, in ns
+};
+
+/*
+Times everything until the end of the enclosing block. With 'gpu' set it
+times what the GPU does in between too - which needs the GL thread.
+*/
+class ProfileScope {
+public:
+	ProfileScope(const char* name, bool gpu = false) : gpu(gpu) {
+		active = Profiler::IsEnabled();
+		if (active) {
+			Profiler::BeginCPU(name);
+			if (gpu) {
+				Profiler::BeginGPU(name);
+			}
+		}
+	}
+	~ProfileScope(void) {
+		if (active) {
+			if (gpu) {
+				Profiler::EndGPU();
+			}
+			Profiler::EndCPU();
+		}
+	}
+	ProfileScope(const ProfileScope&)				= delete;
+	ProfileScope& operator=(const ProfileScope&)	= delete;
+
+protected:
+	bool	active;
+	bool	gpu;
+};
+
+#ifdef NCLGL_NO_PROFILING
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#else
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+#endif
@@ -0,0 +1,107 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+static const int LAYER_SHIFT = 62;
+
+static uint64_t Mask(unsigned int value, int bits) {
+	return (uint64_t)value & ((1ull << bits) - 1);
+}
+
+uint64_t RenderQueue::MakeKey(Layer layer, unsigned int shader,
+	unsigned int material, unsigned int mesh, float depth) {
+	depth = std::min(std::max(depth, 0.0f), 1.0f);
+	const uint64_t maxDepth	= (1ull << DEPTH_BITS) - 1;
+	uint64_t quantised		= (uint64_t)(depth * (float)maxDepth);
+
+	uint64_t state = (Mask(shader, SHADER_BITS) << (MATERIAL_BITS + MESH_BITS)) |
+		(Mask(material, MATERIAL_BITS) << MESH_BITS) |
+		Mask(mesh, MESH_BITS);
+
+	uint64_t key = (uint64_t)layer << LAYER_SHIFT;
+	if (layer == LAYER_TRANSPARENT) {
+		key |= (maxDepth - quantised) << (LAYER_SHIFT - DEPTH_BITS);
+		key |= state << 4;
+	}
+	else {
+		key |= state << (4 + DEPTH_BITS);
+		key |= quantised << 4;
+	}
+	return key;
+}
+
+//Where the state fields start depends on the layer
+static int StateShift(uint64_t key) {
+	return (key >> LAYER_SHIFT) == RenderQueue::LAYER_TRANSPARENT ?
+		4 : 4 + RenderQueue::DEPTH_BITS;
+}
+
+unsigned int RenderQueue::GetShader(uint64_t key) {
+	return (unsigned int)Mask((unsigned int)(key >> (StateShift(key) + MATERIAL_BITS + MESH_BITS)), SHADER_BITS);
+}
+
+unsigned int RenderQueue::GetMaterial(uint64_t key) {
+	return (unsigned int)Mask((unsigned int)(key >> (StateShift(key) + MESH_BITS)), MATERIAL_BITS);
+}
+
+unsigned int RenderQueue::GetMesh(uint64_t key) {
+	return (unsigned int)Mask((unsigned int)(key >> StateShift(key)), MESH_BITS);
+}
+
+/*
+One counting pass per byte, least significant first. Each pass is stable,
+so after the last one the items are in full key order - and items with
+identical keys stay in the order they were pushed in.
+*/
+void RenderQueue::Sort() {
+	const size_t count = items.size();
+	if (count < 2) {
+		return;
+	}
+	sortBuffer.resize(count);
+
+	RenderQueueItem* from	= items.data();
+	RenderQueueItem* to		= sortBuffer.data();
+
+	for (int byte = 0; byte < 8; ++byte) {
+		const int shift = byte * 8;
+		size_t offsets[256] = { 0 };
+		for (size_t i = 0; i < count; ++i) {
+			++offsets[(from[i].key >> shift) & 0xFF];
+		}
+		//every key has the same byte here, so this pass would change nothing
+		if (offsets[(from[0].key >> shift) & 0xFF] == count) {
+			continue;
+		}
+		size_t total = 0;
+		for (int b = 0; b < 256; ++b) {
+			size_t c	= offsets[b];
+			offsets[b]	= total;
+			total		+= c;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			to[offsets[(from[i].key >> shift) & 0xFF]++] = from[i];
+		}
+		std::swap(from, to);
+	}
+	if (from != items.data()) {
+		std::copy(from, from + count, items.data());
+	}
+}
+
+RenderQueue::StateChanges RenderQueue::CountStateChanges(
+	const RenderQueueItem* items, size_t count) {
+	StateChanges changes = { 0, 0, 0 };
+	for (size_t i = 0; i < count; ++i) {
+		uint64_t key = items[i].key;
+		if (i == 0 || GetShader(key) != GetShader(items[i - 1].key)) {
+			++changes.shader;
+		}
+		if (i == 0 || GetMaterial(key) != GetMaterial(items[i - 1].key)) {
+			++changes.material;
+		}
+		if (i == 0 || GetMesh(key) != GetMesh(items[i - 1].key)) {
+			++changes.mesh;
+		}
+	}
+	return changes;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SceneNode;
+
+struct RenderQueueItem {
+	uint64_t	key;
+	SceneNode*	node;
+};
+
+/*
+A list of things to draw, each with a 64 bit key that puts them in the
+order they should be drawn in. Opaque keys are laid out as
+
+	layer(2) | shader(10) | material(12) | mesh(12) | depth(24) | spare(4)
+
+so that draws sharing a shader, then a texture, then a mesh end up next to
+each other, and are front to back within that. Transparent draws have to
+go back to front no matter what state they need, so their depth is moved
+up to just under the layer, and inverted:
+
+	layer(2) | inverted depth(24) | shader(10) | material(12) | mesh(12) | spare(4)
+
+Sorting is an LSD radix sort over the key bytes, which skips any byte that
+is the same in every key.
+*/
+class RenderQueue {
+public:
+	enum Layer {
+		LAYER_OPAQUE		= 0,
+		LAYER_TRANSPARENT	= 1
+	};
+
+	static const int SHADER_BITS	= 10;
+	static const int MATERIAL_BITS	= 12;
+	static const int MESH_BITS		= 12;
+	static const int DEPTH_BITS		= 24;
+
+	RenderQueue(void) {};
+	~RenderQueue(void) {};
+
+	//IDs are masked down to fit their field. Depth is clamped to [0, 1]
+	static uint64_t MakeKey(Layer layer, unsigned int shader,
+		unsigned int material, unsigned int mesh, float depth);
+
+	static unsigned int GetShader(uint64_t key);
+	static unsigned int GetMaterial(uint64_t key);
+	static unsigned int GetMesh(uint64_t key);
+
+	void	Clear() { items.clear(); }
+	void	Push(uint64_t key, SceneNode* node) { items.push_back(RenderQueueItem{ key, node }); }
+	void	Sort();
+
+	const std::vector<RenderQueueItem>& GetItems() const { return items; }
+
+	//How many times drawing the items in the given order would need a new
+	//shader, material or mesh bound
+	struct StateChanges {
+		unsigned int shader;
+		unsigned int material;
+		unsigned int mesh;
+	};
+	static StateChanges CountStateChanges(const RenderQueueItem* items, size_t count);
+
+protected:
+	std::vector<RenderQueueItem>	items;
+	std::vector<RenderQueueItem>	sortBuffer;
+};
@@ -0,0 +1,246 @@
+#include "SceneFile.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+	const char		SCENE_MAGIC[4]	= { 'N', 'S', 'C', 'N' };
+	//Version 1 wrote the structs straight out, padding and all
+	const uint32_t	SCENE_VERSION	= 2;
+
+	//Everything is written a field at a time, as little endian 32 bit
+	//values, so the file doesn't depend on how the compiler lays out the
+	//structs, or on the machine's byte order
+	class SceneWriter {
+	public:
+		void	U32(uint32_t v) {
+			for (int i = 0; i < 4; ++i) {
+				bytes.push_back((char)((v >> (i * 8)) & 0xff));
+			}
+		}
+		void	I32(int32_t v)	{ U32((uint32_t)v); }
+		void	F32(float f) {
+			uint32_t v;
+			memcpy(&v, &f, sizeof(v));
+			U32(v);
+		}
+		void	Bytes(const char* data, size_t count) {
+			bytes.insert(bytes.end(), data, data + count);
+		}
+
+		std::vector<char> bytes;
+	};
+
+	//Reads stop at the end of the data, after which ok is false and
+	//everything reads as zero
+	class SceneReader {
+	public:
+		SceneReader(const std::vector<char>& bytes) : bytes(bytes) {}
+
+		uint32_t	U32() {
+			if (!Has(4)) {
+				return 0;
+			}
+			uint32_t v = 0;
+			for (int i = 0; i < 4; ++i) {
+				v |= (uint32_t)(unsigned char)bytes[offset++] << (i * 8);
+			}
+			return v;
+		}
+		int32_t		I32()	{ return (int32_t)U32(); }
+		float		F32() {
+			uint32_t v = U32();
+			float f;
+			memcpy(&f, &v, sizeof(f));
+			return f;
+		}
+		void		Bytes(char* out, size_t count) {
+			if (Has(count)) {
+				memcpy(out, &bytes[offset], count);
+				offset += count;
+			}
+		}
+		bool		Has(size_t count) {
+			ok = ok && bytes.size() - offset >= count;
+			return ok;
+		}
+
+		bool	ok		= true;
+
+	protected:
+		const std::vector<char>&	bytes;
+		size_t						offset = 0;
+	};
+}
+
+SceneFile::SceneFile(void) {
+}
+
+uint32_t SceneFile::AddString(const std::string& s) {
+	//Scenes only have a few distinct names, so a search is fine here
+	size_t offset = 0;
+	while (offset < strings.size()) {
+		if (strcmp(&strings[offset], s.c_str()) == 0) {
+			return (uint32_t)offset;
+		}
+		offset += strlen(&strings[offset]) + 1;
+	}
+	strings.insert(strings.end(), s.c_str(), s.c_str() + s.size() + 1);
+	return (uint32_t)offset;
+}
+
+int SceneFile::AddNode(int parent, const std::string& type, const Matrix4& transform) {
+	Node n;
+	n.parent	= parent;
+	n.type		= AddString(type);
+	for (int i = 0; i < RESOURCE_TYPE_COUNT; ++i) {
+		n.resources[i] = NO_RESOURCE;
+	}
+	memcpy(n.transform, transform.values, sizeof(n.transform));
+	for (int i = 0; i < 3; ++i) {
+		n.scale[i] = 1.0f;
+	}
+	for (int i = 0; i < 4; ++i) {
+		n.colour[i] = 1.0f;
+		n.params[i] = 0.0f;
+	}
+	n.boundingRadius = 0.0f;
+
+	nodes.push_back(n);
+	return (int)nodes.size() - 1;
+}
+
+void SceneFile::SetResource(int node, ResourceType type, const std::string& name) {
+	uint32_t nameOffset = AddString(name);
+	for (size_t i = 0; i < resources.size(); ++i) {
+		if (resources[i].type == (uint32_t)type && resources[i].name == nameOffset) {
+			nodes[node].resources[type] = (int32_t)i;
+			return;
+		}
+	}
+	resources.push_back({ (uint32_t)type, nameOffset });
+	nodes[node].resources[type] = (int32_t)resources.size() - 1;
+}
+
+Matrix4 SceneFile::GetTransform(const Node& n) {
+	Matrix4 m;
+	memcpy(m.values, n.transform, sizeof(n.transform));
+	return m;
+}
+
+bool SceneFile::Save(const std::string& filename) const {
+	SceneWriter w;
+	w.Bytes(SCENE_MAGIC, sizeof(SCENE_MAGIC));
+	w.U32(SCENE_VERSION);
+	w.U32((uint32_t)strings.size());
+	w.U32((uint32_t)resources.size());
+	w.U32((uint32_t)nodes.size());
+
+	w.Bytes(strings.data(), strings.size());
+	for (const Resource& r : resources) {
+		w.U32(r.type);
+		w.U32(r.name);
+	}
+	for (const Node& n : nodes) {
+		w.I32(n.parent);
+		w.U32(n.type);
+		for (int32_t r : n.resources)	{ w.I32(r); }
+		for (float f : n.transform)		{ w.F32(f); }
+		for (float f : n.scale)			{ w.F32(f); }
+		for (float f : n.colour)		{ w.F32(f); }
+		w.F32(n.boundingRadius);
+		for (float f : n.params)		{ w.F32(f); }
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file || !file.write(w.bytes.data(), w.bytes.size())) {
+		std::cout << "Can't write scene file " << filename << "!\n";
+		return false;
+	}
+	return true;
+}
+
+bool SceneFile::Load(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	std::vector<char> bytes((size_t)file.tellg());
+	file.seekg(0);
+	if (!file.read(bytes.data(), bytes.size())) {
+		std::cout << "Can't read scene file " << filename << "!\n";
+		return false;
+	}
+	SceneReader r(bytes);
+	char magic[4] = { 0 };
+	r.Bytes(magic, sizeof(magic));
+	if (!r.ok || memcmp(magic, SCENE_MAGIC, sizeof(magic)) != 0) {
+		std::cout << "File " << filename << " is not a scene file!\n";
+		return false;
+	}
+	const uint32_t version = r.U32();
+	if (version != SCENE_VERSION) {
+		std::cout << "File " << filename << " has incompatible version "
+			<< version << "!\n";
+		return false;
+	}
+	const uint32_t stringBytes		= r.U32();
+	const uint32_t resourceCount	= r.U32();
+	const uint32_t nodeCount		= r.U32();
+	//Checked against what's left before anything gets resized to match
+	const size_t RESOURCE_BYTES	= 2 * 4;
+	const size_t NODE_BYTES		= (2 + RESOURCE_TYPE_COUNT + 16 + 3 + 4 + 1 + 4) * 4;
+	if (!r.Has(stringBytes + (size_t)resourceCount * RESOURCE_BYTES +
+		(size_t)nodeCount * NODE_BYTES)) {
+		std::cout << "Scene file " << filename << " is truncated!\n";
+		return false;
+	}
+	strings.resize(stringBytes);
+	resources.resize(resourceCount);
+	nodes.resize(nodeCount);
+
+	r.Bytes(strings.data(), strings.size());
+	for (Resource& res : resources) {
+		res.type	= r.U32();
+		res.name	= r.U32();
+	}
+	for (Node& n : nodes) {
+		n.parent	= r.I32();
+		n.type		= r.U32();
+		for (int32_t& i : n.resources)	{ i = r.I32(); }
+		for (float& f : n.transform)	{ f = r.F32(); }
+		for (float& f : n.scale)		{ f = r.F32(); }
+		for (float& f : n.colour)		{ f = r.F32(); }
+		n.boundingRadius = r.F32();
+		for (float& f : n.params)		{ f = r.F32(); }
+	}
+	if (!r.ok || (!strings.empty() && strings.back() != '\0')) {
+		std::cout << "Scene file " << filename << " is truncated!\n";
+		strings.clear();
+		resources.clear();
+		nodes.clear();
+		return false;
+	}
+	//Make sure every reference points somewhere sensible before anything
+	//goes trying to follow them
+	for (const Resource& r : resources) {
+		if (r.type >= RESOURCE_TYPE_COUNT || r.name >= strings.size()) {
+			std::cout << "Scene file " << filename << " has a bad resource!\n";
+			nodes.clear();
+			return false;
+		}
+	}
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const Node& n = nodes[i];
+		bool valid = n.parent < (int32_t)i && n.parent >= -1 && n.type < strings.size();
+		for (int j = 0; j < RESOURCE_TYPE_COUNT; ++j) {
+			valid &= n.resources[j] >= NO_RESOURCE && n.resources[j] < (int32_t)resources.size();
+		}
+		if (!valid) {
+			std::cout << "Scene file " << filename << " has a bad node!\n";
+			nodes.clear();
+			return false;
+		}
+	}
+	return true;
+}
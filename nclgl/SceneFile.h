@@ -0,0 +1,82 @@
+#pragma once
+#include "Matrix4.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+Compact binary description of a scene graph - the node hierarchy, each
+node's transform, scale, colour and bounds, and the meshes, materials,
+animations and shaders they use, referred to by name.
+
+The layout is a small versioned header, then a block of null terminated
+strings, then a table of resources, then the nodes as one flat array of
+fixed size records, parents always before their children. Each resource
+is only listed once however many nodes use it, and every string is only
+stored once, so the file is little more than the node records themselves.
+Every field is written on its own as a little endian 32 bit value, so the
+file is the same whichever compiler or machine wrote it, and loading it
+is one read and a pass over the bytes.
+
+Turning a SceneFile into actual nodes is up to SceneLoader.
+*/
+class SceneFile {
+public:
+	enum ResourceType {
+		RESOURCE_MESH,
+		RESOURCE_MATERIAL,
+		RESOURCE_ANIMATION,
+		RESOURCE_SHADER,
+		RESOURCE_TYPE_COUNT
+	};
+	static const int32_t NO_RESOURCE = -1;
+
+	struct Resource {
+		uint32_t	type;
+		uint32_t	name;	//offset into the string block
+	};
+
+	struct Node {
+		int32_t		parent;		//index of the parent node, or -1
+		uint32_t	type;		//offset into the string block
+		int32_t		resources[RESOURCE_TYPE_COUNT];
+		float		transform[16];
+		float		scale[3];
+		float		colour[4];
+		float		boundingRadius;	//0 to let the node work it out itself
+		float		params[4];		//meaning depends on the node type
+	};
+
+	SceneFile(void);
+	~SceneFile(void) {};
+
+	//Returns the new node's index. Parents must be added before children
+	int		AddNode(int parent, const std::string& type, const Matrix4& transform);
+	void	SetResource(int node, ResourceType type, const std::string& name);
+	Node&		GetNode(int i)			{ return nodes[i]; }
+	const Node&	GetNode(int i)	const	{ return nodes[i]; }
+	size_t		GetNodeCount()	const	{ return nodes.size(); }
+
+	const Resource&	GetResource(int i)		const { return resources[i]; }
+	size_t			GetResourceCount()		const { return resources.size(); }
+
+	const char*	GetString(uint32_t offset)	const { return &strings[offset]; }
+
+	bool	Save(const std::string& filename) const;
+	bool	Load(const std::string& filename);
+
+	static Matrix4	GetTransform(const Node& n);
+	static Vector3	GetScale(const Node& n)		{ return Vector3(n.scale[0], n.scale[1], n.scale[2]); }
+	static Vector4	GetColour(const Node& n) {
+		return Vector4(n.colour[0], n.colour[1], n.colour[2], n.colour[3]);
+	}
+
+protected:
+	uint32_t	AddString(const std::string& s);
+
+	std::vector<char>		strings;
+	std::vector<Resource>	resources;
+	std::vector<Node>		nodes;
+};
@@ -0,0 +1,182 @@
+#include "SceneLoader.h"
+#include "SceneNode.h"
+#include "Mesh.h"
+#include "MeshMaterial.h"
+#include "MeshAnimation.h"
+#include <iostream>
+
+SceneLoader::SceneLoader(void) {
+	RegisterType("SceneNode", [](const NodeInfo& info) {
+		SceneNode* n = new SceneNode(info.mesh, Vector4(1, 1, 1, 1), info.shader);
+		ApplyRecord(n, *info.record);
+		return n;
+	});
+}
+
+SceneLoader::~SceneLoader(void) {
+	for (auto& i : meshes) {
+		delete i.second;
+	}
+	for (auto& i : materials) {
+		delete i.second;
+	}
+	for (auto& i : animations) {
+		delete i.second;
+	}
+	for (auto& i : textures) {
+		GLStateCache::ForgetTexture(i.second);
+		glDeleteTextures(1, &i.second);
+	}
+}
+
+void SceneLoader::RegisterType(const std::string& type, NodeFactory factory) {
+	factories[type] = factory;
+}
+
+void SceneLoader::RegisterShader(const std::string& name, Shader* shader) {
+	shaders[name] = shader;
+}
+
+Mesh* SceneLoader::GetMesh(const std::string& name) {
+	auto i = meshes.find(name);
+	if (i != meshes.end()) {
+		return i->second;
+	}
+	Mesh* m = Mesh::LoadFromMeshFile(name);
+	meshes.insert(std::make_pair(name, m));
+	return m;
+}
+
+MeshMaterial* SceneLoader::GetMaterial(const std::string& name) {
+	auto i = materials.find(name);
+	if (i != materials.end()) {
+		return i->second;
+	}
+	MeshMaterial* m = new MeshMaterial(name);
+	materials.insert(std::make_pair(name, m));
+	return m;
+}
+
+MeshAnimation* SceneLoader::GetAnimation(const std::string& name) {
+	auto i = animations.find(name);
+	if (i != animations.end()) {
+		return i->second;
+	}
+	MeshAnimation* a = new MeshAnimation(name);
+	animations.insert(std::make_pair(name, a));
+	return a;
+}
+
+GLuint SceneLoader::GetTexture(const std::string& name) {
+	auto i = textures.find(name);
+	if (i != textures.end()) {
+		return i->second;
+	}
+	std::string path = TEXTUREDIR + name;
+	GLuint tex = SOIL_load_OGL_texture(path.c_str(), SOIL_LOAD_AUTO,
+		SOIL_CREATE_NEW_ID, SOIL_FLAG_MIPMAPS | SOIL_FLAG_INVERT_Y);
+	textures.insert(std::make_pair(name, tex));
+	return tex;
+}
+
+const std::vector<GLuint>& SceneLoader::GetMaterialTextures(MeshMaterial* material, Mesh* mesh) {
+	std::vector<GLuint>& layers = materialTextures[std::make_pair(material, mesh)];
+	if (layers.empty() && material && mesh) {
+		for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
+			const MeshMaterialEntry* entry = material->GetMaterialForLayer(i);
+			const string* filename = nullptr;
+			if (entry && entry->GetEntry("Diffuse", &filename)) {
+				layers.emplace_back(GetTexture(*filename));
+			}
+			else {
+				layers.emplace_back(0);
+			}
+		}
+	}
+	return layers;
+}
+
+void SceneLoader::ApplyRecord(SceneNode* n, const SceneFile::Node& record) {
+	n->SetTransform(SceneFile::GetTransform(record));
+	n->SetModelScale(SceneFile::GetScale(record));
+	n->SetColour(SceneFile::GetColour(record));
+	if (record.boundingRadius > 0.0f) {
+		n->SetBoundingRadius(record.boundingRadius);
+	}
+}
+
+SceneNode* SceneLoader::Instantiate(const SceneFile& file) {
+	const size_t nodeCount = file.GetNodeCount();
+	if (nodeCount == 0) {
+		return NULL;
+	}
+	//Sort out every resource first, once each, so the nodes can just look
+	//them up by index
+	std::vector<void*> resources(file.GetResourceCount(), nullptr);
+	for (size_t i = 0; i < file.GetResourceCount(); ++i) {
+		const SceneFile::Resource& r = file.GetResource((int)i);
+		const std::string name = file.GetString(r.name);
+		switch (r.type) {
+		case SceneFile::RESOURCE_MESH:		resources[i] = GetMesh(name);		break;
+		case SceneFile::RESOURCE_MATERIAL:	resources[i] = GetMaterial(name);	break;
+		case SceneFile::RESOURCE_ANIMATION:	resources[i] = GetAnimation(name);	break;
+		case SceneFile::RESOURCE_SHADER: {
+			auto s = shaders.find(name);
+			if (s == shaders.end()) {
+				std::cout << "Scene uses unknown shader " << name << "!\n";
+			}
+			else {
+				resources[i] = s->second;
+			}
+		}	break;
+		}
+	}
+	//Same for the factories, as most nodes share a handful of types
+	std::map<uint32_t, const NodeFactory*> typeFactories;
+	const NodeFactory* fallback = &factories["SceneNode"];
+
+	//Size everything up front, rather than growing it node by node
+	std::vector<unsigned int> childCounts(nodeCount, 0);
+	for (size_t i = 1; i < nodeCount; ++i) {
+		const int32_t parent = file.GetNode((int)i).parent;
+		++childCounts[parent < 0 ? 0 : parent];
+	}
+	SceneNode::GetTransformHierarchy().Reserve(nodeCount);
+	std::vector<SceneNode*> created(nodeCount, nullptr);
+
+	for (size_t i = 0; i < nodeCount; ++i) {
+		const SceneFile::Node& record = file.GetNode((int)i);
+
+		auto f = typeFactories.find(record.type);
+		if (f == typeFactories.end()) {
+			auto registered = factories.find(file.GetString(record.type));
+			if (registered == factories.end()) {
+				std::cout << "Scene uses unknown node type "
+					<< file.GetString(record.type) << "!\n";
+			}
+			f = typeFactories.insert(std::make_pair(record.type,
+				registered == factories.end() ? fallback : &registered->second)).first;
+		}
+
+		NodeInfo info;
+		info.record		= &record;
+		info.mesh		= (Mesh*)(record.resources[SceneFile::RESOURCE_MESH] < 0 ? nullptr :
+			resources[record.resources[SceneFile::RESOURCE_MESH]]);
+		info.material	= (MeshMaterial*)(record.resources[SceneFile::RESOURCE_MATERIAL] < 0 ? nullptr :
+			resources[record.resources[SceneFile::RESOURCE_MATERIAL]]);
+		info.animation	= (MeshAnimation*)(record.resources[SceneFile::RESOURCE_ANIMATION] < 0 ? nullptr :
+			resources[record.resources[SceneFile::RESOURCE_ANIMATION]]);
+		info.shader		= (Shader*)(record.resources[SceneFile::RESOURCE_SHADER] < 0 ? nullptr :
+			resources[record.resources[SceneFile::RESOURCE_SHADER]]);
+		info.textures	= info.material ?
+			&GetMaterialTextures(info.material, info.mesh) : nullptr;
+
+		SceneNode* n = (*f->second)(info);
+		n->ReserveChildren(childCounts[i]);
+		created[i] = n;
+		if (i > 0) {
+			created[record.parent < 0 ? 0 : record.parent]->AddChild(n);
+		}
+	}
+	return created[0];
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "SceneFile.h"
+#include "OGLRenderer.h"
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class SceneNode;
+class Mesh;
+class MeshMaterial;
+class MeshAnimation;
+class Shader;
+
+/*
+Builds scene graphs out of SceneFiles.
+
+Every resource a file mentions is loaded once, up front, and then shared
+between all of the nodes using it - and kept, so loading another file
+that uses the same meshes doesn't load them again. Material textures are
+shared the same way, rather than every node loading its own copies.
+Shaders aren't loaded from files, they have to be handed over by name.
+
+Each node type name maps to a factory function, which gets the node's
+record and its resources, and returns a new node - anything in the file
+with a type nobody registered becomes a plain SceneNode. Plenty of node
+types set up their own transforms, so it's up to the factory whether to
+use the one in the file, with ApplyRecord.
+
+The loader owns everything it loads, so it has to outlive the nodes.
+*/
+class SceneLoader {
+public:
+	struct NodeInfo {
+		const SceneFile::Node*	record;
+		Mesh*					mesh;
+		MeshMaterial*			material;
+		MeshAnimation*			animation;
+		Shader*					shader;
+		//The material's textures, one per submesh, or NULL if there's
+		//no material
+		const std::vector<GLuint>*	textures;
+	};
+	typedef std::function<SceneNode*(const NodeInfo&)> NodeFactory;
+
+	SceneLoader(void);
+	~SceneLoader(void);
+
+	void	RegisterType(const std::string& type, NodeFactory factory);
+	void	RegisterShader(const std::string& name, Shader* shader);
+
+	//Returns the first node in the file, with everything else below it
+	SceneNode*	Instantiate(const SceneFile& file);
+
+	//Sets the node's transform, scale and colour to the ones in the file,
+	//and its bounds too, if the file has any
+	static void	ApplyRecord(SceneNode* n, const SceneFile::Node& record);
+
+	Mesh*			GetMesh(const std::string& name);
+	MeshMaterial*	GetMaterial(const std::string& name);
+	MeshAnimation*	GetAnimation(const std::string& name);
+	const std::vector<GLuint>&	GetMaterialTextures(MeshMaterial* material, Mesh* mesh);
+
+protected:
+	GLuint	GetTexture(const std::string& name);
+
+	std::map<std::string, NodeFactory>		factories;
+	std::map<std::string, Shader*>			shaders;
+	std::map<std::string, Mesh*>			meshes;
+	std::map<std::string, MeshMaterial*>	materials;
+	std::map<std::string, MeshAnimation*>	animations;
+	std::map<std::string, GLuint>			textures;
+	//per material and mesh pair, as the mesh decides which layers it has
+	std::map<std::pair<MeshMaterial*, Mesh*>, std::vector<GLuint>>	materialTextures;
+};
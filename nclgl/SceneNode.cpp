@@ -1,42 +1,198 @@
 #include "SceneNode.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cfloat>
+
+TransformHierarchy SceneNode::transforms;
+
+SceneNode*				SceneNode::parallelRoot	= NULL;
+ThreadPool*				SceneNode::parallelPool	= NULL;
+vector<SceneNode*>		SceneNode::parallelChildren;
+vector<SceneNode::UpdateBatch>	SceneNode::updateBatches;
 
 SceneNode::SceneNode(Mesh* mesh, Vector4 colour, Shader* s) {
 	this->mesh		= mesh;
 	this->colour	= colour;
-	if (s) { this->shader = s; }
+	this->shader	= s;
 
 	parent			= NULL;
 	modelScale		= Vector3(1, 1, 1);
+	transformHandle	= transforms.Add();
 
-	boundingRadius		= 1.0f;
 	distanceFromCamera	= 0.0f;
 	texture				= 0;
+	currentLOD			= 0;
 }
 
+/*
+Rather than each node deleting its children, which delete their own
+children and so on, the node flattens its whole subtree into one list
+first (parents before children) and deletes it from the back - so the
+nodes' own destructors never have any children left to recurse into,
+and every child is still removed before its parent.
+*/
 SceneNode::~SceneNode(void) {
-	for (unsigned int i = 0; i < children.size(); ++i) {
-		delete children[i];
+	if (!children.empty()) {
+		vector<SceneNode*> subtree;
+		subtree.swap(children);
+		for (size_t i = 0; i < subtree.size(); ++i) {
+			SceneNode* n = subtree[i];
+			subtree.insert(subtree.end(), n->children.begin(), n->children.end());
+			n->children.clear();
+		}
+		for (size_t i = subtree.size(); i > 0; --i) {
+			delete subtree[i - 1];
+		}
 	}
+	transforms.Remove(transformHandle);
 }
 
 void SceneNode::AddChild(SceneNode* s) {
 	children.push_back(s);
 	s->parent = this;
+	transforms.SetParent(s->transformHandle, transformHandle);
+}
+
+bool SceneNode::RemoveChild(SceneNode* s) {
+	vector<SceneNode*>::iterator i = std::find(children.begin(), children.end(), s);
+	if (i == children.end()) {
+		return false;
+	}
+	children.erase(i);
+	s->parent = NULL;
+	transforms.SetParent(s->transformHandle, TransformHierarchy::INVALID_HANDLE);
+	return true;
+}
+
+void SceneNode::SetMesh(Mesh* m) {
+	if (!lods.empty()) {
+		lods[0].mesh = m;
+		if (currentLOD != 0) {
+			return;
+		}
+	}
+	mesh = m;
+}
+
+void SceneNode::AddLOD(Mesh* m, float maxScreenSize) {
+	if (lods.empty()) {
+		lods.push_back({ mesh, FLT_MAX });
+	}
+	LODLevel level = { m, maxScreenSize };
+	//Keep them in order of detail, whatever order they're added in
+	vector<LODLevel>::iterator i = lods.begin() + 1;
+	while (i != lods.end() && i->maxScreenSize >= maxScreenSize) {
+		++i;
+	}
+	lods.insert(i, level);
+}
+
+void SceneNode::SelectLOD(float screenSize, float hysteresis) {
+	if (lods.empty()) {
+		return;
+	}
+	int level = currentLOD;
+	while (level + 1 < (int)lods.size() &&
+		screenSize < lods[level + 1].maxScreenSize * (1.0f - hysteresis)) {
+		++level;
+	}
+	while (level > 0 &&
+		screenSize > lods[level].maxScreenSize * (1.0f + hysteresis)) {
+		--level;
+	}
+	currentLOD	= level;
+	mesh		= lods[level].mesh;
 }
 
 void SceneNode::Draw(const OGLRenderer& r) {
 	if (mesh) { mesh->Draw(); }
 }
 
+void SceneNode::DrawInstanced(const OGLRenderer& r, int count, int baseInstance) {
+	if (mesh) { mesh->DrawInstanced(count, baseInstance); }
+}
+
+/*
+Nodes no longer work out their own world transform as they're updated -
+instead, once the whole graph below the root has had its Update, the
+transform hierarchy propagates world transforms in one pass, through only
+the subtrees whose local transforms changed this frame.
+*/
 void SceneNode::Update(float dt) {
-	if (parent) {
-		worldTransform = parent->worldTransform * transform;
-	}
-	else { // this node is root node.
-		worldTransform = transform;
+	if (this == parallelRoot) {
+		UpdateChildrenParallel(dt);
 	}
-	for (vector<SceneNode*>::iterator i = children.begin();
+	else for (vector<SceneNode*>::iterator i = children.begin();
 		i != children.end(); ++i) {
 		(*i)->Update(dt);
 	}
-}
\ No newline at end of file
+	if (!parent) { // this node is root node.
+		transforms.UpdateWorldTransforms();
+	}
+}
+
+/*
+The root's own Update still runs, on this thread - it's only when it gets
+round to SceneNode::Update that its children are farmed out.
+*/
+void SceneNode::UpdateParallel(float dt, ThreadPool& pool) {
+	parallelRoot = this;
+	parallelPool = &pool;
+	Update(dt);
+	parallelRoot = NULL;
+	parallelPool = NULL;
+}
+
+bool SceneNode::SubtreeCanUpdateInParallel() const {
+	if (!CanUpdateInParallel()) {
+		return false;
+	}
+	for (const SceneNode* child : children) {
+		if (!child->SubtreeCanUpdateInParallel()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+Subtrees only write to their own nodes, and to their own entries in the
+transform hierarchy, so they can be updated in any order on any thread
+and still give the same result as a serial update. Children are handed
+out in batches, so a root with thousands of small children doesn't pay
+for thousands of tasks - and each task only captures a pointer to its
+batch, which is small enough for the Task to keep without allocating.
+*/
+void SceneNode::UpdateChildrenParallel(float dt) {
+	parallelChildren.clear();
+	for (SceneNode* child : children) {
+		if (child->SubtreeCanUpdateInParallel()) {
+			parallelChildren.emplace_back(child);
+		}
+		else {
+			child->Update(dt);
+		}
+	}
+
+	const size_t count		= parallelChildren.size();
+	const size_t batches	= (parallelPool->GetWorkerCount() + 1) * 4;
+	const size_t batchSize	= (count + batches - 1) / batches;
+
+	//Filled in before anything is submitted, so it's never reallocated
+	//from under a running task
+	updateBatches.clear();
+	for (size_t start = 0; start < count; start += batchSize) {
+		updateBatches.push_back(UpdateBatch{ &parallelChildren[start],
+			std::min(batchSize, count - start), dt });
+	}
+	for (const UpdateBatch& batch : updateBatches) {
+		const UpdateBatch* b = &batch;
+		parallelPool->Submit([b] {
+			PROFILE_SCOPE("Update batch");
+			for (size_t i = 0; i < b->count; ++i) {
+				b->nodes[i]->Update(b->dt);
+			}
+		});
+	}
+	parallelPool->Wait();
+}
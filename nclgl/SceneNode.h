@@ -3,16 +3,25 @@
 #include "Vector3.h"
 #include "Vector4.h"
 #include "Mesh.h"
+#include "TransformHierarchy.h"
+#include "ThreadPool.h"
+#include "SceneNodePool.h"
 #include <vector>
 
 class SceneNode {
 public:
 	SceneNode(Mesh* m = NULL, Vector4 colour = Vector4(1, 1, 1, 1), Shader* s = NULL);
-	~SceneNode(void);
+	//Also deletes every node below this one
+	virtual ~SceneNode(void);
 
-	void	SetTransform(const Matrix4& matrix) { transform = matrix; }
-	const Matrix4&	GetTransform()		const	{ return transform; }
-	Matrix4			GetWorldTransform() const	{ return worldTransform; }
+	//Nodes of every type come out of the node pool, not straight off the heap
+	static void*	operator new(size_t bytes)				{ return SceneNodePool::Allocate(bytes); }
+	static void		operator delete(void* p, size_t bytes)	{ SceneNodePool::Free(p, bytes); }
+
+	void	SetTransform(const Matrix4& matrix) { transforms.SetLocal(transformHandle, matrix); }
+	const Matrix4&	GetTransform()		const	{ return transforms.GetLocal(transformHandle); }
+	//As of the end of the last Update of the root node
+	const Matrix4&	GetWorldTransform() const	{ return transforms.GetWorld(transformHandle); }
 
 	Vector4			GetColour()			const	{ return colour; }
 	void			SetColour(Vector4 c)		{ colour = c; }
@@ -20,14 +29,54 @@ public:
 	Vector3			GetModelScale()		const	{ return modelScale; }
 	void			SetModelScale(Vector3 s)	{ modelScale = s; }
 
+	//The mesh for the current level of detail
 	Mesh*			GetMesh()			const	{ return mesh; }
-	void			SetMesh(Mesh* m)			{ mesh = m; }
-
+	//Sets the most detailed mesh
+	void			SetMesh(Mesh* m);
+
+	//Adds a lower detail mesh, drawn while the node covers no more than
+	//maxScreenSize pixels on screen. The node's own mesh is level 0, and is
+	//used whenever it's bigger than that
+	void			AddLOD(Mesh* m, float maxScreenSize);
+	int				GetLODCount()		const	{ return lods.empty() ? 1 : (int)lods.size(); }
+	int				GetCurrentLOD()		const	{ return currentLOD; }
+	Mesh*			GetLODMesh(int level) const	{ return lods.empty() ? mesh : lods[level].mesh; }
+	//Picks the level of detail for the node's size on screen - but only
+	//moves past a boundary once the size is more than 'hysteresis' (as a
+	//fraction) beyond it, so nodes sitting right on one don't flicker
+	void			SelectLOD(float screenSize, float hysteresis);
+
+	SceneNode*		GetParent()			const	{ return parent; }
 	void			AddChild(SceneNode* s);
+	//Doesn't delete the child - that's up to the caller
+	bool			RemoveChild(SceneNode* s);
+	//For nodes that know how many children they'll have up front
+	void			ReserveChildren(size_t count) { children.reserve(count); }
 
 	virtual void	Update(float dt);
+	//Calls Update as normal, but with the children's subtrees handed out as
+	//tasks on the pool. Only meant for the root node - gives the same
+	//result as Update, however many threads
+	void			UpdateParallel(float dt, ThreadPool& pool);
+	//Nodes that touch anything outside of their own subtree while updating
+	//(including adding or removing nodes) should return false. The root's
+	//child with one of those anywhere below it is then updated on the
+	//calling thread, in order, before the rest
+	virtual bool	CanUpdateInParallel() const { return true; }
 	virtual void	Draw(const OGLRenderer& r);
 
+	//Nodes that never move once the scene is built, and draw nothing but
+	//their mesh, can have their geometry baked into a StaticBatcher batch
+	virtual bool	IsStatic() const { return false; }
+	//The texture a submesh is drawn with
+	virtual GLuint	GetSubMeshTexture(int i) const { return texture; }
+
+	//Nodes whose Draw does nothing but bind their textures and draw their
+	//mesh with their world transform can be drawn as one of many instances,
+	//with the transforms coming from the mesh's instance buffer instead
+	virtual bool	CanInstance() const { return false; }
+	virtual void	DrawInstanced(const OGLRenderer& r, int count, int baseInstance);
+
 	std::vector<SceneNode*>::const_iterator GetChildIteratorStart() {
 		return children.begin();
 	}
@@ -35,8 +84,12 @@ public:
 		return children.end();
 	}
 
-	float GetBoundingRadius()			const	{ return boundingRadius; }
-	void SetBoundingRadius(float f)				{ boundingRadius = f; }
+	float GetBoundingRadius()			const	{ return transforms.GetRadius(transformHandle); }
+	void SetBoundingRadius(float f)				{ transforms.SetRadius(transformHandle, f); }
+	//Encloses this node and all of its children, as of the last Update
+	const BoundingSphere& GetSubtreeBounds() const {
+		return transforms.GetSubtreeBounds(transformHandle);
+	}
 
 	float GetCameraDistance()			const	{ return distanceFromCamera; }
 	void SetCameraDistance(float f)				{ distanceFromCamera = f; }
@@ -51,18 +104,45 @@ public:
 
 	Shader* GetShader() const { return shader; }
 
+	//Also has the recomputed / skipped counts for the last update
+	static TransformHierarchy& GetTransformHierarchy() { return transforms; }
+
 protected:
 	SceneNode*	parent;
 	Mesh*		mesh;
-	Matrix4		worldTransform;
-	Matrix4		transform;
+	TransformHierarchy::Handle transformHandle;
 	Vector3		modelScale;
 	Vector4		colour;
 	std::vector<SceneNode*> children;
 
 	float		distanceFromCamera; // used for sorting by distance
-	float		boundingRadius; // used for frustum culling
 	GLuint		texture;
 	Shader*		shader;
+
+	struct LODLevel {
+		Mesh*	mesh;
+		float	maxScreenSize;
+	};
+	std::vector<LODLevel>	lods;	//most detailed first, empty if there's only the one mesh
+	int			currentLOD;
+
+	//Every node's local and world transform lives in here
+	static TransformHierarchy transforms;
+
+	//A run of the root's children, updated as one task
+	struct UpdateBatch {
+		SceneNode* const*	nodes;
+		size_t				count;
+		float				dt;
+	};
+	bool	SubtreeCanUpdateInParallel() const;
+	void	UpdateChildrenParallel(float dt);
+
+	//Only one root updates in parallel at a time, so these are shared, and
+	//kept from frame to frame so the update doesn't allocate
+	static SceneNode*				parallelRoot;
+	static ThreadPool*				parallelPool;
+	static std::vector<SceneNode*>	parallelChildren;
+	static std::vector<UpdateBatch>	updateBatches;
 };
 
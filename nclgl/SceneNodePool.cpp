@@ -0,0 +1,98 @@
+#include "SceneNodePool.h"
+
+std::vector<SceneNodePool::SizeClass>	SceneNodePool::sizeClasses;
+size_t									SceneNodePool::liveCount = 0;
+bool									SceneNodePool::pooling	= true;
+
+//Every node starts on a boundary this size, which is as much as new gives
+const size_t NODE_ALIGNMENT = alignof(std::max_align_t);
+
+static size_t RoundUp(size_t bytes) {
+	return (bytes + (NODE_ALIGNMENT - 1)) & ~(NODE_ALIGNMENT - 1);
+}
+
+SceneNodePool::SizeClass& SceneNodePool::GetSizeClass(size_t bytes) {
+	//Only ever a handful of node types, so a search is plenty
+	for (SizeClass& c : sizeClasses) {
+		if (c.bytes == bytes) {
+			return c;
+		}
+	}
+	SizeClass c;
+	c.bytes		= bytes;
+	c.freeList	= nullptr;
+	sizeClasses.push_back(c);
+	return sizeClasses.back();
+}
+
+void SceneNodePool::AddChunk(SizeClass& c) {
+	char* chunk = new char[c.bytes * CHUNK_NODES];
+	c.chunks.push_back(chunk);
+	//Thread the free list through in address order, so nodes allocated one
+	//after another end up next to each other
+	for (size_t i = CHUNK_NODES; i > 0; --i) {
+		FreeNode* n = (FreeNode*)(chunk + (c.bytes * (i - 1)));
+		n->next		= c.freeList;
+		c.freeList	= n;
+	}
+}
+
+void* SceneNodePool::Allocate(size_t bytes) {
+	if (!pooling) {
+		++liveCount;
+		return ::operator new(bytes);
+	}
+	SizeClass& c = GetSizeClass(RoundUp(bytes));
+	if (!c.freeList) {
+		AddChunk(c);
+	}
+	FreeNode* n = c.freeList;
+	c.freeList	= n->next;
+	++liveCount;
+	return n;
+}
+
+void SceneNodePool::Free(void* p, size_t bytes) {
+	if (!p) {
+		return;
+	}
+	if (!pooling) {
+		--liveCount;
+		::operator delete(p);
+		return;
+	}
+	SizeClass& c = GetSizeClass(RoundUp(bytes));
+	FreeNode* n = (FreeNode*)p;
+	n->next		= c.freeList;
+	c.freeList	= n;
+	--liveCount;
+}
+
+bool SceneNodePool::Release() {
+	if (liveCount > 0) {
+		return false;
+	}
+	for (SizeClass& c : sizeClasses) {
+		for (char* chunk : c.chunks) {
+			delete[] chunk;
+		}
+	}
+	sizeClasses.clear();
+	return true;
+}
+
+bool SceneNodePool::SetPooling(bool on) {
+	if (liveCount > 0) {
+		return false;
+	}
+	pooling = on;
+	return true;
+}
+
+size_t SceneNodePool::GetChunkCount() {
+	size_t count = 0;
+	for (const SizeClass& c : sizeClasses) {
+		count += c.chunks.size();
+	}
+	return count;
+}
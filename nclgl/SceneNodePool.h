@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/*
+Memory for scene nodes. Rather than each node being a separate heap
+allocation, nodes are carved out of chunks holding many nodes each, so
+a scene graph ends up packed into a handful of blocks instead of spread
+all over the heap, and building and tearing one down rarely touches the
+heap at all.
+
+Each size of node gets its own size class, with its own chunks and free
+list - so in practice every node type (SceneNode, AnimObjNode, WaterNode
+and so on) has its own list, and freed nodes are reused by the next node
+of the same type.
+
+SceneNode's operator new and delete go through here, so nothing else
+needs to change to use it. Like adding and removing nodes, it's not
+thread safe.
+*/
+class SceneNodePool {
+public:
+	//How many nodes each new chunk of a size class holds
+	static const size_t CHUNK_NODES = 64;
+
+	static void*	Allocate(size_t bytes);
+	static void		Free(void* p, size_t bytes);
+
+	//Hands every chunk back to the heap in one go. Only allowed once every
+	//node has been deleted - returns false, and does nothing, otherwise
+	static bool		Release();
+
+	//Switching pooling off sends every node straight to the heap instead,
+	//for comparing the two. Like Release, only allowed with no nodes alive
+	static bool		SetPooling(bool on);
+
+	static size_t	GetLiveCount()	{ return liveCount; }
+	static size_t	GetChunkCount();
+
+protected:
+	struct FreeNode {
+		FreeNode* next;
+	};
+	struct SizeClass {
+		size_t				bytes;
+		FreeNode*			freeList;
+		std::vector<char*>	chunks;
+	};
+
+	static SizeClass&	GetSizeClass(size_t bytes);
+	static void			AddChunk(SizeClass& c);
+
+	static std::vector<SizeClass>	sizeClasses;
+	static size_t					liveCount;
+	static bool						pooling;
+};
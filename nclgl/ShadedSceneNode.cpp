@@ -13,14 +13,20 @@ void ShadedSceneNode::Draw(const OGLRenderer& r) {
 	}
 }
 
+// the instanced shader is the one bound, so its diffuseTex is left to
+// whoever bound it
+void ShadedSceneNode::DrawInstanced(const OGLRenderer& r, int count, int baseInstance) {
+	if (mesh) {
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture);
+		mesh->DrawInstanced(count, baseInstance);
+	}
+}
+
 void ShadedSceneNode::UpdateShaderMatrices() {
-	glUniformMatrix4fv(glGetUniformLocation(shader->GetProgram(), 
-						"modelMatrix"), 1, false, transform.values);
+	shader->SetUniform(UNIFORM("modelMatrix"), GetWorldTransform());
 }
 
 void ShadedSceneNode::LoadTexture() {
-	glUniform1i(glGetUniformLocation(shader->GetProgram(), 
-										"diffuseTex"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	shader->SetUniform(UNIFORM("diffuseTex"), 0);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture);
 }
\ No newline at end of file
@@ -8,6 +8,10 @@ public:
     
 	virtual void Draw(const OGLRenderer& r);
 
+	//Subclasses that set anything else up in Draw must return false
+	virtual bool CanInstance() const { return true; }
+	virtual void DrawInstanced(const OGLRenderer& r, int count, int baseInstance);
+
 	// Shader* GetShader() const { return shader; }
 
 protected:
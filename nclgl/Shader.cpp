@@ -1,6 +1,8 @@
 #include "Shader.h"
 #include "Mesh.h"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 using std::string;
 using std::cout;
@@ -8,6 +10,11 @@ using std::ifstream;
 
 vector<Shader*> Shader::allShaders;
 
+size_t Shader::frameUploads		= 0;
+size_t Shader::frameSkipped		= 0;
+size_t Shader::lastFrameUploads	= 0;
+size_t Shader::lastFrameSkipped	= 0;
+
 GLuint shaderTypes[SHADER_MAX] = {
 	GL_VERTEX_SHADER,
 	GL_FRAGMENT_SHADER,
@@ -24,14 +31,16 @@ string ShaderNames[SHADER_MAX] = {
 	"Tess. Eval"
 };
 
-Shader::Shader(const string& vertex, const string& fragment, const string& geometry, const string& domain, const string& hull)	{
+Shader::Shader(const string& vertex, const string& fragment, const string& geometry, const string& domain, const string& hull, const string& defines)	{
 	shaderFiles[SHADER_VERTEX]		= vertex;
 	shaderFiles[SHADER_FRAGMENT]	= fragment;
 	shaderFiles[SHADER_GEOMETRY]	= geometry;
 	shaderFiles[SHADER_DOMAIN]		= domain;
 	shaderFiles[SHADER_HULL]		= hull;
+	this->defines					= defines;
 
 	Reload(false);
+	sortID = (unsigned int)allShaders.size();
 	allShaders.emplace_back(this);
 }
 
@@ -58,6 +67,8 @@ void	Shader::Reload(bool deleteOld) {
 	SetDefaultAttributes();
 	LinkProgram();
 	PrintLinkLog(programID);
+	ReflectUniforms();
+	BindUniformBlocks();
 }
 
 bool	Shader::LoadShaderFile(const string& filename, string &into)	{
@@ -92,6 +103,30 @@ void	Shader::GenerateShaderObject(unsigned int i)	{
 		return;
 	}
 
+	if (!defines.empty()) {
+		//#version has to stay the first thing the compiler sees - and
+		//without one it'd be 1.10, which nothing here is written for
+		size_t version = shaderText.find("#version");
+		if (version == string::npos) {
+			cout << "Shader has no #version, assuming 330 core!\n";
+			shaderText.insert(0, "#version 330 core\n");
+			version = 0;
+		}
+		size_t at = shaderText.find('\n', version);
+		if (at == string::npos) {
+			at = shaderText.length();
+			shaderText += "\n";
+		}
+		//Defines starting with their own #version replace the file's, for
+		//permutations that need a newer one than the rest
+		if (defines.compare(0, 8, "#version") == 0) {
+			shaderText.replace(version, at + 1 - version, defines + "\n");
+		}
+		else {
+			shaderText.insert(at + 1, defines + "\n");
+		}
+	}
+
 	objectIDs[i] = glCreateShader(shaderTypes[i]);
 
 	const char *chars	= shaderText.c_str();
@@ -127,6 +162,8 @@ void	Shader::SetDefaultAttributes()	{
 
 	glBindAttribLocation(programID, WEIGHTVALUE_BUFFER, "jointWeights");
 	glBindAttribLocation(programID, WEIGHTINDEX_BUFFER, "jointIndices");
+
+	glBindAttribLocation(programID, Mesh::DRAW_ID_ATTRIBUTE, "drawID");
 }
 
 void	Shader::DeleteIDs() {
@@ -139,6 +176,7 @@ void	Shader::DeleteIDs() {
 			glDeleteShader(objectIDs[i]);
 		}
 	}
+	GLStateCache::ForgetProgram(programID);
 	glDeleteProgram(programID);
 	programID = 0;
 }
@@ -170,4 +208,152 @@ void Shader::ReloadAllShaders() {
 	for (auto& i : allShaders) {
 		i->Reload();
 	}
+}
+
+void Shader::ReflectUniforms() {
+	uniforms.clear();
+	if (programValid != GL_TRUE) {
+		return;
+	}
+	GLint count		= 0;
+	GLint maxLength	= 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	vector<char> name(std::max(maxLength, 1));
+	for (GLint i = 0; i < count; ++i) {
+		Uniform u;
+		GLsizei length = 0;
+		glGetActiveUniform(programID, (GLuint)i, maxLength, &length,
+			&u.size, &u.type, name.data());
+
+		u.location = glGetUniformLocation(programID, name.data());
+		if (u.location < 0) {
+			continue;	//part of a uniform block
+		}
+		//Arrays come back as name[0], but are set by their plain name
+		string plain(name.data(), length);
+		size_t bracket = plain.find('[');
+		if (bracket != string::npos) {
+			plain.erase(bracket);
+		}
+		u.hash			= HashUniformName(plain.c_str());
+		u.name			= plain;
+		u.valueKnown	= false;
+		uniforms.push_back(u);
+	}
+	std::sort(uniforms.begin(), uniforms.end(),
+		[](const Uniform& a, const Uniform& b) { return a.hash < b.hash; });
+}
+
+void Shader::BindUniformBlocks() {
+	if (programValid != GL_TRUE) {
+		return;
+	}
+	//Set here rather than with layout(binding) in the shaders, which would
+	//need them all to be #version 420
+	GLuint frame = glGetUniformBlockIndex(programID, "FrameData");
+	if (frame != GL_INVALID_INDEX) {
+		glUniformBlockBinding(programID, frame, FRAME_DATA_BINDING);
+	}
+	GLuint light = glGetUniformBlockIndex(programID, "LightData");
+	if (light != GL_INVALID_INDEX) {
+		glUniformBlockBinding(programID, light, LIGHT_DATA_BINDING);
+	}
+}
+
+/*
+The hash only narrows it down - names that collide sit next to each other
+once sorted, so the name picks the right one out of them, and a name the
+shader doesn't have can't pick up another uniform's slot by hashing the same.
+*/
+const Shader::Uniform* Shader::FindUniform(UniformName n) const {
+	auto i = std::lower_bound(uniforms.begin(), uniforms.end(), n.hash,
+		[](const Uniform& u, unsigned int h) { return u.hash < h; });
+	for (; i != uniforms.end() && i->hash == n.hash; ++i) {
+		if (i->name == n.name) {
+			return &*i;
+		}
+	}
+	return NULL;
+}
+
+Shader::Uniform* Shader::FindUniform(UniformName n) {
+	return const_cast<Uniform*>(((const Shader*)this)->FindUniform(n));
+}
+
+GLint Shader::GetUniformLocation(UniformName n) const {
+	const Uniform* u = FindUniform(n);
+	return u ? u->location : -1;
+}
+
+bool Shader::ChangeValue(Uniform& u, const void* data, size_t bytes) {
+	if (u.valueKnown && memcmp(u.value, data, bytes) == 0) {
+		++frameSkipped;
+		return false;
+	}
+	memcpy(u.value, data, bytes);
+	u.valueKnown = true;
+	++frameUploads;
+	return true;
+}
+
+void Shader::SetUniform(UniformName n, int i) {
+	Uniform* u = FindUniform(n);
+	if (u && ChangeValue(*u, &i, sizeof(i))) {
+		glProgramUniform1i(programID, u->location, i);
+	}
+}
+
+void Shader::SetUniform(UniformName n, float f) {
+	Uniform* u = FindUniform(n);
+	if (u && ChangeValue(*u, &f, sizeof(f))) {
+		glProgramUniform1f(programID, u->location, f);
+	}
+}
+
+void Shader::SetUniform(UniformName n, const Vector2& v) {
+	Uniform* u = FindUniform(n);
+	if (u && ChangeValue(*u, &v, sizeof(v))) {
+		glProgramUniform2fv(programID, u->location, 1, (const float*)&v);
+	}
+}
+
+void Shader::SetUniform(UniformName n, const Vector3& v) {
+	Uniform* u = FindUniform(n);
+	if (u && ChangeValue(*u, &v, sizeof(v))) {
+		glProgramUniform3fv(programID, u->location, 1, (const float*)&v);
+	}
+}
+
+void Shader::SetUniform(UniformName n, const Vector4& v) {
+	Uniform* u = FindUniform(n);
+	if (u && ChangeValue(*u, &v, sizeof(v))) {
+		glProgramUniform4fv(programID, u->location, 1, (const float*)&v);
+	}
+}
+
+void Shader::SetUniform(UniformName n, const Matrix4& m) {
+	Uniform* u = FindUniform(n);
+	if (u && ChangeValue(*u, m.values, sizeof(m.values))) {
+		glProgramUniformMatrix4fv(programID, u->location, 1, false, m.values);
+	}
+}
+
+void Shader::SetUniformArray(UniformName n, const Matrix4* m, int count) {
+	Uniform* u = FindUniform(n);
+	if (!u) {
+		return;
+	}
+	u->valueKnown = false;
+	++frameUploads;
+	glProgramUniformMatrix4fv(programID, u->location,
+		std::min(count, (int)u->size), false, (const float*)m);
+}
+
+void Shader::BeginFrameCounts() {
+	lastFrameUploads	= frameUploads;
+	lastFrameSkipped	= frameSkipped;
+	frameUploads		= 0;
+	frameSkipped		= 0;
 }
\ No newline at end of file
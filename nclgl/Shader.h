@@ -16,6 +16,8 @@ _-_-_-_-_-_-_-""  ""
 
 #pragma once
 #include "OGLRenderer.h"
+#include <type_traits>
+#include <vector>
 
 enum ShaderStage {
 	SHADER_VERTEX,
@@ -26,12 +28,39 @@ enum ShaderStage {
 	SHADER_MAX
 };
 
+//Binding points for the uniform blocks the stock shaders share, which
+//OGLRenderer keeps filled in
+enum UniformBlockBinding {
+	FRAME_DATA_BINDING,	//FrameData - view and projection matrices, camera
+	LIGHT_DATA_BINDING	//LightData - the current light
+};
+
+//FNV-1a - constexpr, so UNIFORM can hash names at compile time
+constexpr unsigned int HashUniformName(const char* name, unsigned int hash = 2166136261u) {
+	return *name ? HashUniformName(name + 1, (hash ^ (unsigned char)*name) * 16777619u) : hash;
+}
+
+//A uniform's name and its hash - made with UNIFORM("name")
+struct UniformName {
+	constexpr UniformName(const char* name, unsigned int hash) : name(name), hash(hash) {}
+
+	const char*		name;
+	unsigned int	hash;
+};
+
+//The hash goes through a template argument, so it can only ever be worked
+//out by the compiler, never per call
+#define UNIFORM(name) UniformName(name, \
+	std::integral_constant<unsigned int, HashUniformName(name)>::value)
+
 class Shader	{
 public:
-	Shader(const std::string& vertex, const std::string& fragment, const std::string& geometry = "", const std::string& domain = "", const std::string& hull = "");
+	Shader(const std::string& vertex, const std::string& fragment, const std::string& geometry = "", const std::string& domain = "", const std::string& hull = "", const std::string& defines = "");
 	~Shader(void);
 
 	GLuint  GetProgram() { return programID;}
+	//Small, stable number for this shader, for building render sort keys
+	unsigned int GetSortID() const { return sortID; }
 	
 	void	Reload(bool deleteOld = true);
 
@@ -40,6 +69,33 @@ public:
 	}
 
 	static void ReloadAllShaders();
+
+	/*
+	Every active uniform is looked up once, after linking, and kept sorted by
+	the hash of its name - so these never need glGetUniformLocation. The
+	name is still compared once the hash matches, so two names that hash
+	the same can never be mistaken for each other. Each
+	one remembers the last value it was given, and setting the same value
+	again uploads nothing, so anything set through these must only ever be
+	set through these. They use glProgramUniform, so the shader doesn't
+	need to be bound first. Uniforms the shader doesn't have are ignored.
+	*/
+	bool	HasUniform(UniformName n) const { return FindUniform(n) != NULL; }
+	GLint	GetUniformLocation(UniformName n) const;
+
+	void	SetUniform(UniformName n, int i);
+	void	SetUniform(UniformName n, float f);
+	void	SetUniform(UniformName n, const Vector2& v);
+	void	SetUniform(UniformName n, const Vector3& v);
+	void	SetUniform(UniformName n, const Vector4& v);
+	void	SetUniform(UniformName n, const Matrix4& m);
+	//Arrays are always uploaded
+	void	SetUniformArray(UniformName n, const Matrix4* m, int count);
+
+	//Uniform uploads made, and skipped as redundant, over the last frame
+	static void		BeginFrameCounts();
+	static size_t	GetLastFrameUploads()	{ return lastFrameUploads; }
+	static size_t	GetLastFrameSkipped()	{ return lastFrameSkipped; }
 	static void	PrintCompileLog(GLuint object);
 	static void	PrintLinkLog(GLuint program);
 
@@ -51,13 +107,40 @@ protected:
 	void	SetDefaultAttributes();
 	void	LinkProgram();
 
+	struct Uniform {
+		unsigned int	hash;
+		std::string		name;		//without any [0]
+		GLint			location;
+		GLenum			type;
+		GLint			size;		//array length
+		bool			valueKnown;
+		unsigned char	value[sizeof(Matrix4)];
+	};
+	void	ReflectUniforms();
+	//Points the FrameData and LightData blocks at their binding points
+	void	BindUniformBlocks();
+	const Uniform*	FindUniform(UniformName n) const;
+	Uniform*		FindUniform(UniformName n);
+	//Returns false, and counts it, if the uniform already has this value
+	bool	ChangeValue(Uniform& u, const void* data, size_t bytes);
+
 	GLuint	programID;
 	GLuint	objectIDs[SHADER_MAX];
 	GLint	programValid;
 	GLint	shaderValid[SHADER_MAX];
 
 	std::string  shaderFiles[SHADER_MAX];
+	std::string  defines;	//inserted after the #version line of every stage,
+							//or in place of it if they start with their own
+	unsigned int sortID;
+
+	std::vector<Uniform>	uniforms;	//sorted by hash
 
 	static std::vector<Shader*> allShaders;
+
+	static size_t	frameUploads;
+	static size_t	frameSkipped;
+	static size_t	lastFrameUploads;
+	static size_t	lastFrameSkipped;
 };
 
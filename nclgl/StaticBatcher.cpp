@@ -0,0 +1,110 @@
+#include "StaticBatcher.h"
+#include "ShadedSceneNode.h"
+#include "AABB.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+namespace {
+	struct BatchKey {
+		Shader*	shader;
+		GLuint	texture;
+		int		cell[3];
+
+		bool operator<(const BatchKey& o) const {
+			return std::tie(shader, texture, cell[0], cell[1], cell[2]) <
+				std::tie(o.shader, o.texture, o.cell[0], o.cell[1], o.cell[2]);
+		}
+	};
+
+	struct Batch {
+		std::vector<Mesh::CombinePiece>	pieces;
+		AABB							bounds;
+	};
+}
+
+StaticBatcher::StaticBatcher(float cellSize) {
+	this->cellSize	= cellSize;
+	sourceDraws		= 0;
+}
+
+StaticBatcher::~StaticBatcher(void) {
+	for (Mesh* m : meshes) {
+		delete m;
+	}
+}
+
+void StaticBatcher::Collect(SceneNode* from, std::vector<SceneNode*>& out) {
+	for (vector<SceneNode*>::const_iterator
+		i = from->GetChildIteratorStart();
+		i != from->GetChildIteratorEnd(); ++i) {
+		SceneNode* n = *i;
+		if (n->IsStatic() && n->GetMesh() && n->GetShader() &&
+			n->GetChildIteratorStart() == n->GetChildIteratorEnd()) {
+			out.push_back(n);
+		}
+		else {
+			Collect(n, out);
+		}
+	}
+}
+
+void StaticBatcher::Build(SceneNode* root) {
+	std::vector<SceneNode*> nodes;
+	Collect(root, nodes);
+	if (nodes.empty()) {
+		return;
+	}
+
+	//Batches end up as children of the root, so bake everything relative
+	//to it
+	const Matrix4 toRoot = root->GetWorldTransform().Inverse();
+
+	std::map<BatchKey, Batch> batches;
+	for (SceneNode* n : nodes) {
+		const Matrix4 world		= toRoot * n->GetWorldTransform();
+		const Vector3 position	= world.GetPositionVector();
+		const AABB nodeBounds	= AABB::FromSphere(position, n->GetBoundingRadius());
+
+		BatchKey key;
+		key.shader	= n->GetShader();
+		key.cell[0]	= (int)floor(position.x / cellSize);
+		key.cell[1]	= (int)floor(position.y / cellSize);
+		key.cell[2]	= (int)floor(position.z / cellSize);
+
+		//Meshes without any submeshes just go in whole
+		const int subMeshes = std::max(n->GetMesh()->GetSubMeshCount(), 1);
+		for (int i = 0; i < subMeshes; ++i) {
+			key.texture = n->GetSubMeshTexture(i);
+
+			Batch& b = batches[key];
+			b.bounds = b.pieces.empty() ? nodeBounds : AABB::Union(b.bounds, nodeBounds);
+			b.pieces.push_back({ n->GetMesh(),
+				n->GetMesh()->GetSubMeshCount() > 0 ? i : -1, world });
+			++sourceDraws;
+		}
+	}
+
+	for (auto& i : batches) {
+		Batch& b = i.second;
+		//Bake everything relative to the middle of the batch, so the node's
+		//transform and bounding sphere can sit there
+		const Vector3 centre = b.bounds.GetCentre();
+		for (Mesh::CombinePiece& p : b.pieces) {
+			p.transform = Matrix4::Translation(-centre) * p.transform;
+		}
+		Mesh* m = Mesh::GenerateCombined(b.pieces);
+		meshes.push_back(m);
+
+		SceneNode* batch = new ShadedSceneNode(i.first.shader, m, i.first.texture);
+		batch->SetTransform(Matrix4::Translation(centre));
+		batch->SetBoundingRadius(m->GetBoundingRadius());
+		root->AddChild(batch);
+	}
+
+	for (SceneNode* n : nodes) {
+		n->GetParent()->RemoveChild(n);
+		delete n;
+	}
+}
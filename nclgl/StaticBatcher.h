@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+class SceneNode;
+class Mesh;
+
+/*
+Merges static scene nodes into a few big batches at load time.
+
+Every static node is split into its submeshes, and those are grouped by
+shader, texture, and which cell of a coarse grid the node sits in. Each
+group is baked into one mesh with its vertices already in place, so it
+can be drawn with a single call and one texture bind, however many
+nodes went into it. The batches go back into the scene graph as ordinary
+nodes, each positioned at the middle of its geometry with bounds that
+fit it, so they are still culled and sorted like anything else. Bigger
+cells mean fewer draws, smaller ones mean tighter culling.
+
+Only nodes with no children are batched, as anything below a static node
+might still move.
+*/
+class StaticBatcher {
+public:
+	StaticBatcher(float cellSize = 2048.0f);
+	//Deletes the batched meshes, so the batch nodes have to go first
+	~StaticBatcher(void);
+
+	//Replaces every static node below root with batch nodes. World
+	//transforms need to be up to date first
+	void	Build(SceneNode* root);
+
+	size_t	GetBatchCount()			const { return meshes.size(); }
+	//How many submesh draws the batches replaced
+	size_t	GetSourceDrawCount()	const { return sourceDraws; }
+
+protected:
+	void	Collect(SceneNode* from, std::vector<SceneNode*>& out);
+
+	float				cellSize;
+	std::vector<Mesh*>	meshes;
+	size_t				sourceDraws;
+};
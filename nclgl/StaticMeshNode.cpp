@@ -3,7 +3,8 @@
 #include "MeshMaterial.h"
 
 StaticMeshNode::StaticMeshNode(Shader* shader, Mesh* imesh, 
-    MeshMaterial* mat,Vector3 pos, float scale, float yRot)
+    MeshMaterial* mat,Vector3 pos, float scale, float yRot,
+    const std::vector<GLuint>* textures)
     : ShadedSceneNode(shader, imesh) {
 
     this->mat = mat;
@@ -11,7 +12,10 @@ StaticMeshNode::StaticMeshNode(Shader* shader, Mesh* imesh,
     this->scale = scale;
     this->yRot = yRot;
 
-    for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
+    if (textures) {
+        matTextures = *textures;
+    }
+    else for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
         const MeshMaterialEntry* matEntry = mat->GetMaterialForLayer(i);
 
         const string* filename = nullptr;
@@ -21,26 +25,40 @@ StaticMeshNode::StaticMeshNode(Shader* shader, Mesh* imesh,
             SOIL_CREATE_NEW_ID, SOIL_FLAG_MIPMAPS | SOIL_FLAG_INVERT_Y);
         matTextures.emplace_back(texID);
     }
-    mesh->GenerateNormals();
+    // the mesh may well be shared, so only do this for the first node
+    if (!mesh->HasNormals()) {
+        mesh->GenerateNormals();
+    }
+    SetBoundingRadius(mesh->GetBoundingRadius() * scale);
+}
+
+void StaticMeshNode::Update(float dt) {
+    // local to the parent - the world transform adds its translation
+    SetTransform(Matrix4::Translation(pos) *
+                Matrix4::Scale(Vector3(scale, scale, scale)) *
+                Matrix4::Rotation(yRot, Vector3(0, 1, 0)));
+    SceneNode::Update(dt);
 }
 
 void StaticMeshNode::Draw(const OGLRenderer& r) {
     UpdateShaderMatrices();
-
-    transform.ToIdentity();
-    transform = transform * Matrix4::Translation(
-                parent->GetTransform().GetPositionVector() + pos);
-    transform = transform * Matrix4::Scale(
-                Vector3(scale, scale, scale));
-    transform = transform * Matrix4::Rotation(
-                yRot, Vector3(0, 1, 0));
     
     // SceneNode::Draw(r);
 	
     for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, matTextures[i]);
+        GLStateCache::BindTexture(0, GL_TEXTURE_2D, matTextures[i]);
         mesh->DrawSubMesh(i);
     }
     SceneNode::Draw(r);
+}
+
+void StaticMeshNode::DrawInstanced(const OGLRenderer& r, int count, int baseInstance) {
+    if (mesh->GetSubMeshCount() == 0) {
+        ShadedSceneNode::DrawInstanced(r, count, baseInstance);
+        return;
+    }
+    for (int i = 0; i < mesh->GetSubMeshCount(); ++i) {
+        GLStateCache::BindTexture(0, GL_TEXTURE_2D, matTextures[i]);
+        mesh->DrawSubMeshInstanced(i, count, baseInstance);
+    }
 }
\ No newline at end of file
@@ -5,11 +5,21 @@
 
 class StaticMeshNode : public ShadedSceneNode {
 public:
+    //If textures is given, it's used for the material's textures, instead
+    //of this node loading its own copies
     StaticMeshNode(Shader* shader, Mesh* imesh, MeshMaterial* mat,
-        Vector3 pos, float scale, float yRot);
+        Vector3 pos, float scale, float yRot,
+        const std::vector<GLuint>* textures = nullptr);
     ~StaticMeshNode() = default;
 
     void Draw(const OGLRenderer& r);
+    void DrawInstanced(const OGLRenderer& r, int count, int baseInstance);
+    void Update(float dt);
+
+    bool IsStatic() const { return true; }
+    GLuint GetSubMeshTexture(int i) const {
+        return i < (int)matTextures.size() ? matTextures[i] : texture;
+    }
 
 protected:
     MeshMaterial*   mat;
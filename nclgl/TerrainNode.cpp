@@ -11,19 +11,18 @@ TerrainNode::TerrainNode(Shader* shader, Camera* camera, Mesh* mesh,
 
 	this->camera = camera;
 
-	transform.ToIdentity();
+	SetTransform(Matrix4());
+	//the heightmap starts at the origin, so this is very loose - but there's
+	//only the one terrain, and it's nearly always on screen anyway
+	SetBoundingRadius(mesh->GetBoundingRadius());
 }
 
 void TerrainNode::Draw(const OGLRenderer& r) {
-	glUniform1i(glGetUniformLocation(shader->GetProgram(),
-		"diffuseTex"), 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, earthTex);
+	shader->SetUniform(UNIFORM("diffuseTex"), 0);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, earthTex);
 
-	glUniform1i(glGetUniformLocation(shader->GetProgram(),
-		"bumpTex"), 1);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, earthBump);
+	shader->SetUniform(UNIFORM("bumpTex"), 1);
+	GLStateCache::BindTexture(1, GL_TEXTURE_2D, earthBump);
 
 	UpdateShaderMatrices();
 	mesh->Draw();
@@ -9,6 +9,7 @@ public:
 		GLuint earthTex, GLuint earthBump);
 
 	void Draw(const OGLRenderer& r);
+	bool CanInstance() const { return false; }
 
 protected:
 	Camera*		camera;
@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+//Which pool and queue the current thread works for - threads from outside
+//the pool all share its last queue
+static thread_local const ThreadPool*	workerPool	= nullptr;
+static thread_local int					workerIndex	= -1;
+
+ThreadPool::ThreadPool(unsigned int workers) {
+	queued		= 0;
+	pending		= 0;
+	nextQueue	= 0;
+	stopping	= false;
+
+	for (unsigned int i = 0; i < workers + 1; ++i) {
+		queues.emplace_back(new WorkQueue());
+	}
+	for (unsigned int i = 0; i < workers; ++i) {
+		threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool(void) {
+	Wait();
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& t : threads) {
+		t.join();
+	}
+}
+
+unsigned int ThreadPool::GetDefaultWorkerCount() {
+	unsigned int hw = std::thread::hardware_concurrency();
+	return hw > 1 ? hw - 1 : 0;
+}
+
+void ThreadPool::Submit(Task task) {
+	unsigned int index;
+	if (workerPool == this) {
+		index = (unsigned int)workerIndex; //keep it local, others can steal it
+	}
+	else if (threads.empty()) {
+		index = 0;
+	}
+	else {
+		index = nextQueue++ % (unsigned int)threads.size();
+	}
+	++pending;
+	{
+		//counted before anyone can see it, or a thief could take it and
+		//decrement the count first
+		std::lock_guard<std::mutex> guard(queues[index]->lock);
+		++queued;
+		queues[index]->tasks.emplace_back(std::move(task));
+	}
+	{
+		//taken so a worker can't miss the wake up between checking the
+		//count and going to sleep
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	wake.notify_one();
+}
+
+bool ThreadPool::TakeTask(unsigned int index, Task& out) {
+	{
+		WorkQueue& own = *queues[index];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.Empty()) {
+			out = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			own.ResetIfEmpty();
+			--queued;
+			return true;
+		}
+	}
+	const unsigned int count = (unsigned int)queues.size();
+	for (unsigned int i = 1; i < count; ++i) {
+		WorkQueue& victim = *queues[(index + i) % count];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.Empty()) {
+			out = std::move(victim.tasks[victim.head]);
+			victim.tasks[victim.head++] = nullptr;
+			victim.ResetIfEmpty();
+			--queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned int index) {
+	workerPool	= this;
+	workerIndex	= (int)index;
+	Profiler::SetThreadName("Worker " + std::to_string(index));
+	Task task;
+	while (true) {
+		if (TakeTask(index, task)) {
+			task();
+			task = nullptr;
+			--pending;
+			continue;
+		}
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wake.wait(guard, [this] { return queued > 0 || stopping; });
+		if (stopping && queued == 0) {
+			return;
+		}
+	}
+}
+
+void ThreadPool::Wait() {
+	const unsigned int index = workerPool == this ?
+		(unsigned int)workerIndex : (unsigned int)(queues.size() - 1);
+	Task task;
+	while (pending > 0) {
+		if (TakeTask(index, task)) {
+			task();
+			task = nullptr;
+			--pending;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
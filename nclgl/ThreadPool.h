@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+A small work stealing thread pool. Every worker has its own queue of tasks,
+which it works through from the back - if it runs dry, it steals from the
+front of somebody else's queue instead of going to sleep. Tasks submitted
+from outside the pool are dealt out to the workers in turn.
+
+The thread calling Wait helps out with queued tasks until everything that
+has been submitted is finished, so a pool with zero workers still works -
+it just runs everything on the waiting thread.
+*/
+class ThreadPool {
+public:
+	typedef std::function<void()> Task;
+
+	//Zero workers runs every task on the thread that calls Wait
+	ThreadPool(unsigned int workers);
+	~ThreadPool(void);
+
+	void			Submit(Task task);
+	//Blocks until every submitted task has finished. Don't call it from
+	//inside a task - the calling task counts as unfinished!
+	void			Wait();
+
+	unsigned int	GetWorkerCount() const { return (unsigned int)threads.size(); }
+
+	//One less than the number of hardware threads, leaving one for the
+	//thread that submits the work
+	static unsigned int GetDefaultWorkerCount();
+
+protected:
+	//Tasks from 'head' on are still to run. Stealing from the front just
+	//moves head along, and the storage is only reset once it's all been
+	//taken, so a queue that has warmed up never touches the heap
+	struct WorkQueue {
+		std::mutex			lock;
+		std::vector<Task>	tasks;
+		size_t				head = 0;
+
+		bool	Empty() const { return head == tasks.size(); }
+		void	ResetIfEmpty() {
+			if (Empty()) {
+				tasks.clear();
+				head = 0;
+			}
+		}
+	};
+
+	void	WorkerLoop(unsigned int index);
+	//Takes from the back of queue 'index', or steals from the front of any
+	//other queue if that's empty
+	bool	TakeTask(unsigned int index, Task& out);
+
+	std::vector<std::thread>				threads;
+	std::vector<std::unique_ptr<WorkQueue>>	queues;	//one per worker, plus one for outside threads
+
+	std::atomic<unsigned int>	queued;		//sat in a queue
+	std::atomic<unsigned int>	pending;	//queued, or still running
+	std::atomic<unsigned int>	nextQueue;
+
+	std::mutex				sleepLock;
+	std::condition_variable	wake;
+	bool					stopping;
+};
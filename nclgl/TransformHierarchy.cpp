@@ -0,0 +1,285 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+//Smallest sphere that encloses both a and b
+static BoundingSphere MergeSpheres(const BoundingSphere& a, const BoundingSphere& b) {
+	Vector3	offset	= b.centre - a.centre;
+	float	dist	= sqrt(Vector3::Dot(offset, offset));
+
+	if (dist + b.radius <= a.radius) {
+		return a;
+	}
+	if (dist + a.radius <= b.radius) {
+		return b;
+	}
+	BoundingSphere out;
+	out.radius = (dist + a.radius + b.radius) * 0.5f;
+	out.centre = a.centre + offset * ((out.radius - a.radius) / dist);
+	return out;
+}
+
+const TransformHierarchy::Handle TransformHierarchy::INVALID_HANDLE;
+
+TransformHierarchy::TransformHierarchy(void) {
+	deadCount	= 0;
+	orderDirty	= false;
+
+	recomputedCount	= 0;
+	skippedCount	= 0;
+}
+
+TransformHierarchy::Handle TransformHierarchy::Add() {
+	Handle h;
+	if (!freeHandles.empty()) {
+		h = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		h = (Handle)slots.size();
+		slots.emplace_back(0);
+		parentHandles.emplace_back(INVALID_HANDLE);
+	}
+	//A new root can go on the end without breaking depth-first order
+	slots[h]			= (unsigned int)handles.size();
+	parentHandles[h]	= INVALID_HANDLE;
+
+	parents.emplace_back(-1);
+	local.emplace_back(Matrix4());
+	world.emplace_back(Matrix4());
+	handles.emplace_back(h);
+	dirty.emplace_back(1);
+	subtreeEnd.emplace_back((unsigned int)handles.size());
+	radius.emplace_back(1.0f);
+	bounds.emplace_back(BoundingSphere{ Vector3(0, 0, 0), 1.0f });
+	boundsDirty.emplace_back(1);
+	return h;
+}
+
+void TransformHierarchy::Reserve(size_t count) {
+	const size_t dense	= handles.size() + count;
+	const size_t sparse	= slots.size() + count;
+	parents.reserve(dense);
+	local.reserve(dense);
+	world.reserve(dense);
+	handles.reserve(dense);
+	dirty.reserve(dense);
+	subtreeEnd.reserve(dense);
+	radius.reserve(dense);
+	bounds.reserve(dense);
+	boundsDirty.reserve(dense);
+	slots.reserve(sparse);
+	parentHandles.reserve(sparse);
+}
+
+void TransformHierarchy::Remove(Handle h) {
+	//Leave a hole in the dense arrays, so every other handle stays valid
+	//until the next rebuild compacts them
+	handles[slots[h]]	= INVALID_HANDLE;
+	parentHandles[h]	= INVALID_HANDLE;
+	freeHandles.emplace_back(h);
+	++deadCount;
+	orderDirty = true;
+}
+
+void TransformHierarchy::SetParent(Handle h, Handle parent) {
+	parentHandles[h]	= parent;
+	orderDirty			= true;
+	//its world transform now depends on a different parent
+	dirty[slots[h]]		= 1;
+}
+
+void TransformHierarchy::SetLocal(Handle h, const Matrix4& m) {
+	unsigned int slot = slots[h];
+	//Plenty of nodes rebuild the same transform every frame - comparing the
+	//bits is far cheaper than recomputing everything below them
+	if (memcmp(local[slot].values, m.values, sizeof(m.values)) == 0) {
+		return;
+	}
+	local[slot] = m;
+	dirty[slot] = 1;
+}
+
+void TransformHierarchy::SetRadius(Handle h, float r) {
+	unsigned int slot = slots[h];
+	if (radius[slot] != r) {
+		radius[slot]		= r;
+		boundsDirty[slot]	= 1;
+	}
+}
+
+/*
+Re-sorts the dense arrays into depth-first order, dropping removed entries.
+Siblings keep the relative order they had before, so rebuilding an already
+sorted hierarchy doesn't move anything.
+*/
+void TransformHierarchy::Rebuild() {
+	const Handle handleCount = (Handle)slots.size();
+
+	//Build child lists from the parent handles, walking the current order
+	//so that siblings stay in the order they were added
+	std::vector<Handle> firstChild(handleCount, INVALID_HANDLE);
+	std::vector<Handle> lastChild(handleCount, INVALID_HANDLE);
+	std::vector<Handle> nextSibling(handleCount, INVALID_HANDLE);
+	std::vector<Handle> roots;
+
+	for (Handle h : handles) {
+		if (h == INVALID_HANDLE) {
+			continue;
+		}
+		Handle p = parentHandles[h];
+		if (p == INVALID_HANDLE) {
+			roots.emplace_back(h);
+		}
+		else if (firstChild[p] == INVALID_HANDLE) {
+			firstChild[p]	= h;
+			lastChild[p]	= h;
+		}
+		else {
+			nextSibling[lastChild[p]]	= h;
+			lastChild[p]				= h;
+		}
+	}
+
+	size_t liveCount = handles.size() - deadCount;
+
+	std::vector<int>		newParents;
+	std::vector<Matrix4>	newLocal;
+	std::vector<Matrix4>	newWorld;
+	std::vector<Handle>		newHandles;
+	std::vector<unsigned char>	newDirty;
+	std::vector<float>			newRadius;
+	std::vector<BoundingSphere>	newBounds;
+	newParents.reserve(liveCount);
+	newLocal.reserve(liveCount);
+	newWorld.reserve(liveCount);
+	newHandles.reserve(liveCount);
+	newDirty.reserve(liveCount);
+	newRadius.reserve(liveCount);
+	newBounds.reserve(liveCount);
+
+	std::vector<Handle> stack;
+	for (Handle root : roots) {
+		stack.emplace_back(root);
+		while (!stack.empty()) {
+			Handle h = stack.back();
+			stack.pop_back();
+
+			unsigned int oldSlot	= slots[h];
+			Handle p				= parentHandles[h];
+
+			newParents.emplace_back(p == INVALID_HANDLE ? -1 : (int)slots[p]);
+			newLocal.emplace_back(local[oldSlot]);
+			newWorld.emplace_back(world[oldSlot]);
+			newHandles.emplace_back(h);
+			newDirty.emplace_back(dirty[oldSlot]);
+			newRadius.emplace_back(radius[oldSlot]);
+			newBounds.emplace_back(bounds[oldSlot]);
+			//parents are always visited first, so it's safe to overwrite
+			//their slot straight away - children look it up afterwards
+			slots[h] = (unsigned int)(newHandles.size() - 1);
+
+			//push in reverse, so the first child is popped first
+			size_t mark = stack.size();
+			for (Handle c = firstChild[h]; c != INVALID_HANDLE; c = nextSibling[c]) {
+				stack.emplace_back(c);
+			}
+			std::reverse(stack.begin() + mark, stack.end());
+		}
+	}
+
+	parents.swap(newParents);
+	local.swap(newLocal);
+	world.swap(newWorld);
+	handles.swap(newHandles);
+	dirty.swap(newDirty);
+	radius.swap(newRadius);
+	bounds.swap(newBounds);
+	//Subtrees have gained or lost members, so refit the lot
+	boundsDirty.assign(handles.size(), 1);
+
+	//Children always come after their parent, so walking backwards
+	//accumulates the size of every subtree before its root is reached
+	const size_t count = handles.size();
+	subtreeEnd.assign(count, 1);
+	for (size_t i = count; i-- > 0;) {
+		if (parents[i] >= 0) {
+			subtreeEnd[parents[i]] += subtreeEnd[i];
+		}
+	}
+	for (size_t i = 0; i < count; ++i) {
+		subtreeEnd[i] += (unsigned int)i;
+	}
+
+	deadCount	= 0;
+	orderDirty	= false;
+}
+
+/*
+Skips along the array until it finds a dirty entry, then recomputes that
+entry's whole subtree - which is the contiguous run up to its subtreeEnd -
+and carries on after it. Anything dirty inside that run gets cleaned up by
+the same recompute.
+*/
+void TransformHierarchy::UpdateWorldTransforms() {
+	if (orderDirty) {
+		Rebuild();
+	}
+	recomputedCount	= 0;
+	skippedCount	= 0;
+
+	const size_t count = handles.size();
+	size_t i = 0;
+	while (i < count) {
+		if (!dirty[i]) {
+			++i;
+			++skippedCount;
+			continue;
+		}
+		const size_t end = subtreeEnd[i];
+		recomputedCount += end - i;
+		for (; i < end; ++i) {
+			int p = parents[i];
+			if (p < 0) {
+				world[i] = local[i];
+			}
+			else {
+				world[i] = world[p] * local[i];
+			}
+			dirty[i]		= 0;
+			boundsDirty[i]	= 1;
+		}
+	}
+	RefitBounds();
+}
+
+/*
+Three passes over the flags, but the sphere maths is only done for entries
+that are dirty, or sit above one that is. The first pass walks backwards
+to spread the dirty flags up to every ancestor, the second resets those
+entries to their own sphere, and the last walks backwards again merging
+each subtree into its parent - children are always finished before their
+parent is reached.
+*/
+void TransformHierarchy::RefitBounds() {
+	const size_t count = handles.size();
+	for (size_t i = count; i-- > 0;) {
+		if (boundsDirty[i] && parents[i] >= 0) {
+			boundsDirty[parents[i]] = 1;
+		}
+	}
+	for (size_t i = 0; i < count; ++i) {
+		if (boundsDirty[i]) {
+			bounds[i].centre = world[i].GetPositionVector();
+			bounds[i].radius = radius[i];
+		}
+	}
+	for (size_t i = count; i-- > 0;) {
+		int p = parents[i];
+		if (p >= 0 && boundsDirty[p]) {
+			bounds[p] = MergeSpheres(bounds[p], bounds[i]);
+		}
+		boundsDirty[i] = 0;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "Matrix4.h"
+#include "Vector3.h"
+#include <vector>
+
+struct BoundingSphere {
+	Vector3	centre;
+	float	radius;
+};
+
+/*
+Flat storage for scene graph transforms. Local and world matrices live in
+contiguous arrays kept in depth-first order, so a parent is always stored
+before its children, and world transforms can be propagated with one
+linear pass instead of a recursive walk over heap allocated nodes.
+
+Entries are referred to by handle, which stays valid for the lifetime of
+the entry even when the arrays get reordered. Changes to the hierarchy
+itself are cheap to make - the arrays are only re-sorted the next time
+UpdateWorldTransforms is called.
+
+Only entries whose local transform has actually changed since the last
+update are marked dirty, and only their subtrees get their world
+transforms recomputed - anything that never moves is skipped over.
+
+Every entry also has a bounding sphere around its own position, and a
+conservative sphere around its whole subtree. Subtree spheres are refitted
+after the world transforms, but only along the paths above entries that
+moved or changed radius.
+*/
+class TransformHierarchy {
+public:
+	typedef unsigned int Handle;
+	static const Handle INVALID_HANDLE = 0xFFFFFFFF;
+
+	TransformHierarchy(void);
+	~TransformHierarchy(void) {};
+
+	//New entries have an identity transform, and no parent
+	Handle	Add();
+	//Makes room for this many more entries, for adding lots in one go
+	void	Reserve(size_t count);
+	//Any children must have been removed or reparented first
+	void	Remove(Handle h);
+	void	SetParent(Handle h, Handle parent);
+
+	const Matrix4&	GetLocal(Handle h) const { return local[slots[h]]; }
+	//Marks the entry dirty, unless m is exactly what's already stored
+	void			SetLocal(Handle h, const Matrix4& m);
+	//Only up to date as of the last call to UpdateWorldTransforms
+	const Matrix4&	GetWorld(Handle h) const { return world[slots[h]]; }
+
+	float	GetRadius(Handle h) const { return radius[slots[h]]; }
+	void	SetRadius(Handle h, float r);
+	//Encloses the entry, and everything below it
+	const BoundingSphere&	GetSubtreeBounds(Handle h) const { return bounds[slots[h]]; }
+
+	//Also refits the subtree bounds
+	void	UpdateWorldTransforms();
+
+	size_t	GetCount() const { return handles.size() - deadCount; }
+
+	//How many world transforms the last update recomputed, and how many it
+	//left alone because nothing above them had changed
+	size_t	GetRecomputedCount()	const { return recomputedCount; }
+	size_t	GetSkippedCount()		const { return skippedCount; }
+
+protected:
+	void	Rebuild();
+	void	RefitBounds();
+
+	//Dense arrays, in depth-first order
+	std::vector<int>		parents;	//dense index of the parent, or -1
+	std::vector<Matrix4>	local;
+	std::vector<Matrix4>	world;
+	std::vector<Handle>		handles;	//dense index -> handle
+	std::vector<unsigned char>	dirty;		//local changed since last update
+	std::vector<unsigned int>	subtreeEnd;	//one past the last descendant
+	std::vector<float>			radius;
+	std::vector<BoundingSphere>	bounds;		//subtree bounds
+	std::vector<unsigned char>	boundsDirty;
+
+	//Sparse arrays, indexed by handle
+	std::vector<unsigned int>	slots;			//handle -> dense index
+	std::vector<Handle>			parentHandles;
+	std::vector<Handle>			freeHandles;
+
+	size_t	deadCount;
+	bool	orderDirty;
+
+	size_t	recomputedCount;
+	size_t	skippedCount;
+};
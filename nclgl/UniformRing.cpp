@@ -0,0 +1,201 @@
+#include "UniformRing.h"
+#include "GLStateCache.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+UniformRing::UniformRing(size_t bytesPerFrame, int frames) {
+	regionSize		= bytesPerFrame;
+	regionCount		= std::max(frames, 1);
+	fences			= new GLsync[regionCount];
+	for (int i = 0; i < regionCount; ++i) {
+		fences[i] = NULL;
+	}
+	buffer			= 0;
+	persistent		= false;
+	mapped			= NULL;
+	region			= 0;
+	used			= 0;
+	alignment		= 256;
+
+	frameBytes		= 0;
+	frameBinds		= 0;
+	lastFrameBytes	= 0;
+	lastFrameBinds	= 0;
+	warnedFull		= false;
+}
+
+UniformRing::~UniformRing(void) {
+	Release();
+	delete[] fences;
+}
+
+bool UniformRing::Create() {
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment	= std::max(alignment, 1);
+	regionSize	= (regionSize + alignment - 1) / alignment * alignment;
+
+	shadow.resize(regionSize);
+	spare.resize(regionSize);
+
+	GLStateCache::BindVertexArray(0);
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+
+	persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+	if (persistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+			GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, regionSize * regionCount, NULL, flags);
+		mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0,
+			regionSize * regionCount, flags);
+		if (!mapped) {
+			std::cout << "UniformRing::Create(): Couldn't map uniform buffer!\n";
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			glDeleteBuffers(1, &buffer);
+			buffer = 0;
+			return false;
+		}
+	}
+	else {
+		glBufferData(GL_UNIFORM_BUFFER, regionSize * regionCount, NULL,
+			GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return true;
+}
+
+void UniformRing::Release() {
+	for (int i = 0; i < regionCount; ++i) {
+		if (fences[i]) {
+			glDeleteSync(fences[i]);
+			fences[i] = NULL;
+		}
+	}
+	if (buffer) {
+		//Deleting the buffer unmaps it too
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		mapped = NULL;
+	}
+}
+
+void UniformRing::WaitForRegion(int r) {
+	if (!fences[r]) {
+		return;
+	}
+	GLenum result = GL_TIMEOUT_EXPIRED;
+	while (result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT,
+			1000000);	//1ms
+	}
+	glDeleteSync(fences[r]);
+	fences[r] = NULL;
+}
+
+size_t UniformRing::Align(size_t offset) const {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+void UniformRing::Write(size_t offset, const void* data, size_t bytes) {
+	memcpy(&shadow[offset], data, bytes);
+	size_t start = region * regionSize + offset;
+	if (persistent) {
+		memcpy(mapped + start, data, bytes);
+	}
+	else {
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, start, bytes, data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	frameBytes += bytes;
+}
+
+void UniformRing::StartRegionOver(GLuint replacing) {
+	//Draws already made might still be reading the region. glBufferSubData
+	//waits for them itself, but the mapping has to be waited on here
+	if (persistent) {
+		glFinish();
+	}
+	//Packed to one side first, as they might overlap where they're going
+	size_t packed = 0;
+	for (size_t i = 0; i < live.size(); ) {
+		LiveBlock& b = live[i];
+		if (b.binding == replacing) {
+			live[i] = live.back();
+			live.pop_back();
+			continue;
+		}
+		packed = Align(packed);
+		memcpy(&spare[packed], &shadow[b.offset], b.bytes);
+		b.offset = packed;
+		packed += b.bytes;
+		++i;
+	}
+	for (const LiveBlock& b : live) {
+		Write(b.offset, &spare[b.offset], b.bytes);
+		glBindBufferRange(GL_UNIFORM_BUFFER, b.binding, buffer,
+			region * regionSize + b.offset, b.bytes);
+		++frameBinds;
+	}
+	used = packed;
+}
+
+void UniformRing::Bind(GLuint binding, const void* data, size_t bytes) {
+	if (!buffer && !Create()) {
+		return;
+	}
+	size_t offset = Align(used);
+	if (offset + bytes > regionSize) {
+		//Correct, but slow, so say so once
+		if (!warnedFull) {
+			std::cout << "UniformRing::Bind(): " << regionSize
+				<< " bytes isn't enough for one frame's uniforms!\n";
+			warnedFull = true;
+		}
+		StartRegionOver(binding);
+		offset = Align(used);
+		if (offset + bytes > regionSize) {
+			return;
+		}
+	}
+	Write(offset, data, bytes);
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer,
+		region * regionSize + offset, bytes);
+
+	LiveBlock* block = NULL;
+	for (LiveBlock& b : live) {
+		if (b.binding == binding) {
+			block = &b;
+			break;
+		}
+	}
+	if (!block) {
+		live.push_back(LiveBlock());
+		block = &live.back();
+		block->binding = binding;
+	}
+	block->offset	= offset;
+	block->bytes	= bytes;
+
+	used = offset + bytes;
+	++frameBinds;
+}
+
+void UniformRing::NextFrame() {
+	lastFrameBytes	= frameBytes;
+	lastFrameBinds	= frameBinds;
+	frameBytes		= 0;
+	frameBinds		= 0;
+	used			= 0;
+	live.clear();
+	if (!buffer) {
+		return;
+	}
+	//glBufferSubData does its own waiting, so needs no fences
+	if (persistent) {
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	region			= (region + 1) % regionCount;
+	WaitForRegion(region);
+}
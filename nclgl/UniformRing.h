@@ -0,0 +1,77 @@
+#pragma once
+#include "glad/glad.h"
+#include <cstddef>
+#include <vector>
+
+/*
+A uniform buffer that stays mapped for as long as it exists, split into one
+region per frame in flight. Uniform blocks are copied straight into the
+current frame's region and bound with glBindBufferRange, so changing a
+block costs a memcpy rather than a buffer update.
+
+The CPU only ever writes into a region the GPU has finished with - each
+region gets a fence when its frame ends, which is waited on before the
+region comes round again. Blocks written during a frame stay valid until
+the end of it, so anything still bound going into the next frame has to be
+written again. If a frame fills its region, the region is started over,
+and the blocks still bound are copied back in and bound again.
+
+The buffer is made on first use, so this can be a member of something that
+exists before its GL context does. Mapping it for good needs GL 4.4 or
+ARB_buffer_storage - without either, blocks go in with glBufferSubData.
+*/
+class UniformRing {
+public:
+	UniformRing(size_t bytesPerFrame = 64 * 1024, int frames = 3);
+	~UniformRing(void);
+
+	//Copies the block in, and binds it to a uniform block binding point
+	void	Bind(GLuint binding, const void* data, size_t bytes);
+	template <class T>
+	void	Bind(GLuint binding, const T& block) { Bind(binding, &block, sizeof(T)); }
+
+	//Fences off this frame's region and waits for the next one to be free
+	void	NextFrame();
+	//Deletes the buffer - must happen while the context is still current
+	void	Release();
+
+	size_t	GetLastFrameBytes()		const { return lastFrameBytes; }
+	size_t	GetLastFrameBinds()		const { return lastFrameBinds; }
+
+protected:
+	//What's bound to each binding point this frame, and where
+	struct LiveBlock {
+		GLuint	binding;
+		size_t	offset;
+		size_t	bytes;
+	};
+
+	bool	Create();
+	void	WaitForRegion(int region);
+	size_t	Align(size_t offset) const;
+	//Copies into the current region, and its CPU copy
+	void	Write(size_t offset, const void* data, size_t bytes);
+	//Empties the current region, keeping every live block but the one
+	//about to be replaced
+	void	StartRegionOver(GLuint replacing);
+
+	GLuint		buffer;
+	bool		persistent;	//mapped for good, rather than glBufferSubData
+	char*		mapped;
+	GLsync*		fences;		//one per region, NULL if it's free already
+	size_t		regionSize;
+	int			regionCount;
+	int			region;		//the one this frame writes into
+	size_t		used;		//bytes into the current region
+	GLint		alignment;	//GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+	std::vector<char>		shadow;		//the current region, as written
+	std::vector<char>		spare;		//for packing live blocks into
+	std::vector<LiveBlock>	live;
+
+	size_t		frameBytes;
+	size_t		frameBinds;
+	size_t		lastFrameBytes;
+	size_t		lastFrameBinds;
+	bool		warnedFull;
+};
@@ -9,9 +9,10 @@ WaterNode::WaterNode(Shader* shader, GLuint tex, Mesh* mesh,
 	this->size = size;
 	size.y *= 0.5f; // adjust water level
 
-	transform = Matrix4::Translation(size * 0.5f) *
+	SetTransform(Matrix4::Translation(size * 0.5f) *
 				Matrix4::Scale(size * 0.5f) *
-				Matrix4::Rotation(90, Vector3(1, 0, 0));
+				Matrix4::Rotation(90, Vector3(1, 0, 0)));
+	SetBoundingRadius(Vector3(size.x, 0.0f, size.z).Length() * 0.5f);
 }
 
 void WaterNode::Update(float dt) {
@@ -21,17 +22,14 @@ void WaterNode::Update(float dt) {
 
 void WaterNode::Draw(const OGLRenderer& r) {
 	LoadTexture();
-	glUniform1i(glGetUniformLocation(shader->GetProgram(), 
-											"cubeTex"), 2);
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	shader->SetUniform(UNIFORM("cubeTex"), 2);
+	GLStateCache::BindTexture(2, GL_TEXTURE_CUBE_MAP, cubemap);
 
 	textureMatrix = Matrix4::Translation(Vector3(waterCycle, 0.0f, waterCycle)) *
 					Matrix4::Scale(Vector3(10, 10, 10)) *
 					Matrix4::Rotation(waterRotate, Vector3(0, 0, 1));
 
-	glUniformMatrix4fv(glGetUniformLocation(shader->GetProgram(), 
-				"textureMatrix"), 1, false, textureMatrix.values);
+	shader->SetUniform(UNIFORM("textureMatrix"), textureMatrix);
 
 	UpdateShaderMatrices();
 	mesh->Draw();
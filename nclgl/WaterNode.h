@@ -10,6 +10,7 @@ public:
 				GLuint cubemap, Vector3 heightMap);
 
 	void	Draw(const OGLRenderer& r);
+	bool	CanInstance() const { return false; }
 
 protected:
 	void	Update(float dt);